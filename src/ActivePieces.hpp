@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Piece.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace torrent {
+
+/**
+ * @brief Fixed-capacity table of the pieces being downloaded or verified
+ *
+ * Each piece is stored in a slot, found from the index of the piece with a single indexed load. The
+ * slots are allocated once, so the table is never rehashed and the pieces never move
+ */
+class ActivePieces {
+    public:
+        /**
+         * @brief Create an empty table
+         *
+         * @param pieces_cnt Number of pieces in the torrent
+         * @param capacity Maximum number of pieces stored at once
+         */
+        ActivePieces(size_t pieces_cnt, size_t capacity)
+            : slots_(capacity), slot_piece_(capacity), piece_slot_(pieces_cnt, NO_SLOT) {
+            free_slots_.reserve(capacity);
+            // The lowest slots are used first
+            for (auto slot{static_cast<uint32_t>(capacity)}; slot-- > 0;) {
+                free_slots_.push_back(slot);
+            }
+        }
+
+        /**
+         * @brief Get the number of pieces in the table
+         *
+         * @return Number of pieces
+         */
+        [[nodiscard]] size_t size() const { return slots_.size() - free_slots_.size(); }
+
+        /**
+         * @brief Check if every slot is taken
+         *
+         * @return True if no piece can be added
+         */
+        [[nodiscard]] bool full() const { return free_slots_.empty(); }
+
+        /**
+         * @brief Check if a piece is in the table
+         *
+         * @param piece_index Index of the piece
+         * @return True if the piece is in the table
+         */
+        [[nodiscard]] bool contains(uint32_t piece_index) const {
+            return piece_slot_[piece_index] != NO_SLOT;
+        }
+
+        /**
+         * @brief Find a piece
+         *
+         * @param piece_index Index of the piece
+         * @return A pointer to the piece, or nullptr if the piece is not in the table
+         */
+        [[nodiscard]] Piece* find(uint32_t piece_index) {
+            auto slot{piece_slot_[piece_index]};
+            return slot == NO_SLOT ? nullptr : &*slots_[slot];
+        }
+
+        /**
+         * @copydoc find
+         */
+        [[nodiscard]] const Piece* find(uint32_t piece_index) const {
+            auto slot{piece_slot_[piece_index]};
+            return slot == NO_SLOT ? nullptr : &*slots_[slot];
+        }
+
+        /**
+         * @brief Construct a piece in a free slot
+         *
+         * @param piece_index Index of the piece, which must not be in the table
+         * @param args Arguments of the constructor of the piece
+         * @return The piece
+         * @note The table must not be full
+         */
+        template <typename... Args>
+        Piece& emplace(uint32_t piece_index, Args&&... args) {
+            assert(!full() && "No free slot");
+            assert(!contains(piece_index) && "Piece already in the table");
+            auto slot{free_slots_.back()};
+            free_slots_.pop_back();
+            slots_[slot].emplace(std::forward<Args>(args)...);
+            slot_piece_[slot]        = piece_index;
+            piece_slot_[piece_index] = slot;
+            return *slots_[slot];
+        }
+
+        /**
+         * @brief Destroy a piece and free its slot
+         *
+         * @param piece_index Index of the piece, which must be in the table
+         */
+        void erase(uint32_t piece_index) {
+            assert(contains(piece_index) && "Piece not in the table");
+            auto slot{piece_slot_[piece_index]};
+            slots_[slot].reset();
+            piece_slot_[piece_index] = NO_SLOT;
+            free_slots_.push_back(slot);
+        }
+
+        /**
+         * @brief Call a function on every piece of the table
+         *
+         * @param func Function called with the index of the piece and the piece
+         */
+        template <typename Func>
+        void for_each(Func&& func) {
+            for (size_t slot{0}; slot < slots_.size(); ++slot) {
+                if (slots_[slot].has_value()) {
+                    func(slot_piece_[slot], *slots_[slot]);
+                }
+            }
+        }
+
+    private:
+        static constexpr uint32_t NO_SLOT{std::numeric_limits<uint32_t>::max()};
+
+        // The pieces, an empty slot holding no piece
+        std::vector<std::optional<Piece>> slots_;
+        // Index of the piece stored in each slot
+        std::vector<uint32_t> slot_piece_;
+        // Slot of each piece of the torrent, NO_SLOT if the piece is not in the table
+        std::vector<uint32_t> piece_slot_;
+        // Slots holding no piece, the next one to use being at the back
+        std::vector<uint32_t> free_slots_;
+};
+
+}  // namespace torrent
@@ -2,11 +2,13 @@
 
 #include "Error.hpp"
 
+#include <algorithm>
 #include <charconv>
 #include <istream>
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 namespace Bencode {
 
@@ -131,6 +133,46 @@ namespace {
 
         std::unreachable();
     }
+
+    void encode(const BencodeItem& item, std::string& output);
+
+    void encode_string(const BencodeString& str, std::string& output) {
+        output += std::to_string(str.size());
+        output += ':';
+        output += str;
+    }
+
+    void encode(const BencodeItem& item, std::string& output) {
+        if (const auto* integer = std::get_if<BencodeInt>(&item)) {
+            output += 'i';
+            output += std::to_string(*integer);
+            output += 'e';
+        } else if (const auto* str = std::get_if<BencodeString>(&item)) {
+            encode_string(*str, output);
+        } else if (const auto* list = std::get_if<BencodeList>(&item)) {
+            output += 'l';
+            for (const auto& elem : *list) {
+                encode(elem, output);
+            }
+            output += 'e';
+        } else {
+            const auto& dict{std::get<BencodeDict>(item)};
+
+            std::vector<const BencodeDict::value_type*> entries;
+            entries.reserve(dict.size());
+            for (const auto& entry : dict) {
+                entries.push_back(&entry);
+            }
+            std::ranges::sort(entries, {}, [](const auto* entry) { return entry->first; });
+
+            output += 'd';
+            for (const auto* entry : entries) {
+                encode_string(entry->first, output);
+                encode(entry->second, output);
+            }
+            output += 'e';
+        }
+    }
 }  // namespace
 
 [[nodiscard]] BencodeItem BDecode(std::istream& input) {
@@ -145,4 +187,10 @@ namespace {
     return BDecode(stream);
 }
 
+[[nodiscard]] std::string BEncode(const BencodeItem& item) {
+    std::string output;
+    encode(item, output);
+    return output;
+}
+
 }  // namespace Bencode
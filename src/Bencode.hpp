@@ -67,4 +67,12 @@ class BencodeItem : public std::variant<BencodeInt, BencodeString, BencodeList,
  */
 [[nodiscard]] BencodeItem BDecode(const std::string& input);
 
+/**
+ * @brief Encode a bencode item
+ * The keys of the dictionaries are written in sorted order, as required by the specification
+ * @param item Bencode item
+ * @return Bencoded string
+ */
+[[nodiscard]] std::string BEncode(const BencodeItem& item);
+
 }  // namespace Bencode
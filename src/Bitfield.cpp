@@ -0,0 +1,206 @@
+#include "Bitfield.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <immintrin.h>
+#    define TORRENT_BITFIELD_X86
+#endif
+
+namespace torrent {
+
+namespace {
+
+    constexpr size_t WORD_BITS{64};
+
+    /**
+     * @brief Update the counters of the set bits of a word one bit at a time
+     *
+     * @tparam Add True to increment the counters, false to decrement them
+     * @param word The bits, the first one being the most significant bit
+     * @param counters The counters of the bits of the word
+     */
+    template <bool Add>
+    void update_counters_scalar(uint64_t word, uint16_t* counters) {
+        while (word != 0) {
+            auto bit{std::countl_zero(word)};
+            if constexpr (Add) {
+                ++counters[bit];
+            } else {
+                --counters[bit];
+            }
+            word &= ~(1ULL << (WORD_BITS - 1 - bit));
+        }
+    }
+
+#ifdef TORRENT_BITFIELD_X86
+
+    /**
+     * @brief Update the counters of the 64 bits of a word, 16 counters at a time
+     * Each lane selects its own bit of the word, and the comparison turns it into 0 or -1
+     *
+     * @tparam Add True to increment the counters, false to decrement them
+     * @param word The bits, the first one being the most significant bit
+     * @param counters The 64 counters of the bits of the word
+     */
+    template <bool Add>
+    __attribute__((target("avx2"))) void update_counters_avx2(uint64_t word, uint16_t* counters) {
+        const __m256i lane_bits{_mm256_setr_epi16(
+            static_cast<int16_t>(0x8000),
+            0x4000,
+            0x2000,
+            0x1000,
+            0x0800,
+            0x0400,
+            0x0200,
+            0x0100,
+            0x0080,
+            0x0040,
+            0x0020,
+            0x0010,
+            0x0008,
+            0x0004,
+            0x0002,
+            0x0001
+        )};
+
+        for (size_t i{0}; i < WORD_BITS / 16; ++i) {
+            auto bits{static_cast<int16_t>(word >> (WORD_BITS - 16 * (i + 1)))};
+            auto is_set{_mm256_cmpeq_epi16(
+                _mm256_and_si256(_mm256_set1_epi16(bits), lane_bits), lane_bits
+            )};
+
+            auto* ptr{reinterpret_cast<__m256i*>(counters + 16 * i)};
+            auto  values{_mm256_loadu_si256(ptr)};
+            if constexpr (Add) {
+                values = _mm256_sub_epi16(values, is_set);
+            } else {
+                values = _mm256_add_epi16(values, is_set);
+            }
+            _mm256_storeu_si256(ptr, values);
+        }
+    }
+
+#endif  // TORRENT_BITFIELD_X86
+
+    /**
+     * @brief Update the counters of the set bits of a bitfield
+     *
+     * @tparam Add True to increment the counters, false to decrement them
+     * @param words The packed bits
+     * @param counters One counter per bit
+     */
+    template <bool Add>
+    void update_counters(std::span<const uint64_t> words, std::span<uint16_t> counters) {
+        // Only the words whose 64 counters all exist are updated with SIMD
+        size_t full_words{counters.size() / WORD_BITS};
+
+#ifdef TORRENT_BITFIELD_X86
+        if (__builtin_cpu_supports("avx2")) {
+            for (size_t i{0}; i < full_words; ++i) {
+                // A peer usually has either most or very few of the pieces, so the empty words are
+                // skipped
+                if (words[i] != 0) {
+                    update_counters_avx2<Add>(words[i], counters.data() + i * WORD_BITS);
+                }
+            }
+            for (size_t i{full_words}; i < words.size(); ++i) {
+                update_counters_scalar<Add>(words[i], counters.data() + i * WORD_BITS);
+            }
+            return;
+        }
+#endif  // TORRENT_BITFIELD_X86
+
+        for (size_t i{0}; i < words.size(); ++i) {
+            update_counters_scalar<Add>(words[i], counters.data() + i * WORD_BITS);
+        }
+    }
+
+}  // namespace
+
+Bitfield::Bitfield(std::initializer_list<bool> bits) : Bitfield(bits.size()) {
+    size_t index{0};
+    for (auto bit : bits) {
+        if (bit) {
+            set(index);
+        }
+        ++index;
+    }
+}
+
+Bitfield::Bitfield(const std::vector<bool>& bits) : Bitfield(bits.size()) {
+    for (size_t index{0}; index < bits.size(); ++index) {
+        if (bits[index]) {
+            set(index);
+        }
+    }
+}
+
+Bitfield Bitfield::from_bytes(std::span<const std::byte> payload, size_t size) {
+    Bitfield bitfield(size);
+    payload = payload.first(std::min(payload.size(), utils::ceil_div(size, 8uz)));
+
+    // The wire format is the big endian representation of the words
+    for (size_t i{0}; i < bitfield.words_.size(); ++i) {
+        auto     word_bytes{payload.subspan(std::min(i * sizeof(uint64_t), payload.size()))};
+        uint64_t word{0};
+        std::memcpy(&word, word_bytes.data(), std::min(word_bytes.size(), sizeof(uint64_t)));
+        bitfield.words_[i] = utils::network_to_host_order(word);
+    }
+
+    // Clear the bits past the size, which the peer should have left cleared anyway
+    if (size % WORD_BITS != 0) {
+        bitfield.words_.back() &= ~(~0ULL >> (size % WORD_BITS));
+    }
+
+    return bitfield;
+}
+
+size_t Bitfield::count() const {
+    size_t cnt{0};
+    for (auto word : words_) {
+        cnt += std::popcount(word);
+    }
+    return cnt;
+}
+
+bool Bitfield::all() const {
+    for (size_t i{0}; i < size_ / WORD_BITS; ++i) {
+        if (words_[i] != ~0ULL) {
+            return false;
+        }
+    }
+    // The bits past the size are cleared, so the last word is compared against its used bits
+    return size_ % WORD_BITS == 0 || words_.back() == ~(~0ULL >> (size_ % WORD_BITS));
+}
+
+Bitfield Bitfield::and_not(const Bitfield& other) const {
+    assert(size_ == other.size_ && "Bitfields of different sizes");
+    Bitfield diff(size_);
+    for (size_t i{0}; i < words_.size(); ++i) {
+        diff.words_[i] = words_[i] & ~other.words_[i];
+    }
+    return diff;
+}
+
+size_t Bitfield::count_and_not(const Bitfield& other) const {
+    assert(size_ == other.size_ && "Bitfields of different sizes");
+    size_t cnt{0};
+    for (size_t i{0}; i < words_.size(); ++i) {
+        cnt += std::popcount(words_[i] & ~other.words_[i]);
+    }
+    return cnt;
+}
+
+void Bitfield::add_to(std::span<uint16_t> counters) const {
+    assert(counters.size() == size_ && "One counter per bit is expected");
+    update_counters<true>(words_, counters);
+}
+
+void Bitfield::subtract_from(std::span<uint16_t> counters) const {
+    assert(counters.size() == size_ && "One counter per bit is expected");
+    update_counters<false>(words_, counters);
+}
+
+}  // namespace torrent
@@ -0,0 +1,188 @@
+#pragma once
+
+#include "Utils.hpp"
+
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <vector>
+
+namespace torrent {
+
+/**
+ * @brief Set of pieces packed in 64-bit words
+ *
+ * The bits are stored in the order of the wire format: the first piece is the most significant bit
+ * of the first word. The bits past the size are always cleared
+ */
+class Bitfield {
+    public:
+        Bitfield() = default;
+
+        /**
+         * @brief Create an empty bitfield
+         *
+         * @param size Number of bits
+         */
+        explicit Bitfield(size_t size) : size_{size}, words_(utils::ceil_div(size, WORD_BITS), 0) {}
+
+        /**
+         * @brief Create a bitfield from a list of bits
+         *
+         * @param bits Value of each bit
+         */
+        Bitfield(std::initializer_list<bool> bits);
+
+        /**
+         * @brief Create a bitfield from a vector of bits
+         *
+         * @param bits Value of each bit
+         */
+        explicit Bitfield(const std::vector<bool>& bits);
+
+        /**
+         * @brief Create a bitfield from the payload of a bitfield message
+         * The payload is copied word by word, without unpacking the bits
+         *
+         * @param payload The packed bits, the first bit being the most significant bit of the first
+         * byte
+         * @param size Number of bits
+         * @return The bitfield, the bits missing from a short payload are cleared
+         */
+        static Bitfield from_bytes(std::span<const std::byte> payload, size_t size);
+
+        /**
+         * @brief Get the number of bits
+         *
+         * @return Number of bits
+         */
+        [[nodiscard]] size_t size() const { return size_; }
+
+        /**
+         * @brief Check if a bit is set
+         *
+         * @param index Index of the bit
+         * @return True if the bit is set
+         */
+        [[nodiscard]] bool test(size_t index) const {
+            assert(index < size_ && "Bit index out of bounds");
+            return (words_[index / WORD_BITS] & bit_mask(index)) != 0;
+        }
+
+        /**
+         * @brief Set a bit
+         *
+         * @param index Index of the bit
+         */
+        void set(size_t index) {
+            assert(index < size_ && "Bit index out of bounds");
+            words_[index / WORD_BITS] |= bit_mask(index);
+        }
+
+        /**
+         * @brief Clear a bit
+         *
+         * @param index Index of the bit
+         */
+        void reset(size_t index) {
+            assert(index < size_ && "Bit index out of bounds");
+            words_[index / WORD_BITS] &= ~bit_mask(index);
+        }
+
+        /**
+         * @brief Count the set bits
+         *
+         * @return Number of set bits
+         */
+        [[nodiscard]] size_t count() const;
+
+        /**
+         * @brief Check if every bit is set, e.g. if a peer is a seed
+         *
+         * @return True if every bit is set
+         */
+        [[nodiscard]] bool all() const;
+
+        /**
+         * @brief Get the bits that are set in this bitfield but not in another one, e.g. the
+         * pieces a peer has that we still need
+         *
+         * @param other Bitfield of the same size
+         * @return The difference of the bitfields
+         */
+        [[nodiscard]] Bitfield and_not(const Bitfield& other) const;
+
+        /**
+         * @brief Count the bits that are set in this bitfield but not in another one, without
+         * building the difference
+         *
+         * @param other Bitfield of the same size
+         * @return Number of bits only set in this bitfield
+         */
+        [[nodiscard]] size_t count_and_not(const Bitfield& other) const;
+
+        /**
+         * @brief Find the first set bit at or after a given index
+         *
+         * @param from Index to start the search from
+         * @return Index of the set bit, or size() if there is none
+         */
+        [[nodiscard]] size_t find_next_set(size_t from) const {
+            if (from >= size_) {
+                return size_;
+            }
+            size_t   word_index{from / WORD_BITS};
+            uint64_t word{words_[word_index] & (~0ULL >> (from % WORD_BITS))};
+            while (word == 0) {
+                if (++word_index == words_.size()) {
+                    return size_;
+                }
+                word = words_[word_index];
+            }
+            return word_index * WORD_BITS + std::countl_zero(word);
+        }
+
+        /**
+         * @brief Increment the counter of every set bit
+         *
+         * @param counters One counter per bit
+         */
+        void add_to(std::span<uint16_t> counters) const;
+
+        /**
+         * @brief Decrement the counter of every set bit
+         *
+         * @param counters One counter per bit
+         */
+        void subtract_from(std::span<uint16_t> counters) const;
+
+        /**
+         * @brief Get the packed bits
+         *
+         * @return A view of the words
+         */
+        [[nodiscard]] auto get_words() const -> std::span<const uint64_t> { return words_; }
+
+        bool operator==(const Bitfield& other) const = default;
+
+    private:
+        static constexpr size_t WORD_BITS{64};
+
+        /**
+         * @brief Get the mask of a bit in its word
+         *
+         * @param index Index of the bit
+         * @return Mask with only the bit set
+         */
+        static uint64_t bit_mask(size_t index) {
+            return 1ULL << (WORD_BITS - 1 - index % WORD_BITS);
+        }
+
+        size_t                size_{0};
+        std::vector<uint64_t> words_;
+};
+
+}  // namespace torrent
@@ -20,14 +20,51 @@ inline constexpr uint32_t MAX_PEER_COUNT{50U};
 
 inline constexpr size_t MAX_MEMPOOL_SIZE{1ULL << 29U};  // 512MB
 
+// Number of pieces that can be downloaded at once, unless more whole pieces fit in the memory pool.
+// The blocks are taken from the pool as they are requested, so a piece in progress only holds the
+// memory of its blocks in flight or received
+inline constexpr size_t ACTIVE_PIECES_CAPACITY{256U};
+
 namespace peer {
-    inline constexpr uint32_t MAX_BLOCKS_IN_FLIGHT{10U};
-    inline constexpr uint32_t MAX_BLOCKS_PER_REQUEST{5U};
+    // Depth of the request pipeline of a peer before its rate and round-trip time are measured
+    inline constexpr uint32_t INITIAL_BLOCKS_IN_FLIGHT{10U};
+    inline constexpr uint32_t MIN_BLOCKS_IN_FLIGHT{2U};
+    // The peers do not advertise the size of their request queue without the extension protocol,
+    // so the default reqq of the common clients is used
+    inline constexpr uint32_t MAX_BLOCKS_IN_FLIGHT{250U};
+    // The pipeline of a peer is refilled once 1 / REFILL_RATIO of its depth was received
+    inline constexpr uint32_t REFILL_RATIO{4U};
     inline constexpr uint32_t MAX_RETRIES{3U};
+    // A bitfield with at least 1 piece out of this many is counted all at once instead of piece by
+    // piece in the availability index
+    inline constexpr size_t DENSE_BITFIELD_RATIO{4U};
 }  // namespace peer
 
+namespace fs {
+    // Maximum number of pieces waiting to be written to disk
+    inline constexpr size_t MAX_QUEUED_WRITES{64U};
+    // Maximum number of blocks waiting to be written to disk when they are written as they arrive
+    inline constexpr size_t MAX_QUEUED_BLOCK_WRITES{1024U};
+    // Number of bytes of a written piece read back at once to be hashed
+    inline constexpr size_t READ_BACK_CHUNK_SIZE{1ULL << 20U};  // 1MB
+    // Number of queued bytes after which the disk thread stops waiting for more pieces to coalesce
+    inline constexpr size_t WRITE_COALESCE_BUDGET{1ULL << 24U};  // 16MB
+    // Number of submission queue entries of the io_uring storage
+    inline constexpr unsigned URING_QUEUE_DEPTH{256U};
+    // Number of bytes read ahead of the pieces being checked against their hashes
+    inline constexpr size_t VERIFY_READ_AHEAD{1ULL << 25U};  // 32MB
+    // Maximum number of bytes of pieces read before being hashed together
+    inline constexpr size_t VERIFY_BATCH_SIZE{1ULL << 23U};  // 8MB
+    // Extension appended to the name of the torrent to get the name of its resume file
+    inline constexpr std::string_view RESUME_FILE_EXTENSION{".resume"};
+}  // namespace fs
+
 namespace crypto {
     inline constexpr uint32_t SHA1_SIZE{20};
+    inline constexpr uint32_t SHA1_BLOCK_SIZE{64U};
+    inline constexpr uint32_t MAX_HASHER_THREADS{4U};
+    // Smallest batch of buffers worth hashing in the AVX2 lanes instead of the SHA extensions
+    inline constexpr size_t SHA1_MIN_AVX2_BATCH{4U};
 }
 
 namespace message {
@@ -38,6 +75,8 @@ namespace message {
     inline constexpr uint32_t         INFO_HASH_SIZE{crypto::SHA1_SIZE};
     inline constexpr uint32_t         PEER_ID_SIZE{20U};
     inline constexpr uint32_t         MAX_SENT_MSG_SIZE{17U};
+    // Size of the buffer the messages of a peer are received in, enough for several blocks
+    inline constexpr size_t RECEIVE_BUFFER_SIZE{1ULL << 17U};  // 128KB
 
 }  // namespace message
 
@@ -1,12 +1,503 @@
 #include "Crypto.hpp"
 
+#include "Error.hpp"
+
 #include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <openssl/evp.h>
 #include <openssl/sha.h>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#    include <cpuid.h>
+#    include <immintrin.h>
+#    define TORRENT_SHA1_X86
+#endif
 
 namespace torrent::crypto {
 
+namespace {
+
+    using Sha1State = std::array<uint32_t, 5>;
+
+    constexpr Sha1State SHA1_INIT_STATE{
+        0x67452301U, 0xEFCDAB89U, 0x98BADCFEU, 0x10325476U, 0xC3D2E1F0U
+    };
+
+    // The last blocks of a message: its trailing bytes, followed by the padding and the length
+    struct FinalBlocks {
+            std::array<uint8_t, 2 * SHA1_BLOCK_SIZE> data{};
+            size_t                                   blocks_cnt{};
+    };
+
+    /**
+     * @brief Build the final blocks of a message
+     *
+     * @param message The whole message
+     * @return The blocks that follow the full blocks of the message
+     */
+    FinalBlocks make_final_blocks(std::span<const uint8_t> message) {
+        FinalBlocks final_blocks;
+
+        auto tail{message.last(message.size() % SHA1_BLOCK_SIZE)};
+        std::ranges::copy(tail, final_blocks.data.begin());
+        final_blocks.data[tail.size()] = 0x80;
+
+        // The length takes the last 8 bytes of the last block
+        final_blocks.blocks_cnt = tail.size() + 1 + sizeof(uint64_t) > SHA1_BLOCK_SIZE ? 2 : 1;
+
+        uint64_t bits_cnt{static_cast<uint64_t>(message.size()) * 8};
+        auto     length_end{final_blocks.blocks_cnt * SHA1_BLOCK_SIZE};
+        for (size_t i{1}; i <= sizeof(uint64_t); ++i) {
+            final_blocks.data[length_end - i] = static_cast<uint8_t>(bits_cnt >> (8 * (i - 1)));
+        }
+
+        return final_blocks;
+    }
+
+    /**
+     * @brief Convert the state after the last block of a message to its hash
+     *
+     * @param state The state
+     * @param hash Where the big-endian words of the state are written
+     */
+    void store_state(const Sha1State& state, std::span<uint8_t, SHA1_SIZE> hash) {
+        for (size_t i{0}; i < state.size(); ++i) {
+            hash[4 * i]     = static_cast<uint8_t>(state[i] >> 24U);
+            hash[4 * i + 1] = static_cast<uint8_t>(state[i] >> 16U);
+            hash[4 * i + 2] = static_cast<uint8_t>(state[i] >> 8U);
+            hash[4 * i + 3] = static_cast<uint8_t>(state[i]);
+        }
+    }
+
+#ifdef TORRENT_SHA1_X86
+
+    // The alignment of the vector types does not matter for the arrays holding them
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wignored-attributes"
+
+    bool cpu_has_sha_ni() {
+        unsigned eax{};
+        unsigned ebx{};
+        unsigned ecx{};
+        unsigned edx{};
+        // Leaf 7 reports the SHA extensions in bit 29 of ebx
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) != 0 && (ebx & (1U << 29U)) != 0 &&
+               __builtin_cpu_supports("sse4.1");
+    }
+
+    bool cpu_has_avx2() { return __builtin_cpu_supports("avx2"); }
+
+    /**
+     * @brief Run 4 rounds of SHA-1 on interleaved streams with the SHA extensions
+     *
+     * @tparam Quad The index of the group of 4 rounds, the message words of groups 4 onwards are
+     * computed from the previous 16 words
+     */
+    template <int Quad, size_t Streams>
+    __attribute__((target("sha,sse4.1"), always_inline)) inline void sha_ni_quad(
+        std::array<__m128i, Streams>&                abcd,
+        std::array<__m128i, Streams>&                e0,
+        std::array<__m128i, Streams>&                e1,
+        std::array<std::array<__m128i, 4>, Streams>& msg
+    ) {
+        for (size_t s{0}; s < Streams; ++s) {
+            auto& words{msg[s]};
+            if constexpr (Quad >= 4) {
+                words[Quad % 4] = _mm_sha1msg2_epu32(
+                    _mm_xor_si128(
+                        _mm_sha1msg1_epu32(words[Quad % 4], words[(Quad + 1) % 4]),
+                        words[(Quad + 2) % 4]
+                    ),
+                    words[(Quad + 3) % 4]
+                );
+            }
+
+            // E alternates between two registers: one holds the E of these rounds, the other
+            // saves A to derive the E of the next rounds
+            auto& e_cur{Quad % 2 == 0 ? e0[s] : e1[s]};
+            auto& e_next{Quad % 2 == 0 ? e1[s] : e0[s]};
+            if constexpr (Quad == 0) {
+                e_cur = _mm_add_epi32(e_cur, words[0]);
+            } else {
+                e_cur = _mm_sha1nexte_epu32(e_cur, words[Quad % 4]);
+            }
+            e_next  = abcd[s];
+            abcd[s] = _mm_sha1rnds4_epu32(abcd[s], e_cur, Quad / 5);
+        }
+    }
+
+    /**
+     * @brief Run the 80 rounds of SHA-1 on interleaved streams with the SHA extensions
+     */
+    template <size_t Streams, int... Quads>
+    __attribute__((target("sha,sse4.1"), always_inline)) inline void sha_ni_rounds(
+        std::array<__m128i, Streams>&                abcd,
+        std::array<__m128i, Streams>&                e0,
+        std::array<__m128i, Streams>&                e1,
+        std::array<std::array<__m128i, 4>, Streams>& msg,
+        std::integer_sequence<int, Quads...> /*quads*/
+    ) {
+        (sha_ni_quad<Quads>(abcd, e0, e1, msg), ...);
+    }
+
+    /**
+     * @brief Hash blocks of several streams with the SHA extensions
+     * The streams are interleaved to hide the latency of the SHA instructions
+     *
+     * @param states The states of the streams
+     * @param blocks The blocks of each stream
+     * @param blocks_cnt The number of blocks to hash in each stream
+     */
+    template <size_t Streams>
+    __attribute__((target("sha,sse4.1"))) void sha_ni_compress(
+        std::array<Sha1State*, Streams>     states,
+        std::array<const uint8_t*, Streams> blocks,
+        size_t                              blocks_cnt
+    ) {
+        const __m128i byte_swap_mask{_mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL)};
+
+        std::array<__m128i, Streams>                abcd{};
+        std::array<__m128i, Streams>                e0{};
+        std::array<__m128i, Streams>                e1{};
+        std::array<std::array<__m128i, 4>, Streams> msg{};
+
+        for (size_t s{0}; s < Streams; ++s) {
+            auto& state{*states[s]};
+            abcd[s] = _mm_shuffle_epi32(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(state.data())), 0x1B
+            );
+            e0[s] = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+        }
+
+        for (size_t block{0}; block < blocks_cnt; ++block) {
+            auto abcd_save{abcd};
+            auto e0_save{e0};
+
+            for (size_t s{0}; s < Streams; ++s) {
+                for (size_t i{0}; i < 4; ++i) {
+                    msg[s][i] = _mm_shuffle_epi8(
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                            blocks[s] + block * SHA1_BLOCK_SIZE + 16 * i
+                        )),
+                        byte_swap_mask
+                    );
+                }
+            }
+
+            sha_ni_rounds(abcd, e0, e1, msg, std::make_integer_sequence<int, 20>{});
+
+            for (size_t s{0}; s < Streams; ++s) {
+                e0[s]   = _mm_sha1nexte_epu32(e0[s], e0_save[s]);
+                abcd[s] = _mm_add_epi32(abcd[s], abcd_save[s]);
+            }
+        }
+
+        for (size_t s{0}; s < Streams; ++s) {
+            auto& state{*states[s]};
+            _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(state.data()), _mm_shuffle_epi32(abcd[s], 0x1B)
+            );
+            state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0[s], 3));
+        }
+    }
+
+    /**
+     * @brief Hash the blocks of a message left after its first blocks, and its final blocks
+     *
+     * @param message The whole message
+     * @param hashed_blocks The number of blocks of the message already hashed
+     * @param state The state of the message
+     */
+    __attribute__((target("sha,sse4.1"))) void sha_ni_finish(
+        std::span<const uint8_t> message, size_t hashed_blocks, Sha1State& state
+    ) {
+        sha_ni_compress<1>(
+            {&state},
+            {message.data() + hashed_blocks * SHA1_BLOCK_SIZE},
+            message.size() / SHA1_BLOCK_SIZE - hashed_blocks
+        );
+
+        auto final_blocks{make_final_blocks(message)};
+        sha_ni_compress<1>({&state}, {final_blocks.data.data()}, final_blocks.blocks_cnt);
+    }
+
+    /**
+     * @brief Hash messages with the SHA extensions, two at a time
+     *
+     * @param data The messages
+     * @param states The states of the messages
+     */
+    void digest_many_sha_ni(
+        std::span<const std::span<const uint8_t>> data, std::span<Sha1State> states
+    ) {
+        size_t i{0};
+        for (; i + 1 < data.size(); i += 2) {
+            // Hash the blocks the two messages have in common together
+            auto common_blocks{std::min(data[i].size(), data[i + 1].size()) / SHA1_BLOCK_SIZE};
+            sha_ni_compress<2>(
+                {&states[i], &states[i + 1]}, {data[i].data(), data[i + 1].data()}, common_blocks
+            );
+
+            sha_ni_finish(data[i], common_blocks, states[i]);
+            sha_ni_finish(data[i + 1], common_blocks, states[i + 1]);
+        }
+
+        if (i < data.size()) {
+            sha_ni_finish(data[i], 0, states[i]);
+        }
+    }
+
+    constexpr size_t AVX2_LANES{8};
+
+    template <int Bits>
+    __attribute__((target("avx2"), always_inline)) inline __m256i rotl(__m256i x) {
+        return _mm256_or_si256(_mm256_slli_epi32(x, Bits), _mm256_srli_epi32(x, 32 - Bits));
+    }
+
+    /**
+     * @brief Load 32 bytes of each lane and transpose them, so each register holds the same word
+     * of every lane
+     *
+     * @param blocks The block of each lane
+     * @param offset The offset of the bytes in the blocks
+     * @param words Where the 8 transposed words are stored
+     */
+    __attribute__((target("avx2"), always_inline)) inline void load_transposed(
+        const std::array<const uint8_t*, AVX2_LANES>& blocks, size_t offset, __m256i* words
+    ) {
+        const __m256i byte_swap_mask{_mm256_setr_epi8(
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+            3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+        )};
+
+        std::array<__m256i, AVX2_LANES> rows{};
+        for (size_t lane{0}; lane < AVX2_LANES; ++lane) {
+            rows[lane] =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(blocks[lane] + offset));
+        }
+
+        auto t0{_mm256_unpacklo_epi32(rows[0], rows[1])};
+        auto t1{_mm256_unpackhi_epi32(rows[0], rows[1])};
+        auto t2{_mm256_unpacklo_epi32(rows[2], rows[3])};
+        auto t3{_mm256_unpackhi_epi32(rows[2], rows[3])};
+        auto t4{_mm256_unpacklo_epi32(rows[4], rows[5])};
+        auto t5{_mm256_unpackhi_epi32(rows[4], rows[5])};
+        auto t6{_mm256_unpacklo_epi32(rows[6], rows[7])};
+        auto t7{_mm256_unpackhi_epi32(rows[6], rows[7])};
+
+        auto u0{_mm256_unpacklo_epi64(t0, t2)};
+        auto u1{_mm256_unpackhi_epi64(t0, t2)};
+        auto u2{_mm256_unpacklo_epi64(t1, t3)};
+        auto u3{_mm256_unpackhi_epi64(t1, t3)};
+        auto u4{_mm256_unpacklo_epi64(t4, t6)};
+        auto u5{_mm256_unpackhi_epi64(t4, t6)};
+        auto u6{_mm256_unpacklo_epi64(t5, t7)};
+        auto u7{_mm256_unpackhi_epi64(t5, t7)};
+
+        words[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+        words[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+        words[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+        words[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+        words[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+        words[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+        words[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+        words[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+
+        for (size_t i{0}; i < AVX2_LANES; ++i) {
+            words[i] = _mm256_shuffle_epi8(words[i], byte_swap_mask);
+        }
+    }
+
+    /**
+     * @brief Run one round of SHA-1 on every lane
+     *
+     * @tparam Round The index of the round
+     */
+    template <int Round>
+    __attribute__((target("avx2"), always_inline)) inline void avx2_round(
+        std::array<__m256i, 5>& vars, std::array<__m256i, 16>& w
+    ) {
+        auto& [a, b, c, d, e] = vars;
+
+        if constexpr (Round >= 16) {
+            w[Round % 16] = rotl<1>(_mm256_xor_si256(
+                _mm256_xor_si256(w[(Round - 3) % 16], w[(Round - 8) % 16]),
+                _mm256_xor_si256(w[(Round - 14) % 16], w[Round % 16])
+            ));
+        }
+
+        __m256i  f;
+        uint32_t k{};
+        if constexpr (Round < 20) {
+            // (b & c) | (~b & d)
+            f = _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d)));
+            k = 0x5A827999U;
+        } else if constexpr (Round < 40) {
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            k = 0x6ED9EBA1U;
+        } else if constexpr (Round < 60) {
+            // (b & c) | (b & d) | (c & d)
+            f = _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+            k = 0x8F1BBCDCU;
+        } else {
+            f = _mm256_xor_si256(_mm256_xor_si256(b, c), d);
+            k = 0xCA62C1D6U;
+        }
+
+        auto k_w{_mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(k)), w[Round % 16])};
+        auto temp{_mm256_add_epi32(_mm256_add_epi32(rotl<5>(a), f), _mm256_add_epi32(e, k_w))};
+        e = d;
+        d = c;
+        c = rotl<30>(b);
+        b = a;
+        a = temp;
+    }
+
+    /**
+     * @brief Run the 80 rounds of SHA-1 on every lane
+     */
+    template <int... Rounds>
+    __attribute__((target("avx2"), always_inline)) inline void avx2_rounds(
+        std::array<__m256i, 5>&  vars,
+        std::array<__m256i, 16>& w,
+        std::integer_sequence<int, Rounds...> /*rounds*/
+    ) {
+        (avx2_round<Rounds>(vars, w), ...);
+    }
+
+    /**
+     * @brief Hash blocks of eight messages at once, one per 32-bit lane of the AVX2 registers
+     *
+     * @param states The states of the messages
+     * @param blocks The blocks of each message
+     * @param blocks_cnt The number of blocks to hash in each message
+     */
+    __attribute__((target("avx2"))) void avx2_compress(
+        std::array<Sha1State, AVX2_LANES>&     states,
+        std::array<const uint8_t*, AVX2_LANES> blocks,
+        size_t                                 blocks_cnt
+    ) {
+        std::array<__m256i, 5> state{};
+        for (size_t i{0}; i < state.size(); ++i) {
+            alignas(32) std::array<uint32_t, AVX2_LANES> lanes{};
+            for (size_t lane{0}; lane < AVX2_LANES; ++lane) {
+                lanes[lane] = states[lane][i];
+            }
+            state[i] = _mm256_load_si256(reinterpret_cast<const __m256i*>(lanes.data()));
+        }
+
+        for (size_t block{0}; block < blocks_cnt; ++block) {
+            std::array<__m256i, 16> w{};
+            load_transposed(blocks, 0, w.data());
+            load_transposed(blocks, SHA1_BLOCK_SIZE / 2, w.data() + AVX2_LANES);
+
+            auto vars{state};
+            avx2_rounds(vars, w, std::make_integer_sequence<int, 80>{});
+
+            for (size_t i{0}; i < state.size(); ++i) {
+                state[i] = _mm256_add_epi32(state[i], vars[i]);
+            }
+
+            for (auto& lane_block : blocks) {
+                lane_block += SHA1_BLOCK_SIZE;
+            }
+        }
+
+        for (size_t i{0}; i < state.size(); ++i) {
+            alignas(32) std::array<uint32_t, AVX2_LANES> lanes{};
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes.data()), state[i]);
+            for (size_t lane{0}; lane < AVX2_LANES; ++lane) {
+                states[lane][i] = lanes[lane];
+            }
+        }
+    }
+
+    /**
+     * @brief Hash messages with AVX2, eight at a time
+     * The lanes that run out of blocks hash the blocks of another lane, and their state is
+     * restored afterwards
+     *
+     * @param data The messages
+     * @param states The states of the messages
+     */
+    void digest_many_avx2(
+        std::span<const std::span<const uint8_t>> data, std::span<Sha1State> states
+    ) {
+        for (size_t first{0}; first < data.size(); first += AVX2_LANES) {
+            auto group_size{std::min(AVX2_LANES, data.size() - first)};
+
+            std::array<Sha1State, AVX2_LANES>                lane_states{};
+            std::array<std::span<const uint8_t>, AVX2_LANES> messages{};
+            std::array<FinalBlocks, AVX2_LANES>              final_blocks{};
+            // Number of blocks hashed in each lane, the final blocks included
+            std::array<size_t, AVX2_LANES> hashed_blocks{};
+
+            for (size_t lane{0}; lane < AVX2_LANES; ++lane) {
+                // The unused lanes hash the first message again, and their result is dropped
+                messages[lane]     = data[first + (lane < group_size ? lane : 0)];
+                lane_states[lane]  = SHA1_INIT_STATE;
+                final_blocks[lane] = make_final_blocks(messages[lane]);
+            }
+
+            while (true) {
+                std::array<const uint8_t*, AVX2_LANES> blocks{};
+                std::array<size_t, AVX2_LANES>         available{};
+
+                // Find the blocks each lane can hash in one go, either in the message itself or
+                // in its final blocks
+                for (size_t lane{0}; lane < AVX2_LANES; ++lane) {
+                    auto full_blocks{messages[lane].size() / SHA1_BLOCK_SIZE};
+                    if (hashed_blocks[lane] < full_blocks) {
+                        blocks[lane] =
+                            messages[lane].data() + hashed_blocks[lane] * SHA1_BLOCK_SIZE;
+                        available[lane] = full_blocks - hashed_blocks[lane];
+                    } else {
+                        auto final_hashed{hashed_blocks[lane] - full_blocks};
+                        blocks[lane] =
+                            final_blocks[lane].data.data() + final_hashed * SHA1_BLOCK_SIZE;
+                        available[lane] = final_blocks[lane].blocks_cnt - final_hashed;
+                    }
+                }
+
+                auto active_lane{std::ranges::find_if(available, [](auto n) { return n > 0; })};
+                if (active_lane == available.end()) {
+                    break;
+                }
+
+                size_t run{*active_lane};
+                for (size_t lane{0}; lane < AVX2_LANES; ++lane) {
+                    if (available[lane] > 0) {
+                        run = std::min(run, available[lane]);
+                    } else {
+                        // Finished lanes follow an active lane, whose blocks are valid to read
+                        blocks[lane] = blocks[active_lane - available.begin()];
+                    }
+                }
+
+                auto saved_states{lane_states};
+                avx2_compress(lane_states, blocks, run);
+
+                for (size_t lane{0}; lane < AVX2_LANES; ++lane) {
+                    if (available[lane] > 0) {
+                        hashed_blocks[lane] += run;
+                    } else {
+                        lane_states[lane] = saved_states[lane];
+                    }
+                }
+            }
+
+            std::copy_n(lane_states.begin(), group_size, states.begin() + first);
+        }
+    }
+
+#    pragma GCC diagnostic pop
+
+#endif  // TORRENT_SHA1_X86
+
+}  // namespace
+
 [[nodiscard]] Sha1 Sha1::digest(std::span<const uint8_t> data) {
     Sha1 digest{};
 
@@ -19,4 +510,91 @@ namespace torrent::crypto {
     return Sha1::digest(std::span<const uint8_t>(data, count));
 }
 
+[[nodiscard]] std::vector<Sha1> Sha1::digest_many(
+    std::span<const std::span<const uint8_t>> data, Sha1Backend backend
+) {
+    if (!is_backend_supported(backend)) {
+        err::throw_with_trace("SHA-1 backend not supported by the CPU");
+    }
+
+    std::vector<Sha1> digests(data.size());
+
+    if (backend == Sha1Backend::OPENSSL) {
+        for (size_t i{0}; i < data.size(); ++i) {
+            digests[i] = digest(data[i]);
+        }
+        return digests;
+    }
+
+#ifdef TORRENT_SHA1_X86
+    std::vector<Sha1State> states(data.size(), SHA1_INIT_STATE);
+
+    if (backend == Sha1Backend::SHA_NI) {
+        digest_many_sha_ni(data, states);
+    } else {
+        digest_many_avx2(data, states);
+    }
+
+    for (size_t i{0}; i < data.size(); ++i) {
+        store_state(states[i], digests[i].hash_);
+    }
+#endif
+
+    return digests;
+}
+
+[[nodiscard]] Sha1Backend Sha1::best_backend(size_t batch_size) {
+    // Eight AVX2 lanes hash about twice as fast as the SHA extensions on one core, as long as
+    // enough of them are busy
+    if (batch_size >= SHA1_MIN_AVX2_BATCH && is_backend_supported(Sha1Backend::AVX2)) {
+        return Sha1Backend::AVX2;
+    }
+    if (is_backend_supported(Sha1Backend::SHA_NI)) {
+        return Sha1Backend::SHA_NI;
+    }
+    return Sha1Backend::OPENSSL;
+}
+
+[[nodiscard]] bool Sha1::is_backend_supported(Sha1Backend backend) {
+    switch (backend) {
+        case Sha1Backend::OPENSSL:
+            return true;
+#ifdef TORRENT_SHA1_X86
+        case Sha1Backend::SHA_NI: {
+            static const bool supported{cpu_has_sha_ni()};
+            return supported;
+        }
+        case Sha1Backend::AVX2: {
+            static const bool supported{cpu_has_avx2()};
+            return supported;
+        }
+#endif
+        default:
+            return false;
+    }
+}
+
+Sha1Context::Sha1Context() : ctx_{EVP_MD_CTX_new()} {
+    if (!ctx_ || EVP_DigestInit_ex(ctx_.get(), EVP_sha1(), nullptr) != 1) {
+        err::throw_with_trace("Failed to initialize the SHA-1 context");
+    }
+}
+
+void Sha1Context::update(std::span<const uint8_t> data) {
+    if (EVP_DigestUpdate(ctx_.get(), data.data(), data.size()) != 1) {
+        err::throw_with_trace("Failed to update the SHA-1 context");
+    }
+}
+
+[[nodiscard]] Sha1 Sha1Context::finalize() {
+    std::array<uint8_t, SHA1_SIZE> hash{};
+    if (EVP_DigestFinal_ex(ctx_.get(), hash.data(), nullptr) != 1) {
+        err::throw_with_trace("Failed to finalize the SHA-1 context");
+    }
+
+    return Sha1::from_raw_data(hash);
+}
+
+void Sha1Context::ContextDeleter::operator()(evp_md_ctx_st* ctx) const { EVP_MD_CTX_free(ctx); }
+
 }  // namespace torrent::crypto
@@ -6,10 +6,25 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <span>
+#include <vector>
+
+// Forward declaration of the OpenSSL digest context, so the OpenSSL headers are not needed here
+struct evp_md_ctx_st;
 
 namespace torrent::crypto {
 
+// Implementations of SHA-1 used to hash several buffers at once
+enum class Sha1Backend : uint8_t {
+    // One buffer at a time with OpenSSL
+    OPENSSL,
+    // Two interleaved buffers at a time with the SHA extensions of x86 CPUs
+    SHA_NI,
+    // Eight buffers at a time, one per 32-bit lane of the AVX2 registers
+    AVX2
+};
+
 class Sha1 {
     public:
         Sha1()                       = default;
@@ -60,6 +75,47 @@ class Sha1 {
          */
         [[nodiscard]] static Sha1 digest(const uint8_t* data, size_t count);
 
+        /**
+         * @brief Compute the SHA-1 hashes of several buffers at once
+         *
+         * @param data The buffers to hash
+         * @return The SHA-1 hash of each buffer, in the same order
+         * @note The buffers are hashed together, so batches of buffers of similar sizes are the
+         * most efficient
+         */
+        [[nodiscard]] static std::vector<Sha1> digest_many(
+            std::span<const std::span<const uint8_t>> data
+        ) {
+            return digest_many(data, best_backend(data.size()));
+        }
+
+        /**
+         * @brief Compute the SHA-1 hashes of several buffers at once with a given implementation
+         *
+         * @param data The buffers to hash
+         * @param backend The implementation used to hash the buffers
+         * @return The SHA-1 hash of each buffer, in the same order
+         */
+        [[nodiscard]] static std::vector<Sha1> digest_many(
+            std::span<const std::span<const uint8_t>> data, Sha1Backend backend
+        );
+
+        /**
+         * @brief Get the fastest implementation of digest_many supported by the CPU for a batch
+         *
+         * @param batch_size The number of buffers hashed at once
+         * @return The implementation
+         */
+        [[nodiscard]] static Sha1Backend best_backend(size_t batch_size);
+
+        /**
+         * @brief Check if an implementation of digest_many is supported by the CPU
+         *
+         * @param backend The implementation
+         * @return True if the implementation can be used
+         */
+        [[nodiscard]] static bool is_backend_supported(Sha1Backend backend);
+
         /**
          * @brief Get a view to the underlying hash
          *
@@ -75,4 +131,39 @@ class Sha1 {
         std::array<uint8_t, SHA1_SIZE> hash_{};
 };
 
+class Sha1Context {
+    public:
+        /**
+         * @brief Create a context to compute a SHA-1 hash incrementally
+         */
+        Sha1Context();
+        Sha1Context(const Sha1Context&)            = delete;
+        Sha1Context(Sha1Context&&)                 = default;
+        Sha1Context& operator=(const Sha1Context&) = delete;
+        Sha1Context& operator=(Sha1Context&&)      = default;
+        ~Sha1Context()                             = default;
+
+        /**
+         * @brief Hash the next chunk of data
+         *
+         * @param data A span of the data to hash
+         */
+        void update(std::span<const uint8_t> data);
+
+        /**
+         * @brief Get the SHA-1 hash of all the data hashed so far
+         *
+         * @return The SHA-1 hash
+         * @note The context must not be updated afterwards
+         */
+        [[nodiscard]] Sha1 finalize();
+
+    private:
+        struct ContextDeleter {
+                void operator()(evp_md_ctx_st* ctx) const;
+        };
+
+        std::unique_ptr<evp_md_ctx_st, ContextDeleter> ctx_;
+};
+
 }  // namespace torrent::crypto
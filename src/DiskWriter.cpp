@@ -0,0 +1,159 @@
+#include "DiskWriter.hpp"
+
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace torrent::fs {
+
+DiskWriter::DiskWriter(
+    std::shared_ptr<FileManager> file_manager,
+    size_t                       queue_capacity,
+    std::chrono::milliseconds    coalesce_window
+)
+    : file_manager_{std::move(file_manager)},
+      queue_capacity_{queue_capacity},
+      coalesce_window_{coalesce_window},
+      disk_thread_{[this](std::stop_token stop_token) { run(std::move(stop_token)); }} {}
+
+DiskWriter::~DiskWriter() {
+    disk_thread_.request_stop();
+    if (disk_thread_.joinable()) {
+        disk_thread_.join();
+    }
+}
+
+void DiskWriter::submit(WriteJob job) {
+    std::unique_lock lock(queue_mutex_);
+    queue_not_full_.wait(lock, [this] { return queue_.size() < queue_capacity_; });
+    enqueue(lock, std::move(job));
+}
+
+bool DiskWriter::try_submit(WriteJob& job) {
+    std::unique_lock lock(queue_mutex_);
+    if (queue_.size() >= queue_capacity_) {
+        return false;
+    }
+    enqueue(lock, std::move(job));
+    return true;
+}
+
+void DiskWriter::enqueue(std::unique_lock<std::mutex>& lock, WriteJob job) {
+    for (auto buffer : job.buffers) {
+        queued_bytes_ += buffer.size();
+    }
+    queue_.push_back({std::move(job), std::chrono::steady_clock::now()});
+    queue_depth_.fetch_add(1, std::memory_order_relaxed);
+
+    lock.unlock();
+    queue_not_empty_.notify_one();
+}
+
+void DiskWriter::wait_idle() {
+    std::unique_lock lock(queue_mutex_);
+    queue_idle_.wait(lock, [this] { return queue_.empty() && !writing_; });
+}
+
+void DiskWriter::run(std::stop_token stop_token) {
+    std::vector<QueuedJob> batch;
+
+    while (true) {
+        std::unique_lock lock(queue_mutex_);
+
+        // Only returns false if a stop was requested and there is nothing left to write
+        if (!queue_not_empty_.wait(lock, stop_token, [this] { return !queue_.empty(); })) {
+            return;
+        }
+
+        // Give the pieces that complete close together a chance to be merged into one write,
+        // unless there is already enough data queued
+        queue_not_empty_.wait_until(
+            lock,
+            stop_token,
+            std::chrono::steady_clock::now() + coalesce_window_,
+            [this] {
+                return queued_bytes_ >= WRITE_COALESCE_BUDGET || queue_.size() >= queue_capacity_;
+            }
+        );
+
+        // Take all the queued jobs, so they can be submitted to the storage as one batch
+        batch.assign(
+            std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.end())
+        );
+        queue_.clear();
+        queued_bytes_ = 0;
+        writing_      = true;
+
+        lock.unlock();
+        queue_not_full_.notify_all();
+
+        write_batch(batch);
+        batch.clear();
+
+        lock.lock();
+        writing_ = false;
+        if (queue_.empty()) {
+            queue_idle_.notify_all();
+        }
+    }
+}
+
+void DiskWriter::write_batch(std::vector<QueuedJob>& batch) {
+    std::ranges::sort(batch, {}, [](const QueuedJob& queued_job) { return queued_job.job.offset; });
+
+    // If any write of the batch fails, the whole batch is reported as failed, since the storage
+    // might not tell which one of them did
+    bool written{true};
+    try {
+        std::vector<std::span<const char>> buffers;
+
+        for (size_t range_begin{0}; range_begin < batch.size();) {
+            // Merge the jobs that continue exactly where the previous one ended
+            size_t range_offset{batch[range_begin].job.offset};
+            size_t range_end{range_offset};
+
+            buffers.clear();
+            for (; range_begin < batch.size() && batch[range_begin].job.offset == range_end;
+                 ++range_begin) {
+                for (auto buffer : batch[range_begin].job.buffers) {
+                    buffers.push_back(buffer);
+                    range_end += buffer.size();
+                }
+            }
+
+            if (!buffers.empty()) {
+                file_manager_->writev(buffers, range_offset);
+            }
+        }
+        file_manager_->flush();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to write a batch of {} jobs: {}", batch.size(), e.what());
+        written = false;
+    }
+
+    auto now{std::chrono::steady_clock::now()};
+
+    for (auto& [job, submit_time] : batch) {
+        // Update the average write latency (EWMA with a weight of 1/8 for the new sample)
+        auto latency{std::chrono::duration_cast<std::chrono::microseconds>(now - submit_time)};
+        auto avg_latency_us{write_latency_us_.load(std::memory_order_relaxed)};
+        write_latency_us_.store(
+            avg_latency_us + (latency.count() - avg_latency_us) / 8, std::memory_order_relaxed
+        );
+
+        if (job.on_complete) {
+            job.on_complete(written);
+        }
+
+        queue_depth_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+}  // namespace torrent::fs
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "Constant.hpp"
+#include "Duration.hpp"
+#include "FileManager.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace torrent::fs {
+
+class DiskWriter {
+    public:
+        struct WriteJob {
+                // The data to write, e.g. the blocks of a piece, written one after the other. It
+                // must stay valid until the completion handler is called. A job without data only
+                // runs its completion handler on the disk thread
+                std::vector<std::span<const char>> buffers;
+                // The offset in the torrent at which the first buffer will be written
+                size_t offset{};
+                // Called on the disk thread once the job is done, with true if the data was written
+                std::function<void(bool)> on_complete;
+        };
+
+        /**
+         * @brief Start the disk thread
+         *
+         * @param file_manager    the file manager used to write the data
+         * @param queue_capacity  the maximum number of queued jobs
+         * @param coalesce_window how long the disk thread waits for more jobs to arrive before
+         * writing, so that adjacent jobs can be merged into a single vectored write
+         */
+        explicit DiskWriter(
+            std::shared_ptr<FileManager> file_manager,
+            size_t                       queue_capacity  = MAX_QUEUED_WRITES,
+            std::chrono::milliseconds    coalesce_window = duration::WRITE_COALESCE_WINDOW
+        );
+
+        DiskWriter(const DiskWriter&)            = delete;
+        DiskWriter& operator=(const DiskWriter&) = delete;
+        DiskWriter(DiskWriter&&)                 = delete;
+        DiskWriter& operator=(DiskWriter&&)      = delete;
+
+        /**
+         * @brief Stop the disk thread after all the queued jobs have been written
+         */
+        ~DiskWriter();
+
+        /**
+         * @brief Queue a write job
+         *
+         * @param job the job to queue
+         * @note If the queue is full, the call blocks until the disk thread frees a slot, so it is
+         * only meant for the threads that can wait for the disk, e.g. the hasher threads
+         */
+        void submit(WriteJob job);
+
+        /**
+         * @brief Queue a write job if the queue has room for it, without blocking
+         *
+         * @param job the job to queue, left untouched if the queue is full
+         * @return true if the job was queued, false if the queue is full
+         * @note Meant for the threads that must not wait for the disk, e.g. the network thread,
+         * which keep the job and stop producing data until the queue drains
+         */
+        bool try_submit(WriteJob& job);
+
+        /**
+         * @brief Block until every queued job has been written
+         */
+        void wait_idle();
+
+        /**
+         * @brief Get the number of jobs that have been queued but not yet written
+         *
+         * @return the number of pending jobs
+         * @note This function is thread-safe
+         */
+        [[nodiscard]] size_t get_queue_depth() const {
+            return queue_depth_.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief Get the average latency of a write, measured from submission to completion
+         *
+         * @return the exponentially weighted average write latency
+         * @note This function is thread-safe
+         */
+        [[nodiscard]] auto get_write_latency() const -> std::chrono::microseconds {
+            return std::chrono::microseconds{write_latency_us_.load(std::memory_order_relaxed)};
+        }
+
+    private:
+        struct QueuedJob {
+                WriteJob                              job;
+                std::chrono::steady_clock::time_point submit_time;
+        };
+
+        /**
+         * @brief Main loop of the disk thread
+         *
+         * @param stop_token token used to stop the thread once the queue is drained
+         */
+        void run(std::stop_token stop_token);
+
+        /**
+         * @brief Write a batch of jobs, merging the jobs that are contiguous in the torrent
+         *
+         * @param batch the jobs to write
+         */
+        void write_batch(std::vector<QueuedJob>& batch);
+
+        /**
+         * @brief Append a job to the queue and wake the disk thread up
+         *
+         * @param lock the lock of the queue, which is released
+         * @param job  the job to queue
+         */
+        void enqueue(std::unique_lock<std::mutex>& lock, WriteJob job);
+
+        std::shared_ptr<FileManager> file_manager_;
+        size_t                       queue_capacity_;
+        std::chrono::milliseconds    coalesce_window_;
+
+        std::mutex                  queue_mutex_;
+        std::condition_variable_any queue_not_empty_;
+        std::condition_variable     queue_not_full_;
+        std::condition_variable     queue_idle_;
+        std::deque<QueuedJob>       queue_;
+        size_t                      queued_bytes_{0};
+        // Set while the disk thread is writing a job that has already been popped from the queue
+        bool writing_{false};
+
+        std::atomic<size_t>  queue_depth_{0};
+        std::atomic<int64_t> write_latency_us_{0};
+
+        // Must be the last member, so the thread is joined before the other members are destroyed
+        std::jthread disk_thread_;
+};
+
+}  // namespace torrent::fs
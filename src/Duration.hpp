@@ -9,9 +9,16 @@ inline constexpr std::chrono::seconds      CONNECTION_TIMEOUT{15};
 inline constexpr std::chrono::seconds      SEND_MSG_TIMEOUT{10};
 inline constexpr std::chrono::seconds      RECEIVE_MSG_TIMEOUT{40};
 inline constexpr std::chrono::seconds      REQUEST_TIMEOUT{5};
+inline constexpr std::chrono::milliseconds MIN_REQUEST_TIMEOUT{500};
+inline constexpr std::chrono::seconds      MAX_REQUEST_TIMEOUT{30};
 inline constexpr std::chrono::seconds      PEER_CLEANUP_INTERVAL{10};
 inline constexpr std::chrono::milliseconds REQUEST_INTERVAL{100};
+inline constexpr std::chrono::seconds      REQUEST_QUEUE_TIME{1};
+inline constexpr std::chrono::seconds      RATE_WINDOW{1};
+inline constexpr std::chrono::seconds      FAST_PEER_PIECE_TIME{2};
 inline constexpr std::chrono::milliseconds PROGRESS_BAR_REFRESH_RATE{1'000};
 inline constexpr std::chrono::seconds      UDP_TRACKER_TIMEOUT{60};
+inline constexpr std::chrono::milliseconds WRITE_COALESCE_WINDOW{5};
+inline constexpr std::chrono::seconds      RESUME_SAVE_INTERVAL{10};
 
 }  // namespace torrent::duration
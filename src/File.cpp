@@ -1,39 +1,93 @@
 #include "File.hpp"
 
 #include "Error.hpp"
+#include "FileUtils.hpp"
 
-#include <filesystem>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
 #include <format>
+#include <ranges>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
 
 namespace torrent::fs {
 
-File::File(const std::filesystem::path& path, size_t length) : length_{length} {
-    // create directories if they don't exist
-    try {
-        std::filesystem::create_directories(path.parent_path());
-    } catch (const std::exception& e) {
-        err::throw_with_trace(
-            std::format("Failed to create directories for file: {} ({})", path.string(), e.what())
-        );
+File::File(const std::filesystem::path& path, size_t length)
+    : fd_{open_file(path)}, length_{length} {}
+
+File::~File() {
+    if (fd_ >= 0) {
+        ::close(fd_);
     }
+}
 
-    file_.open(path, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+File::File(File&& other) noexcept : fd_{std::exchange(other.fd_, -1)}, length_{other.length_} {}
 
-    if (!file_.is_open()) {
-        err::throw_with_trace(std::format("Failed to open file: {}", path.string()));
+File& File::operator=(File&& other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_     = std::exchange(other.fd_, -1);
+        length_ = other.length_;
     }
+    return *this;
 }
 
-File::~File() {
-    file_.close();
+void File::write(std::span<const char> data, size_t offset) {
+    writev(std::span<const std::span<const char>>(&data, 1), offset);
 }
 
-void File::write(std::span<const char> data, size_t offset) {
-    file_.seekp(offset, std::ios::beg);
+void File::writev(std::span<const std::span<const char>> buffers, size_t offset) {
+    std::vector<iovec> iovecs{
+        buffers | std::views::filter([](auto buffer) { return !buffer.empty(); }) |
+        std::views::transform([](auto buffer) {
+            return iovec{const_cast<char*>(buffer.data()), buffer.size()};
+        }) |
+        std::ranges::to<std::vector<iovec>>()
+    };
 
-    if (!file_.write(data.data(), data.size())) {
-        err::throw_with_trace("Failed to write to file");
+    std::span<iovec> remaining{iovecs};
+
+    while (!remaining.empty()) {
+        ssize_t written{::pwritev(
+            fd_,
+            remaining.data(),
+            static_cast<int>(std::min(remaining.size(), static_cast<size_t>(IOV_MAX))),
+            static_cast<off_t>(offset)
+        )};
+
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            err::throw_with_trace(
+                std::format("Failed to write to file: {}", std::strerror(written < 0 ? errno : EIO))
+            );
+        }
+
+        offset += static_cast<size_t>(written);
+
+        // Skip the buffers that have been written entirely, and advance into the partially
+        // written one
+        auto left{static_cast<size_t>(written)};
+        while (!remaining.empty() && left >= remaining.front().iov_len) {
+            left -= remaining.front().iov_len;
+            remaining = remaining.subspan(1);
+        }
+        if (left > 0) {
+            remaining.front().iov_base = static_cast<char*>(remaining.front().iov_base) + left;
+            remaining.front().iov_len -= left;
+        }
     }
 }
 
+void File::read(std::span<char> data, size_t offset) const {
+    read_at(fd_, data, offset);
+}
+
 };  // namespace torrent::fs
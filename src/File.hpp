@@ -1,7 +1,8 @@
 #pragma once
 
+#include "FileUtils.hpp"
+
 #include <filesystem>
-#include <fstream>
 #include <span>
 
 namespace torrent::fs {
@@ -11,10 +12,10 @@ class File {
         File(const std::filesystem::path& path, size_t length);
         ~File();
 
-        File(const File&)                = delete;
-        File& operator=(const File&)     = delete;
-        File(File&&) noexcept            = default;
-        File& operator=(File&&) noexcept = default;
+        File(const File&)            = delete;
+        File& operator=(const File&) = delete;
+        File(File&& other) noexcept;
+        File& operator=(File&& other) noexcept;
 
         /**
          * @brief Write data to the file at a given offset
@@ -26,6 +27,42 @@ class File {
          */
         void write(std::span<const char> data, std::size_t offset = 0);
 
+        /**
+         * @brief Write multiple buffers to the file, one after the other, from a given offset
+         * The buffers are written with as few pwritev calls as possible
+         *
+         * @param buffers the buffers to write
+         * @param offset  the offset to write the first buffer at
+         * @note The offset is not checked against the length of the file. If the offset is greater
+         * than the length of the file, the file will be extended.
+         */
+        void writev(std::span<const std::span<const char>> buffers, std::size_t offset = 0);
+
+        /**
+         * @brief Read data from the file at a given offset
+         *
+         * @param data    the buffer to read the data into
+         * @param offset  the offset to read the data from
+         * @note The part of the buffer past the end of the file is filled with zeros
+         */
+        void read(std::span<char> data, std::size_t offset = 0) const;
+
+        /**
+         * @brief Tell the kernel how a range of the file is going to be accessed
+         *
+         * @param offset the offset of the range
+         * @param length the length of the range
+         * @param advice the expected access
+         */
+        void advise(std::size_t offset, std::size_t length, AccessAdvice advice) const {
+            advise_file(fd_, offset, length, advice);
+        }
+
+        /**
+         * @brief Wait until the data written to the file has reached the disk
+         */
+        void sync() const { sync_file(fd_); }
+
         /**
          * @brief Get the length of the file
          *
@@ -34,8 +71,8 @@ class File {
         size_t get_length() const { return length_; }
 
     private:
-        std::fstream file_;
-        size_t       length_;
+        int    fd_{-1};
+        size_t length_;
 };
 
 }  // namespace torrent::fs
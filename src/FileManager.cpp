@@ -1,40 +1,108 @@
 #include "FileManager.hpp"
 
-#include "File.hpp"
+#include "Logger.hpp"
+#include "MmapStorage.hpp"
+#include "SyncStorage.hpp"
+#ifdef TORRENT_IO_URING
+#    include "UringStorage.hpp"
+#endif
 
+#include <algorithm>
+#include <exception>
 #include <numeric>
 #include <ranges>
+#include <vector>
+
+namespace {
+
+using torrent::fs::IStorage;
+using torrent::fs::StorageType;
+
+std::unique_ptr<IStorage> create_storage(
+    StorageType                            storage_type,
+    std::span<const torrent::md::FileInfo> files_info,
+    const std::filesystem::path&           dest_dir
+) {
+    switch (storage_type) {
+        case StorageType::IO_URING:
+#ifdef TORRENT_IO_URING
+            try {
+                return std::make_unique<torrent::fs::UringStorage>(files_info, dest_dir);
+            } catch (const std::exception& e) {
+                LOG_WARN("io_uring storage unavailable, using sync storage instead: {}", e.what());
+            }
+#else
+            LOG_WARN("Built without io_uring support, falling back to sync storage");
+#endif
+            break;
+
+        case StorageType::MMAP:
+            return std::make_unique<torrent::fs::MmapStorage>(files_info, dest_dir);
+
+        case StorageType::SYNC:
+            break;
+    }
+
+    return std::make_unique<torrent::fs::SyncStorage>(files_info, dest_dir);
+}
+
+}  // namespace
 
 namespace torrent::fs {
 FileManager::FileManager(
-    std::span<const md::FileInfo> files_info, const std::filesystem::path& dest_dir
+    std::span<const md::FileInfo> files_info,
+    const std::filesystem::path&  dest_dir,
+    StorageType                   storage_type,
+    AllocationPolicy              allocation_policy,
+    bool                          keep_existing
 ) {
     for (const auto& file_info : files_info) {
-        const std::filesystem::path file_path{dest_dir / file_info.path};
-
-        files_.emplace_back(file_info.start_off, File{file_path, file_info.length});
+        files_.emplace_back(file_info.start_off, file_info.length);
     }
+
+    // Reserve the space of the files before the storage opens them
+    allocate_files(files_info, dest_dir, allocation_policy, keep_existing);
+
+    storage_ = create_storage(storage_type, files_info, dest_dir);
 }
 
-void FileManager::write(std::span<const char> data, size_t offset) {
+void FileManager::writev(std::span<const std::span<const char>> buffers, size_t offset) {
     size_t file_index{0};
 
     // find the first file that contains the offset
-    while (offset > files_[file_index].first + files_[file_index].second.get_length()) {
+    while (offset >= files_[file_index].first + files_[file_index].second) {
         ++file_index;
     }
 
-    // write the data to the file(s)
-    while (!data.empty()) {
-        auto& [start_off, file] = files_[file_index];
+    // the buffers (or parts of them) that go to the current file
+    std::vector<std::span<const char>> file_buffers;
+    size_t                             file_offset{offset - files_[file_index].first};
 
-        size_t write_size{start_off + file.get_length() - offset};
+    for (auto buffer : buffers) {
+        while (!buffer.empty()) {
+            auto [start_off, length] = files_[file_index];
 
-        file.write(data | std::views::take(write_size), offset - start_off);
+            // move to the next file once the current one is filled
+            if (offset == start_off + length) {
+                if (!file_buffers.empty()) {
+                    storage_->writev(file_index, file_buffers, file_offset);
+                    file_buffers.clear();
+                }
+                ++file_index;
+                file_offset = 0;
+                continue;
+            }
 
-        data = data | std::views::drop(write_size);
-        offset += write_size;
-        ++file_index;
+            size_t write_size{std::min(start_off + length - offset, buffer.size())};
+
+            file_buffers.push_back(buffer.first(write_size));
+            buffer = buffer.subspan(write_size);
+            offset += write_size;
+        }
+    }
+
+    if (!file_buffers.empty()) {
+        storage_->writev(file_index, file_buffers, file_offset);
     }
 }
 
@@ -43,7 +111,7 @@ size_t FileManager::get_total_length() const {
         files_.begin(),
         files_.end(),
         size_t{0},
-        [](size_t acc, const auto& file) { return acc + file.second.get_length(); }
+        [](size_t acc, const auto& file) { return acc + file.second; }
     );
 }
 }  // namespace torrent::fs
@@ -1,9 +1,12 @@
 #pragma once
 
-#include "File.hpp"
+#include "FileUtils.hpp"
+#include "IStorage.hpp"
 #include "TorrentMetadata.hpp"
 
+#include <algorithm>
 #include <filesystem>
+#include <memory>
 #include <span>
 #include <utility>
 #include <vector>
@@ -12,8 +15,23 @@ namespace torrent::fs {
 
 class FileManager {
     public:
+        /**
+         * @brief Create the files of the torrent
+         *
+         * @param files_info        the files of the torrent
+         * @param dest_dir          the directory the files are created in
+         * @param storage_type      the storage used to write the files
+         * @param allocation_policy how the space of the files is reserved
+         * @param keep_existing     keep the content of the files that already exist (used when
+         * resuming a download)
+         * @note If the requested storage is not available, the synchronous storage is used instead
+         */
         explicit FileManager(
-            std::span<const md::FileInfo> files_info, const std::filesystem::path& dest_dir = "."
+            std::span<const md::FileInfo> files_info,
+            const std::filesystem::path&  dest_dir          = ".",
+            StorageType                   storage_type      = StorageType::SYNC,
+            AllocationPolicy              allocation_policy = DEFAULT_ALLOCATION_POLICY,
+            bool                          keep_existing     = false
         );
 
         FileManager(const FileManager&)            = delete;
@@ -29,8 +47,89 @@ class FileManager {
          *
          * @param data    the data to write
          * @param offset  the offset to write the data at
+         * @note Depending on the storage, the write might only be completed after calling flush,
+         * so the data must stay valid until then
+         */
+        void write(std::span<const char> data, size_t offset) {
+            writev(std::span<const std::span<const char>>(&data, 1), offset);
+        }
+
+        /**
+         * @brief Write multiple contiguous buffers, one after the other, starting at a given offset
+         * The buffers are grouped per file, so each file receives a single vectored write
+         *
+         * @param buffers the buffers to write
+         * @param offset  the offset to write the first buffer at
+         * @note Depending on the storage, the write might only be completed after calling flush,
+         * so the data must stay valid until then
+         */
+        void writev(std::span<const std::span<const char>> buffers, size_t offset);
+
+        /**
+         * @brief Read data from a given offset, which may span multiple files
+         *
+         * @param data   the buffer to read the data into
+         * @param offset the offset to read the data from
+         * @note Only the writes completed by a flush are guaranteed to be visible
+         * @note Concurrent reads are safe, as long as no write is issued at the same time
+         */
+        void read(std::span<char> data, size_t offset) {
+            for_each_file_part(
+                offset,
+                data.size(),
+                [&](size_t file_index, size_t file_offset, size_t part_offset, size_t part_len) {
+                    storage_->read(file_index, data.subspan(part_offset, part_len), file_offset);
+                }
+            );
+        }
+
+        /**
+         * @brief Tell the storage how a range, which may span multiple files, is going to be
+         * accessed
+         *
+         * @param offset the offset of the range
+         * @param length the length of the range
+         * @param advice the expected access
+         */
+        void advise(size_t offset, size_t length, AccessAdvice advice) {
+            for_each_file_part(
+                offset,
+                length,
+                [&](size_t file_index, size_t file_offset, size_t, size_t part_len) {
+                    storage_->advise(file_index, file_offset, part_len, advice);
+                }
+            );
+        }
+
+        /**
+         * @brief Wait until all the writes issued so far have been completed
+         */
+        void flush() { storage_->flush(); }
+
+        /**
+         * @brief Wait until the writes completed by a flush have reached the disk
+         *
+         * @note This function may be called while other writes are issued
+         */
+        void sync() { storage_->sync(); }
+
+        /**
+         * @brief Register a memory region that most of the written data will come from
+         *
+         * @param buffer the memory region
          */
-        void write(std::span<const char> data, size_t offset);
+        void register_buffer(std::span<std::byte> buffer) { storage_->register_buffer(buffer); }
+
+        /**
+         * @brief Get a zero-copy view of the content of a file
+         *
+         * @param file_index the index of the file
+         * @return a span covering the whole file, or an empty span if the storage does not keep the
+         * files in memory
+         */
+        [[nodiscard]] std::span<const char> get_view(size_t file_index) const {
+            return storage_->get_view(file_index);
+        }
 
         /**
          * @brief Get the total length of all the files
@@ -40,8 +139,39 @@ class FileManager {
         [[nodiscard]] size_t get_total_length() const;
 
     private:
-        // pair containing the file start_offset and the file object
-        std::vector<std::pair<size_t, File>> files_;
+        /**
+         * @brief Split a range into the parts that lie in each file
+         *
+         * @param offset the offset of the range
+         * @param length the length of the range
+         * @param func   called for every part with the index of the file, the offset of the part
+         * in the file, the offset of the part in the range and the length of the part
+         */
+        template <typename Func>
+        void for_each_file_part(size_t offset, size_t length, Func&& func) const {
+            size_t file_index{0};
+
+            // find the first file that contains the offset
+            while (file_index < files_.size() &&
+                   offset >= files_[file_index].first + files_[file_index].second) {
+                ++file_index;
+            }
+
+            for (size_t part_offset{0}; part_offset < length && file_index < files_.size();
+                 ++file_index) {
+                auto [start_off, file_len] = files_[file_index];
+
+                size_t part_len{std::min(start_off + file_len - offset, length - part_offset)};
+
+                func(file_index, offset - start_off, part_offset, part_len);
+                part_offset += part_len;
+                offset += part_len;
+            }
+        }
+
+        // pair containing the file start_offset and the file length
+        std::vector<std::pair<size_t, size_t>> files_;
+        std::unique_ptr<IStorage>              storage_;
 };
 
 }  // namespace torrent::fs
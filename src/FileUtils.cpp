@@ -0,0 +1,168 @@
+#include "FileUtils.hpp"
+
+#include "Error.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <fcntl.h>
+#include <filesystem>
+#include <format>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using torrent::fs::AllocationPolicy;
+
+void allocate_file(
+    const std::filesystem::path& path, size_t length, AllocationPolicy policy, bool keep_existing
+) {
+    int fd{torrent::fs::open_file(path)};
+
+    // Start from an empty file, so no stale data is left behind, unless the content is reused
+    int ret{keep_existing ? 0 : ::ftruncate(fd, 0)};
+
+    switch (policy) {
+        case AllocationPolicy::NONE:
+            break;
+
+        case AllocationPolicy::FULL:
+            if (ret == 0 && length > 0) {
+                ret = ::fallocate(fd, 0, 0, static_cast<off_t>(length));
+                if (ret == 0 || errno != EOPNOTSUPP) {
+                    break;
+                }
+                // The filesystem cannot reserve the blocks, so settle for a sparse file
+                LOG_WARN("fallocate is not supported for {}, using a sparse file", path.string());
+            }
+            [[fallthrough]];
+
+        case AllocationPolicy::SPARSE:
+            if (ret == 0) {
+                ret = ::ftruncate(fd, static_cast<off_t>(length));
+            }
+            break;
+    }
+
+    int error{errno};
+    ::close(fd);
+
+    if (ret != 0) {
+        err::throw_with_trace(std::format(
+            "Failed to allocate file: {} ({})", path.string(), std::strerror(error)
+        ));
+    }
+}
+
+}  // namespace
+
+namespace torrent::fs {
+
+int open_file(const std::filesystem::path& path) {
+    // create directories if they don't exist
+    try {
+        std::filesystem::create_directories(path.parent_path());
+    } catch (const std::exception& e) {
+        err::throw_with_trace(
+            std::format("Failed to create directories for file: {} ({})", path.string(), e.what())
+        );
+    }
+
+    int fd{::open(path.c_str(), O_RDWR | O_CREAT, 0644)};
+
+    if (fd < 0) {
+        err::throw_with_trace(
+            std::format("Failed to open file: {} ({})", path.string(), std::strerror(errno))
+        );
+    }
+
+    return fd;
+}
+
+void read_at(int fd, std::span<char> data, size_t offset) {
+    while (!data.empty()) {
+        ssize_t bytes_read{::pread(fd, data.data(), data.size(), static_cast<off_t>(offset))};
+
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read < 0) {
+            err::throw_with_trace(std::format("Failed to read file: {}", std::strerror(errno)));
+        }
+        if (bytes_read == 0) {
+            // Reached the end of the file, the rest was never written
+            std::ranges::fill(data, '\0');
+            return;
+        }
+
+        data = data.subspan(static_cast<size_t>(bytes_read));
+        offset += static_cast<size_t>(bytes_read);
+    }
+}
+
+void sync_file(int fd) {
+    if (::fdatasync(fd) != 0) {
+        err::throw_with_trace(std::format("Failed to sync file: {}", std::strerror(errno)));
+    }
+}
+
+void advise_file(int fd, size_t offset, size_t length, AccessAdvice advice) {
+    ::posix_fadvise(
+        fd,
+        static_cast<off_t>(offset),
+        static_cast<off_t>(length),
+        advice == AccessAdvice::WILL_NEED ? POSIX_FADV_WILLNEED : POSIX_FADV_DONTNEED
+    );
+}
+
+void allocate_files(
+    std::span<const md::FileInfo> files_info,
+    const std::filesystem::path&  dest_dir,
+    AllocationPolicy              policy,
+    bool                          keep_existing
+) {
+    std::atomic<size_t> next_file{0};
+    std::exception_ptr  first_error;
+    std::mutex          error_mutex;
+
+    auto worker = [&] {
+        for (size_t i{next_file++}; i < files_info.size(); i = next_file++) {
+            try {
+                allocate_file(
+                    dest_dir / files_info[i].path, files_info[i].length, policy, keep_existing
+                );
+            } catch (...) {
+                std::scoped_lock lock(error_mutex);
+                if (!first_error) {
+                    first_error = std::current_exception();
+                }
+            }
+        }
+    };
+
+    // Reserving the space of a file mostly waits on the filesystem, so the files are processed in
+    // parallel
+    size_t thread_count{
+        std::min<size_t>(files_info.size(), std::max(1U, std::thread::hardware_concurrency()))
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (size_t i{1}; i < thread_count; ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+    }
+
+    if (first_error) {
+        std::rethrow_exception(first_error);
+    }
+}
+
+}  // namespace torrent::fs
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "TorrentMetadata.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace torrent::fs {
+
+// How the space of the files is reserved before the download starts
+enum class AllocationPolicy {
+    // The files start empty and grow as the pieces are written
+    NONE,
+    // The files are sized to their final length without reserving any blocks
+    SPARSE,
+    // The blocks of the files are reserved upfront with fallocate
+    FULL
+};
+
+// Allocation policy of the files unless another one is asked for, e.g. on the command line
+inline constexpr AllocationPolicy DEFAULT_ALLOCATION_POLICY{AllocationPolicy::SPARSE};
+
+// How a range of a file is going to be accessed
+enum class AccessAdvice {
+    // The range will be read soon, so it can be read ahead
+    WILL_NEED,
+    // The range will not be accessed again, so its pages can be dropped from the page cache
+    DONT_NEED
+};
+
+/**
+ * @brief Open a file for reading and writing, creating it and its parent directories if needed
+ *
+ * @param path the path of the file
+ * @return the file descriptor of the opened file
+ * @note Throws if the file could not be opened
+ */
+[[nodiscard]] int open_file(const std::filesystem::path& path);
+
+/**
+ * @brief Read data from a file at a given offset
+ *
+ * @param fd     the file descriptor of the file
+ * @param data   the buffer to read the data into
+ * @param offset the offset in the file to read the data from
+ * @note The part of the buffer past the end of the file is filled with zeros
+ * @note Throws if the file could not be read
+ */
+void read_at(int fd, std::span<char> data, size_t offset);
+
+/**
+ * @brief Wait until the data written to a file has reached the disk
+ *
+ * @param fd the file descriptor of the file
+ * @note Throws if the data could not be written back
+ */
+void sync_file(int fd);
+
+/**
+ * @brief Tell the kernel how a range of a file is going to be accessed
+ *
+ * @param fd     the file descriptor of the file
+ * @param offset the offset of the range
+ * @param length the length of the range
+ * @param advice the expected access
+ * @note The advice is only a hint, so failures are ignored
+ */
+void advise_file(int fd, size_t offset, size_t length, AccessAdvice advice);
+
+/**
+ * @brief Create the files of the torrent and reserve their space according to the policy
+ * The files are processed in parallel
+ *
+ * @param files_info    the files of the torrent
+ * @param dest_dir      the directory the files are created in
+ * @param policy        the allocation policy
+ * @param keep_existing keep the content of the files that already exist, instead of discarding
+ * it (used when resuming a download)
+ * @note Throws if a file could not be created or allocated
+ */
+void allocate_files(
+    std::span<const md::FileInfo> files_info,
+    const std::filesystem::path&  dest_dir,
+    AllocationPolicy              policy,
+    bool                          keep_existing = false
+);
+
+}  // namespace torrent::fs
@@ -4,6 +4,7 @@
 
 #include <cstddef>
 #include <memory>
+#include <span>
 
 namespace torrent::utils {
 
@@ -34,6 +35,18 @@ class FixedSizeAllocator {
          */
         void deallocate(T* ptr, size_t n) { pool_->deallocate(ptr); }
 
+        /** @brief Get the memory region that the blocks are allocated from
+         *
+         * @return A span covering all the blocks of the underlying pool
+         */
+        std::span<std::byte> get_arena() const { return pool_->get_arena(); }
+
+        /** @brief Get the number of blocks that can still be allocated
+         *
+         * @return The number of free blocks of the underlying pool
+         */
+        size_t get_free_count() const { return pool_->get_free_count(); }
+
         template <typename U>
         struct rebind {
                 using other = FixedSizeAllocator<U>;
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "FileUtils.hpp"
+
+#include <cstddef>
+#include <span>
+
+namespace torrent::fs {
+
+enum class StorageType { SYNC, IO_URING, MMAP };
+
+class IStorage {
+    public:
+        virtual ~IStorage() = default;
+
+        /**
+         * @brief Write data to a file at a given offset
+         *
+         * @param file_index the index of the file, in the order the files were given to the storage
+         * @param data       the data to write
+         * @param offset     the offset in the file to write the data at
+         * @note The data must stay valid until the next call to flush returns
+         */
+        virtual void write(size_t file_index, std::span<const char> data, size_t offset) = 0;
+
+        /**
+         * @brief Write multiple buffers to a file, one after the other, starting at a given offset
+         * By default, the buffers are written one by one
+         *
+         * @param file_index the index of the file
+         * @param buffers    the buffers to write
+         * @param offset     the offset in the file to write the first buffer at
+         * @note The data must stay valid until the next call to flush returns
+         */
+        virtual void writev(
+            size_t file_index, std::span<const std::span<const char>> buffers, size_t offset
+        ) {
+            for (auto buffer : buffers) {
+                write(file_index, buffer, offset);
+                offset += buffer.size();
+            }
+        }
+
+        /**
+         * @brief Wait until all the writes issued so far have been completed
+         */
+        virtual void flush() = 0;
+
+        /**
+         * @brief Wait until the writes completed by a flush have reached the disk, so they
+         * survive a crash
+         *
+         * @note This function may be called while other writes are issued
+         * @note Throws if the data could not be written back
+         */
+        virtual void sync() = 0;
+
+        /**
+         * @brief Read data from a file at a given offset
+         *
+         * @param file_index the index of the file
+         * @param data       the buffer to read the data into
+         * @param offset     the offset in the file to read the data from
+         * @note Only the writes completed by a flush are guaranteed to be visible
+         * @note The part of the buffer past the end of the file is filled with zeros
+         */
+        virtual void read(size_t file_index, std::span<char> data, size_t offset) = 0;
+
+        /**
+         * @brief Tell the storage how a range of a file is going to be accessed
+         * By default, the advice is ignored
+         *
+         * @param file_index the index of the file
+         * @param offset     the offset of the range in the file
+         * @param length     the length of the range
+         * @param advice     the expected access
+         */
+        virtual void advise(
+            size_t file_index, size_t offset, size_t length, AccessAdvice advice
+        ) {}
+
+        /**
+         * @brief Register a memory region that most of the written data will come from
+         * Storages that can take advantage of it (e.g. io_uring fixed buffers) will use it to avoid
+         * mapping the buffers on every write
+         *
+         * @param buffer the memory region
+         */
+        virtual void register_buffer(std::span<std::byte> buffer) {}
+
+        /**
+         * @brief Get a zero-copy view of the content of a file
+         *
+         * @param file_index the index of the file
+         * @return a span covering the whole file, or an empty span if the storage does not keep the
+         * files in memory
+         */
+        [[nodiscard]] virtual std::span<const char> get_view(size_t file_index) const { return {}; }
+};
+
+}  // namespace torrent::fs
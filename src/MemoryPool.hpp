@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <span>
 #include <vector>
 
 // Simple Segregated Storage based memory pool
@@ -48,6 +49,22 @@ class MemoryPool {
          */
         void deallocate(void* ptr);
 
+        /**
+         * @brief Get the memory region that the blocks are allocated from
+         *
+         * @return A span covering all the blocks of the pool
+         */
+        std::span<std::byte> get_arena() const {
+            return {pool_, block_count_ * aligned_block_size_};
+        }
+
+        /**
+         * @brief Get the number of blocks that can still be allocated
+         *
+         * @return The number of free blocks
+         */
+        size_t get_free_count() const { return free_blocks_; }
+
     private:
         /**
          * @brief Get the address of the block at the given index
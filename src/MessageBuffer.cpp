@@ -0,0 +1,81 @@
+#include "MessageBuffer.hpp"
+
+#include "Constant.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace torrent::message {
+
+MessageBuffer::MessageBuffer(size_t max_payload_size)
+    : max_payload_size_{max_payload_size},
+      buffer_(std::max(RECEIVE_BUFFER_SIZE, 2 * (HEADER_SIZE + max_payload_size))) {}
+
+std::span<std::byte> MessageBuffer::prepare() {
+    if (begin_ == end_) {
+        begin_ = end_ = 0;
+    } else if (buffer_.size() - end_ < HEADER_SIZE + max_payload_size_) {
+        // Only a partial message is left once the complete ones are parsed, so the buffer is at
+        // least half free after the move
+        std::memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+        end_   -= begin_;
+        begin_  = 0;
+    }
+    return std::span<std::byte>(buffer_).subspan(end_);
+}
+
+std::expected<std::optional<Message>, ParseError> MessageBuffer::next_message() {
+    if (size() < sizeof(uint32_t)) {
+        return std::unexpected(ParseError::INCOMPLETE);
+    }
+
+    auto length{read_uint32(begin_)};
+
+    if (length == 0) {
+        begin_ += sizeof(length);
+        return std::nullopt;
+    }
+    if (length - 1 > max_payload_size_) {
+        return std::unexpected(ParseError::OVERSIZED);
+    }
+    if (size() < sizeof(length) + length) {
+        return std::unexpected(ParseError::INCOMPLETE);
+    }
+
+    Message msg{.id = static_cast<MessageType>(buffer_[begin_ + sizeof(length)])};
+    if (length > 1) {
+        msg.payload = std::span<std::byte>(buffer_).subspan(begin_ + HEADER_SIZE, length - 1);
+    }
+    begin_ += sizeof(length) + length;
+    return msg;
+}
+
+std::optional<PartialBlock> MessageBuffer::partial_block() const {
+    if (size() < HEADER_SIZE + PIECE_HEADER_SIZE ||
+        buffer_[begin_ + sizeof(uint32_t)] != static_cast<std::byte>(MessageType::PIECE)) {
+        return std::nullopt;
+    }
+
+    auto length{read_uint32(begin_)};
+    if (length < 1 + PIECE_HEADER_SIZE || size() >= sizeof(length) + length) {
+        return std::nullopt;
+    }
+
+    auto block_start{begin_ + HEADER_SIZE + PIECE_HEADER_SIZE};
+    return PartialBlock{
+        .piece_index = read_uint32(begin_ + HEADER_SIZE),
+        .offset      = read_uint32(begin_ + HEADER_SIZE + sizeof(uint32_t)),
+        .size        = static_cast<uint32_t>(length - 1 - PIECE_HEADER_SIZE),
+        .received    = std::span<const std::byte>(buffer_.data() + block_start, end_ - block_start)
+    };
+}
+
+uint32_t MessageBuffer::read_uint32(size_t pos) const {
+    uint32_t value{};
+    std::memcpy(&value, buffer_.data() + pos, sizeof(value));
+    return utils::network_to_host_order(value);
+}
+
+}  // namespace torrent::message
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "TorrentMessage.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace torrent::message {
+
+/**
+ * @brief Piece message whose header is buffered but not the whole block
+ */
+struct PartialBlock {
+        uint32_t                   piece_index;
+        uint32_t                   offset;
+        uint32_t                   size;
+        // The start of the block, already buffered
+        std::span<const std::byte> received;
+};
+
+/**
+ * @brief Reason the next message could not be parsed
+ */
+enum class ParseError : uint8_t {
+    // The message is not complete yet
+    INCOMPLETE,
+    // The message is larger than the largest payload
+    OVERSIZED
+};
+
+/**
+ * @brief Buffer of the bytes received from a peer, parsed in place into messages
+ *
+ * The socket reads as many bytes as fit in the free space at the end of the buffer, and every
+ * complete message is then parsed without copying its payload. The bytes of a partial message are
+ * moved back to the start of the buffer when the end gets too close, so a message is always
+ * contiguous
+ */
+class MessageBuffer {
+    public:
+        MessageBuffer() = default;
+
+        /**
+         * @brief Create an empty buffer
+         *
+         * @param max_payload_size Size of the largest payload a peer may send, e.g. a block
+         */
+        explicit MessageBuffer(size_t max_payload_size);
+
+        /**
+         * @brief Get the free space at the end of the buffer to receive bytes in
+         * The payloads of the messages parsed before are invalidated
+         *
+         * @return The free space, which can hold at least the largest message
+         */
+        std::span<std::byte> prepare();
+
+        /**
+         * @brief Append the bytes received in the free space to the buffered bytes
+         *
+         * @param bytes_cnt Number of bytes received
+         */
+        void commit(size_t bytes_cnt) { end_ += bytes_cnt; }
+
+        /**
+         * @brief Parse the next buffered message
+         *
+         * @return The message, nullopt for a keep-alive, or the reason the message could not be
+         * parsed. The id of a message is whatever the peer sent, even an unknown one
+         * @note The payload points into the buffer, and is valid until the next call to prepare
+         */
+        std::expected<std::optional<Message>, ParseError> next_message();
+
+        /**
+         * @brief Get the piece message left partly buffered once the complete messages are parsed
+         *
+         * @return The block, or nullopt if the partial message is not a piece message with a
+         * complete header
+         */
+        [[nodiscard]] std::optional<PartialBlock> partial_block() const;
+
+        /**
+         * @brief Discard the partial piece message, once the rest of its block is received
+         * elsewhere
+         */
+        void consume_partial_block() { begin_ = end_; }
+
+        /**
+         * @brief Discard the buffered bytes, e.g. on reconnection
+         */
+        void clear() { begin_ = end_ = 0; }
+
+        /**
+         * @brief Get the number of bytes received and not parsed yet
+         *
+         * @return Number of bytes
+         */
+        [[nodiscard]] size_t size() const { return end_ - begin_; }
+
+    private:
+        // Size of the length prefix and of the id of a message
+        static constexpr size_t HEADER_SIZE{5};
+        // Size of the piece index and of the offset that start the payload of a piece message
+        static constexpr size_t PIECE_HEADER_SIZE{8};
+
+        /**
+         * @brief Read a big endian integer of the buffered bytes
+         *
+         * @param pos Position of the integer in the buffer
+         * @return The integer
+         */
+        [[nodiscard]] uint32_t read_uint32(size_t pos) const;
+
+        size_t                 max_payload_size_{0};
+        std::vector<std::byte> buffer_;
+        // Start of the bytes not parsed yet
+        size_t begin_{0};
+        // End of the bytes received
+        size_t end_{0};
+};
+
+}  // namespace torrent::message
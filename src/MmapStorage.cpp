@@ -0,0 +1,144 @@
+#include "MmapStorage.hpp"
+
+#include "Error.hpp"
+#include "FileUtils.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <cstring>
+#include <format>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace torrent::fs {
+
+MmapStorage::MmapStorage(
+    std::span<const md::FileInfo> files_info, const std::filesystem::path& dest_dir
+) {
+    fds_.reserve(files_info.size());
+    mappings_.reserve(files_info.size());
+
+    for (const auto& file_info : files_info) {
+        const std::filesystem::path file_path{dest_dir / file_info.path};
+
+        try {
+            fds_.push_back(open_file(file_path));
+        } catch (...) {
+            release();
+            throw;
+        }
+
+        // Empty files cannot be mapped, and there is nothing to write in them anyway
+        if (file_info.length == 0) {
+            mappings_.emplace_back();
+            continue;
+        }
+
+        // Size the file first, so that every offset of the mapping is backed by the file
+        if (::ftruncate(fds_.back(), static_cast<off_t>(file_info.length)) != 0) {
+            release();
+            err::throw_with_trace(std::format(
+                "Failed to resize file: {} ({})", file_path.string(), std::strerror(errno)
+            ));
+        }
+
+        // A page written in a hole the file system cannot fill raises SIGBUS, so the space is
+        // reserved before the pages are ever touched
+        if (int ret{::posix_fallocate(fds_.back(), 0, static_cast<off_t>(file_info.length))};
+            ret != 0) {
+            release();
+            err::throw_with_trace(std::format(
+                "Failed to allocate file: {} ({})", file_path.string(), std::strerror(ret)
+            ));
+        }
+
+        void* addr{::mmap(
+            nullptr, file_info.length, PROT_READ | PROT_WRITE, MAP_SHARED, fds_.back(), 0
+        )};
+
+        if (addr == MAP_FAILED) {
+            release();
+            err::throw_with_trace(std::format(
+                "Failed to map file: {} ({})", file_path.string(), std::strerror(errno)
+            ));
+        }
+
+        // The pieces arrive in random order, so read-ahead around the faulting pages would only
+        // pull in pages that are about to be overwritten
+        ::madvise(addr, file_info.length, MADV_RANDOM);
+
+        mappings_.emplace_back(static_cast<char*>(addr), file_info.length);
+    }
+}
+
+MmapStorage::~MmapStorage() {
+    release();
+}
+
+void MmapStorage::write(size_t file_index, std::span<const char> data, size_t offset) {
+    std::ranges::copy(data, mappings_[file_index].subspan(offset, data.size()).begin());
+}
+
+void MmapStorage::sync() {
+    for (auto mapping : mappings_) {
+        if (!mapping.empty() && ::msync(mapping.data(), mapping.size(), MS_SYNC) != 0) {
+            err::throw_with_trace(
+                std::format("Failed to write back the mapped file: {}", std::strerror(errno))
+            );
+        }
+    }
+}
+
+void MmapStorage::read(size_t file_index, std::span<char> data, size_t offset) {
+    std::ranges::copy(mappings_[file_index].subspan(offset, data.size()), data.begin());
+}
+
+void MmapStorage::advise(size_t file_index, size_t offset, size_t length, AccessAdvice advice) {
+    auto mapping{mappings_[file_index]};
+    if (mapping.empty() || length == 0) {
+        return;
+    }
+
+    auto page_size{static_cast<size_t>(::sysconf(_SC_PAGESIZE))};
+    auto end{std::min(offset + length, mapping.size())};
+
+    // madvise only works on whole pages. Reading ahead can cover the partial pages at the ends of
+    // the range, but dropping them would also drop the data next to the range
+    size_t begin_page{};
+    size_t end_page{};
+    if (advice == AccessAdvice::WILL_NEED) {
+        begin_page = offset / page_size * page_size;
+        end_page   = std::min((end + page_size - 1) / page_size * page_size, mapping.size());
+    } else {
+        begin_page = (offset + page_size - 1) / page_size * page_size;
+        end_page   = end == mapping.size() ? end : end / page_size * page_size;
+    }
+
+    if (begin_page < end_page) {
+        ::madvise(
+            mapping.data() + begin_page,
+            end_page - begin_page,
+            advice == AccessAdvice::WILL_NEED ? MADV_WILLNEED : MADV_DONTNEED
+        );
+    }
+
+    // Unmapping the pages does not remove them from the page cache
+    advise_file(fds_[file_index], offset, length, advice);
+}
+
+void MmapStorage::release() {
+    for (auto mapping : mappings_) {
+        if (!mapping.empty()) {
+            ::munmap(mapping.data(), mapping.size());
+        }
+    }
+    mappings_.clear();
+
+    for (int fd : fds_) {
+        ::close(fd);
+    }
+    fds_.clear();
+}
+
+}  // namespace torrent::fs
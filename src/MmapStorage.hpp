@@ -0,0 +1,101 @@
+#pragma once
+
+#include "IStorage.hpp"
+#include "TorrentMetadata.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace torrent::fs {
+
+class MmapStorage final : public IStorage {
+    public:
+        /**
+         * @brief Create the files at their final length, reserve their blocks and map them in
+         * memory
+         * The blocks are always reserved, whatever the allocation policy, since a write to a page
+         * the file system has no room for would raise SIGBUS instead of an error
+         *
+         * @param files_info the files of the torrent
+         * @param dest_dir   the directory the files are created in
+         * @note Throws if a file could not be created, allocated or mapped
+         */
+        MmapStorage(
+            std::span<const md::FileInfo> files_info, const std::filesystem::path& dest_dir
+        );
+
+        MmapStorage(const MmapStorage&)            = delete;
+        MmapStorage& operator=(const MmapStorage&) = delete;
+        MmapStorage(MmapStorage&&)                 = delete;
+        MmapStorage& operator=(MmapStorage&&)      = delete;
+
+        /**
+         * @brief Unmap and close the files
+         * The dirty pages are written back by the kernel
+         */
+        ~MmapStorage() override;
+
+        /**
+         * @brief Copy data into the mapping of a file at a given offset
+         *
+         * @param file_index the index of the file
+         * @param data       the data to write
+         * @param offset     the offset in the file to write the data at
+         */
+        void write(size_t file_index, std::span<const char> data, size_t offset) override;
+
+        /**
+         * @brief The data is copied into the page cache by write, and the kernel takes care of
+         * writing it back, so there is nothing to wait for
+         * Waiting for the pages to reach the disk is left to sync
+         */
+        void flush() override {}
+
+        /**
+         * @brief Wait until the pages of the files have reached the disk
+         */
+        void sync() override;
+
+        /**
+         * @brief Copy data out of the mapping of a file at a given offset
+         *
+         * @param file_index the index of the file
+         * @param data       the buffer to read the data into
+         * @param offset     the offset in the file to read the data from
+         */
+        void read(size_t file_index, std::span<char> data, size_t offset) override;
+
+        /**
+         * @brief Tell the kernel how a range of a file is going to be accessed, both for the
+         * mapping and for the page cache
+         *
+         * @param file_index the index of the file
+         * @param offset     the offset of the range in the file
+         * @param length     the length of the range
+         * @param advice     the expected access
+         */
+        void advise(size_t file_index, size_t offset, size_t length, AccessAdvice advice) override;
+
+        /**
+         * @brief Get a view of the mapped content of a file
+         *
+         * @param file_index the index of the file
+         * @return a span covering the whole file
+         */
+        [[nodiscard]] std::span<const char> get_view(size_t file_index) const override {
+            return mappings_[file_index];
+        }
+
+    private:
+        /**
+         * @brief Unmap and close all the files mapped so far
+         */
+        void release();
+
+        std::vector<int>             fds_;
+        std::vector<std::span<char>> mappings_;
+};
+
+}  // namespace torrent::fs
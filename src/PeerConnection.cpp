@@ -32,10 +32,9 @@ auto PeerConnection::receive_handshake()
     LOG_DEBUG("Waiting for handshake message from peer {}:{}", peer_info_.ip, peer_info_.port);
 
     // Receive the handshake message
+    message::HandshakeMessage handshake_message{};
     auto handshake_result = co_await utils::tcp::receive_data_with_timeout(
-        socket_,
-        std::span<std::byte, message::HANDSHAKE_MESSAGE_SIZE>(receive_buffer_),
-        duration::HANDSHAKE_TIMEOUT
+        socket_, handshake_message, duration::HANDSHAKE_TIMEOUT
     );
 
     if (!handshake_result.has_value()) {
@@ -44,9 +43,7 @@ auto PeerConnection::receive_handshake()
 
     // Parse the handshake message
 
-    if (auto info_hash = message::parse_handshake_message(
-            std::span<const std::byte, message::HANDSHAKE_MESSAGE_SIZE>(receive_buffer_)
-        );
+    if (auto info_hash = message::parse_handshake_message(handshake_message);
         !info_hash.has_value()) {
         co_return std::unexpected(std::error_code{});
     } else {
@@ -100,36 +97,35 @@ auto PeerConnection::establish_connection() -> awaitable<std::expected<void, std
 }
 
 uint32_t PeerConnection::endgame_load_block_requests(uint32_t num_blocks) {
-    // Reset the buffer
-    send_buffer_.clear();
-
     uint32_t blocks_requested{0U};
+    auto     now{std::chrono::steady_clock::now()};
+    auto     request_timeout{request_pipeline_.get_request_timeout()};
+    auto     deadline_tick{piece_manager_.get_deadline_tick(request_timeout)};
 
-    for (auto i : std::views::iota(0U, num_blocks)) {
-        if (endgame_remaining_blocks_.empty()) {
-            break;
-        }
+    while (blocks_requested < num_blocks && !endgame_remaining_blocks_.empty()) {
         auto [piece_index, block_offset, block_size] = endgame_remaining_blocks_.front();
 
+        // Remove the block from the endgame remaining blocks
+        std::swap(endgame_remaining_blocks_.front(), endgame_remaining_blocks_.back());
+        endgame_remaining_blocks_.pop_back();
+
+        // Add the block info to the pending requests, a block requested before the endgame may
+        // still be in flight
+        if (!request_pipeline_.add({piece_index, block_offset, block_size}, now, deadline_tick)) {
+            continue;
+        }
+
+        auto offset{send_buffer_.size()};
         send_buffer_.insert(send_buffer_.end(), 17, std::byte{0});
 
         message::create_request_message(
-            std::span<std::byte>(send_buffer_).subspan(i * 17U, 17),
+            std::span<std::byte>(send_buffer_).subspan(offset, 17),
             piece_index,
             block_offset,
             block_size
         );
 
-        // Add the block info to the pending requests
-        pending_requests_.blocks_info[pending_requests_.count++] = {
-            {piece_index, block_offset, block_size}, std::chrono::steady_clock::now()
-        };
-
         ++blocks_requested;
-
-        // Remove the block from the endgame remaining blocks
-        std::swap(endgame_remaining_blocks_.front(), endgame_remaining_blocks_.back());
-        endgame_remaining_blocks_.pop_back();
     }
 
     return blocks_requested;
@@ -139,6 +135,7 @@ uint32_t PeerConnection::endgame_refresh_pending_requests() {
     send_buffer_.clear();
 
     uint32_t blocks_cancelled{0U};
+    auto     current_tick{piece_manager_.get_current_tick()};
 
     // Remove the received blocks from endgame_remaining_blocks_
     for (uint32_t i{0U}; i < endgame_remaining_blocks_.size();) {
@@ -153,17 +150,10 @@ uint32_t PeerConnection::endgame_refresh_pending_requests() {
     }
 
     // Resolve the pending blocks
-    for (uint32_t i{0U}; i < pending_requests_.count;) {
-        auto [block_info, request_time] = pending_requests_.blocks_info[i];
-
-        auto [piece_idx, block_offset, block_size] = block_info;
+    request_pipeline_.remove_if([&](const RequestPipeline::Request& request) {
+        auto [piece_idx, block_offset, block_size] = request.block_info;
 
         if (piece_manager_.is_block_received(piece_idx, block_offset)) {
-            std::swap(
-                pending_requests_.blocks_info[i],
-                pending_requests_.blocks_info[pending_requests_.count - 1]
-            );
-            --pending_requests_.count;
             send_buffer_.insert(send_buffer_.end(), 17, std::byte{0});
             message::create_cancel_message(
                 std::span<std::byte>(send_buffer_).subspan(blocks_cancelled * 17U, 17),
@@ -172,17 +162,14 @@ uint32_t PeerConnection::endgame_refresh_pending_requests() {
                 block_size
             );
             ++blocks_cancelled;
-        } else if (request_time + duration::REQUEST_TIMEOUT >= std::chrono::steady_clock::now()) {
-            endgame_remaining_blocks_.push_back(std::move(block_info));
-            std::swap(
-                pending_requests_.blocks_info[i],
-                pending_requests_.blocks_info[pending_requests_.count - 1]
-            );
-            --pending_requests_.count;
-        } else {
-            ++i;
+            return true;
         }
-    }
+        if (request.deadline_tick <= current_tick) {
+            endgame_remaining_blocks_.push_back(request.block_info);
+            return true;
+        }
+        return false;
+    });
 
     return blocks_cancelled;
 }
@@ -201,35 +188,17 @@ awaitable<void> PeerConnection::endgame_send_requests() {
     std::ranges::shuffle(endgame_remaining_blocks_, gen);
 
     while (!piece_manager_.completed()) {
-        co_await asio::steady_timer(co_await this_coro::executor, duration::REQUEST_INTERVAL)
-            .async_wait(use_nothrow_awaitable);
+        co_await wait_for_refill();
         if (peer_choking_) {
             continue;
         }
 
-        uint32_t blocks_cancelled{endgame_refresh_pending_requests()};
-
-        if (blocks_cancelled > 0) {
-            if (auto res = co_await utils::tcp::send_data_with_timeout(
-                    socket_, send_buffer_, duration::SEND_MSG_TIMEOUT
-                );
-                !res.has_value()) {
-                LOG_DEBUG(
-                    "Failed to send cancel messages to peer {}:{} with error:\n{}",
-                    peer_info_.ip,
-                    peer_info_.port,
-                    res.error().message()
-                );
-                handle_failure(res.error());
-                co_return;
-            }
-        }
-
-        auto requested_blocks = endgame_load_block_requests(
-            std::min(MAX_BLOCKS_IN_FLIGHT - pending_requests_.count, MAX_BLOCKS_PER_REQUEST)
-        );
+        // The cancels and the requests are sent in a single write
+        endgame_refresh_pending_requests();
+        request_pipeline_.update(std::chrono::steady_clock::now());
+        endgame_load_block_requests(request_pipeline_.get_free_slots());
 
-        if (requested_blocks == 0) {
+        if (send_buffer_.empty()) {
             continue;
         }
 
@@ -238,7 +207,7 @@ awaitable<void> PeerConnection::endgame_send_requests() {
             );
             !res.has_value()) {
             LOG_DEBUG(
-                "Failed to send request message to peer {}:{} with error:\n{}",
+                "Failed to send request and cancel messages to peer {}:{} with error:\n{}",
                 peer_info_.ip,
                 peer_info_.port,
                 res.error().message()
@@ -254,54 +223,74 @@ uint32_t PeerConnection::load_block_requests(uint32_t num_blocks) {
     // Reset the buffer
     send_buffer_.clear();
 
-    uint32_t blocks_requested{0U};
-
-    for (auto i : std::views::iota(0U, num_blocks)) {
-        auto request = piece_manager_.request_next_block(bitfield_);
-        if (!request.has_value()) {
-            break;
+    // Pick all the blocks in a single scan of the pieces, the rate of the peer deciding whether
+    // it gets pieces to itself
+    block_requests_.clear();
+    request_cursor_.download_rate = request_pipeline_.get_rate();
+    auto request_timeout{request_pipeline_.get_request_timeout()};
+    auto blocks_requested{static_cast<uint32_t>(piece_manager_.request_next_blocks(
+        bitfield_, num_blocks, block_requests_, request_cursor_, request_timeout
+    ))};
+    // The deadline identifies the requests in the piece manager, so only these requests are
+    // handed back if the peer drops them
+    auto deadline_tick{piece_manager_.get_deadline_tick(request_timeout)};
+
+    send_buffer_.resize(static_cast<size_t>(blocks_requested) * 17U);
+    // The round-trip time of the blocks is measured from a precise request time
+    auto     now{std::chrono::steady_clock::now()};
+    uint32_t blocks_sent{0U};
+
+    for (auto i : std::views::iota(0U, blocks_requested)) {
+        auto [piece_index, block_offset, block_size] = block_requests_[i];
+
+        // Add the block info to the pending requests. A block whose request timed out in the
+        // piece manager before it did here is still in flight, so it is not requested twice
+        if (!request_pipeline_.add(block_requests_[i], now, deadline_tick)) {
+            continue;
         }
 
-        auto [piece_index, block_offset, block_size] = *request;
-        send_buffer_.insert(send_buffer_.end(), 17, std::byte{0});
-
         message::create_request_message(
-            std::span<std::byte>(send_buffer_).subspan(i * 17U, 17),
+            std::span<std::byte>(send_buffer_).subspan(blocks_sent * 17U, 17),
             piece_index,
             block_offset,
             block_size
         );
-
-        // Add the block info to the pending requests
-        pending_requests_.blocks_info[pending_requests_.count++] = {
-            std::move(*request), std::chrono::steady_clock::now()
-        };
-
-        ++blocks_requested;
+        ++blocks_sent;
     }
+    send_buffer_.resize(static_cast<size_t>(blocks_sent) * 17U);
 
-    return blocks_requested;
+    return blocks_sent;
 }
 
 void PeerConnection::refresh_pending_requests() {
-    for (uint32_t i{0U}; i < pending_requests_.count;) {
-        auto [block_info, request_time] = pending_requests_.blocks_info[i];
-        if (request_time + duration::REQUEST_TIMEOUT >= std::chrono::steady_clock::now()) {
-            std::swap(
-                pending_requests_.blocks_info[i],
-                pending_requests_.blocks_info[pending_requests_.count - 1]
-            );
-            --pending_requests_.count;
-        } else {
-            ++i;
-        }
+    // The requests time out at the same tick as in the piece manager, whatever the timeout of the
+    // peer has become since
+    auto current_tick{piece_manager_.get_current_tick()};
+    request_pipeline_.remove_if([current_tick](const RequestPipeline::Request& request) {
+        return request.deadline_tick <= current_tick;
+    });
+}
+
+awaitable<void> PeerConnection::wait_for_refill() {
+    if (refill_requested_) {
+        refill_requested_ = false;
+        co_return;
     }
+    // The requests that timed out are refilled on the next interval if no message wakes the
+    // sender before
+    refill_timer_.expires_after(duration::REQUEST_INTERVAL);
+    co_await refill_timer_.async_wait(use_nothrow_awaitable);
+    refill_requested_ = false;
+}
+
+void PeerConnection::request_refill() {
+    refill_requested_ = true;
+    refill_timer_.cancel();
 }
 
 awaitable<void> PeerConnection::send_requests() {
     while (!piece_manager_.completed()) {
-        co_await asio::steady_timer(co_await this_coro::executor, duration::REQUEST_INTERVAL)
-            .async_wait(use_nothrow_awaitable);
+        co_await wait_for_refill();
         if (peer_choking_) {
             continue;
         }
@@ -313,10 +302,9 @@ awaitable<void> PeerConnection::send_requests() {
 
         refresh_pending_requests();
 
-        auto requested_blocks = load_block_requests(
-            (MAX_BLOCKS_IN_FLIGHT >= MAX_BLOCKS_PER_REQUEST + pending_requests_.count) *
-            MAX_BLOCKS_PER_REQUEST
-        );
+        // Fill the pipeline up to the depth the rate and round-trip time of the peer call for
+        request_pipeline_.update(std::chrono::steady_clock::now());
+        auto requested_blocks = load_block_requests(request_pipeline_.get_free_slots());
 
         if (requested_blocks == 0) {
             continue;
@@ -341,62 +329,46 @@ awaitable<void> PeerConnection::send_requests() {
 
 awaitable<void> PeerConnection::receive_messages() {
     while (!piece_manager_.completed()) {
-        uint32_t message_size{};
-
-        std::expected<void, std::error_code> res;
-        res = co_await utils::tcp::receive_data_with_timeout(
-            socket_,
-            std::span<std::byte>(reinterpret_cast<std::byte*>(&message_size), 4),
-            duration::RECEIVE_MSG_TIMEOUT
+        // Read whatever the socket has buffered, the watchdog of run() times the peer out
+        auto [ec, bytes_received] = co_await socket_.async_read_some(
+            asio::buffer(receive_buffer_.prepare()), use_nothrow_awaitable
         );
 
-        if (!res.has_value()) {
+        if (ec) {
             LOG_DEBUG(
-                "Failed to receive message size from peer {}:{} with error:\n{}",
+                "Failed to receive messages from peer {}:{} with error:\n{}",
                 peer_info_.ip,
                 peer_info_.port,
-                res.error().message()
+                ec.message()
             );
-            handle_failure(res.error());
+            handle_failure(ec);
             co_return;
         }
 
-        // Convert the message size to host byte order
-        message_size = utils::network_to_host_order(message_size);
+        receive_deadline_ = std::chrono::steady_clock::now() + duration::RECEIVE_MSG_TIMEOUT;
+        receive_buffer_.commit(bytes_received);
 
-        // Keep-alive message
-        if (message_size == 0) {
-            continue;
+        // Handle every complete message, the payloads are parsed in place. A keep-alive has no
+        // message
+        auto msg{receive_buffer_.next_message()};
+        for (; msg.has_value(); msg = receive_buffer_.next_message()) {
+            if (msg->has_value()) {
+                handle_message(**msg);
+            }
         }
-
-        std::byte id{};
-
-        res = co_await utils::tcp::receive_data_with_timeout(
-            socket_, std::span<std::byte>(&id, 1), duration::RECEIVE_MSG_TIMEOUT
-        );
-
-        if (!res.has_value()) {
+        if (msg.error() == message::ParseError::OVERSIZED) {
             LOG_DEBUG(
-                "Failed to receive message id from peer {}:{} with error:\n{}",
-                peer_info_.ip,
-                peer_info_.port,
-                res.error().message()
+                "Received an oversized message from peer {}:{}", peer_info_.ip, peer_info_.port
             );
-            handle_failure(res.error());
+            handle_failure(asio::error::message_size);
             co_return;
         }
 
-        std::optional<std::span<std::byte>> payload{std::nullopt};
-
-        if (message_size > 1) {
-            payload = std::span<std::byte>(receive_buffer_).subspan(0, message_size - 1);
-
-            if (res = co_await utils::tcp::receive_data_with_timeout(
-                    socket_, *payload, duration::RECEIVE_MSG_TIMEOUT
-                );
-                !res.has_value()) {
+        // A block left partly buffered is received straight into its piece
+        if (auto block = receive_buffer_.partial_block(); block.has_value()) {
+            if (auto res = co_await receive_block_in_place(*block); !res.has_value()) {
                 LOG_DEBUG(
-                    "Failed to receive message payload from peer {}:{} with error:\n{}",
+                    "Failed to receive block from peer {}:{} with error:\n{}",
                     peer_info_.ip,
                     peer_info_.port,
                     res.error().message()
@@ -405,20 +377,53 @@ awaitable<void> PeerConnection::receive_messages() {
                 co_return;
             }
         }
-
-        handle_message({static_cast<message::MessageType>(id), payload});
     }
     co_return;
 }
 
+auto PeerConnection::receive_block_in_place(const message::PartialBlock& block)
+    -> awaitable<std::expected<void, std::error_code>> {
+    RequestPipeline::BlockInfo block_info{block.piece_index, block.offset, block.size};
+
+    // Unsolicited and duplicate blocks are left to the receive buffer
+    if (!request_pipeline_.contains(block_info)) {
+        co_return std::expected<void, std::error_code>{};
+    }
+    auto block_data{piece_manager_.reserve_block(block.piece_index, block.offset, block.size)};
+    if (!block_data.has_value()) {
+        co_return std::expected<void, std::error_code>{};
+    }
+
+    // Only the start of the block that was read along with the previous messages is copied
+    std::ranges::copy(block.received, block_data->begin());
+    receive_buffer_.consume_partial_block();
+
+    auto [ec, bytes_received] = co_await asio::async_read(
+        socket_, asio::buffer(block_data->subspan(block.received.size())), use_nothrow_awaitable
+    );
+
+    if (ec) {
+        piece_manager_.release_block(block.piece_index, block.offset);
+        co_return std::unexpected(ec);
+    }
+
+    receive_deadline_ = std::chrono::steady_clock::now() + duration::RECEIVE_MSG_TIMEOUT;
+    piece_manager_.commit_block(block.piece_index, block.offset);
+    on_block_received(block_info);
+    co_return std::expected<void, std::error_code>{};
+}
+
 void PeerConnection::handle_message(message::Message msg) {
     using message::MessageType;
     switch (msg.id) {
         case MessageType::CHOKE:
             peer_choking_ = true;
+            // A choking peer discards the requests it did not answer
+            return_pending_blocks();
             break;
         case MessageType::UNCHOKE:
             peer_choking_ = false;
+            request_refill();
             break;
         case MessageType::HAVE:
             handle_have_message(*msg.payload);
@@ -437,17 +442,24 @@ void PeerConnection::handle_message(message::Message msg) {
 void PeerConnection::handle_have_message(std::span<std::byte> payload) {
     uint32_t piece_index{};
     std::ranges::copy(std::span<std::byte, 4>(payload), reinterpret_cast<std::byte*>(&piece_index));
-    piece_index            = utils::network_to_host_order(piece_index);
-    bitfield_[piece_index] = true;
+    piece_index = utils::network_to_host_order(piece_index);
+    // A piece the peer already announced must not be counted twice
+    if (piece_index >= bitfield_.size() || bitfield_.test(piece_index)) {
+        return;
+    }
+    bitfield_.set(piece_index);
     piece_manager_.add_available_piece(piece_index);
+
+    if (request_pipeline_.get_free_slots() > 0) {
+        request_refill();
+    }
 }
 
 void PeerConnection::handle_bitfield_message(std::span<std::byte> payload) {
-    for (auto i : std::views::iota(0U, bitfield_.size())) {
-        bitfield_[i] = (static_cast<uint8_t>(payload[i >> 3]) >> (7U - (i & 7U))) & 1U;
-    }
-    piece_manager_.add_peer_bitfield(bitfield_);
+    bitfield_ = Bitfield::from_bytes(payload, bitfield_.size());
+    is_seed_           = piece_manager_.add_peer_bitfield(bitfield_);
     bitfield_received_ = true;
+    request_refill();
 }
 
 void PeerConnection::handle_piece_message(std::span<std::byte> payload) {
@@ -457,27 +469,29 @@ void PeerConnection::handle_piece_message(std::span<std::byte> payload) {
     }
     auto [piece_index, block_data, block_offset] = *parsed_message;
     piece_manager_.receive_block(piece_index, block_data, block_offset);
+    on_block_received({piece_index, block_offset, block_data.size()});
+}
 
-    if (pending_requests_.count == 0U) {
-        return;
-    }
-
-    std::tuple<uint32_t, uint32_t, uint32_t> block_info{
-        piece_index, block_offset, block_data.size()
-    };
+void PeerConnection::on_block_received(const RequestPipeline::BlockInfo& block_info) {
+    request_pipeline_.receive(block_info, std::chrono::steady_clock::now());
 
-    for (auto i : std::views::iota(0U, pending_requests_.count)) {
-        if (pending_requests_.blocks_info[i].first == block_info) {
-            std::swap(
-                pending_requests_.blocks_info[i],
-                pending_requests_.blocks_info[pending_requests_.count - 1]
-            );
-            --pending_requests_.count;
-            break;
-        }
+    // Refill once a part of the pipeline drained, so the requests go out in batches while the
+    // rest of the pipeline keeps the peer busy
+    auto depth{request_pipeline_.get_depth()};
+    if (request_pipeline_.get_free_slots() >= std::max(depth / REFILL_RATIO, 1U)) {
+        request_refill();
     }
 }
 
+void PeerConnection::return_pending_blocks() {
+    request_pipeline_.remove_if([this](const RequestPipeline::Request& request) {
+        auto [piece_index, block_offset, block_size] = request.block_info;
+        piece_manager_.return_block(piece_index, block_offset, request.deadline_tick);
+        return true;
+    });
+    piece_manager_.release_pieces(request_cursor_);
+}
+
 void PeerConnection::handle_failure(std::error_code ec) {
     // Set the state appropriately
     state_ = ec == asio::error::timed_out ? PeerState::TIMED_OUT : PeerState::DISCONNECTED;
@@ -486,15 +500,17 @@ void PeerConnection::handle_failure(std::error_code ec) {
 }
 
 void PeerConnection::reset_state() {
-    state_                  = PeerState::UNINITIATED;
-    am_choking_             = true;
-    am_interested_          = false;
-    peer_choking_           = true;
-    peer_interested_        = false;
-    pending_requests_.count = 0;
-    pending_requests_.blocks_info.clear();
+    state_           = PeerState::UNINITIATED;
+    am_choking_      = true;
+    am_interested_   = false;
+    peer_choking_    = true;
+    peer_interested_ = false;
+    request_pipeline_.clear();
+    refill_requested_  = false;
     bitfield_received_ = false;
+    is_seed_           = false;
     was_connected_     = false;
+    request_cursor_    = {};
 }
 
 awaitable<void> PeerConnection::connect(
@@ -600,24 +616,32 @@ awaitable<void> PeerConnection::run() {
 
     // Resize the bitfield
 
-    bitfield_.resize(piece_manager_.get_piece_count());
-
-    // Resize the pending requests
-    pending_requests_.blocks_info.resize(MAX_BLOCKS_IN_FLIGHT);
+    bitfield_ = Bitfield(piece_manager_.get_piece_count());
 
-    // Resize the receive buffer to the max size of a payload received at once
+    // Size the receive buffer for the largest payload received at once
     // (either a piece msg or bitfield msg)
 
-    receive_buffer_.resize(
+    receive_buffer_ = message::MessageBuffer(
         std::max(8 + static_cast<size_t>(BLOCK_SIZE), utils::ceil_div(bitfield_.size(), 8uz))
     );
 
-    // Start the send requests and receive messages coroutines
+    // Start the send requests and receive messages coroutines, with a single watchdog that the
+    // receiver pushes back on every read instead of a timer per read
+
+    receive_deadline_ = std::chrono::steady_clock::now() + duration::RECEIVE_MSG_TIMEOUT;
+
+    if (auto result =
+            co_await (send_requests() || receive_messages() || utils::watchdog(receive_deadline_));
+        result.index() == 2) {
+        LOG_DEBUG("Timed out receiving messages from peer {}:{}", peer_info_.ip, peer_info_.port);
+        handle_failure(asio::error::timed_out);
+    }
 
-    co_await (send_requests() || receive_messages());
+    // The blocks still in flight are requested from the other peers
+    return_pending_blocks();
 
     if (bitfield_received_) {
-        piece_manager_.remove_peer_bitfield(bitfield_);
+        piece_manager_.remove_peer_bitfield(bitfield_, is_seed_);
     }
 
     LOG_DEBUG("Peer {}:{} stopped running", peer_info_.ip, peer_info_.port);
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "Bitfield.hpp"
 #include "Constant.hpp"
+#include "MessageBuffer.hpp"
 #include "PeerInfo.hpp"
 #include "PieceManager.hpp"
+#include "RequestPipeline.hpp"
 #include "TorrentMessage.hpp"
 
 #include <asio.hpp>
@@ -11,6 +14,8 @@
 #include <expected>
 #include <span>
 #include <string_view>
+#include <tuple>
+#include <vector>
 
 namespace torrent::peer {
 
@@ -22,6 +27,7 @@ class PeerConnection {
             asio::io_context& io_context, PieceManager& piece_manager, PeerInfo peer_info
         )
             : socket_{io_context},
+              refill_timer_{io_context},
               piece_manager_{piece_manager},
               peer_info_{std::move(peer_info)} {}
 
@@ -104,6 +110,7 @@ class PeerConnection {
 
         /**
          * @brief Same as load_block_requests but for endgame mode
+         * The requests are appended to the cancels already in the send_buffer
          */
         uint32_t endgame_load_block_requests(uint32_t num_blocks);
 
@@ -122,6 +129,16 @@ class PeerConnection {
          */
         uint32_t endgame_refresh_pending_requests();
 
+        /**
+         * @brief Wait until a message calls for more requests, or until the next request interval
+         */
+        asio::awaitable<void> wait_for_refill();
+
+        /**
+         * @brief Wake the sender so it tops up the pipeline
+         */
+        void request_refill();
+
         /**
          * @brief Send the next block requests to the peer
          */
@@ -137,6 +154,16 @@ class PeerConnection {
          */
         asio::awaitable<void> receive_messages();
 
+        /**
+         * @brief Receive the rest of a partly buffered block straight into its piece
+         * The block is left in the receive buffer if it was not requested or is not needed
+         *
+         * @param block the partly buffered block
+         * @return void if the block was received or left in the buffer, an error code otherwise
+         */
+        auto receive_block_in_place(const message::PartialBlock& block)
+            -> asio::awaitable<std::expected<void, std::error_code>>;
+
         /**
          * @brief Handle a message received from the peer
          */
@@ -170,6 +197,19 @@ class PeerConnection {
          */
         void handle_piece_message(std::span<std::byte> payload);
 
+        /**
+         * @brief Take a received block out of the pipeline and wake the sender if needed
+         *
+         * @param block_info the block
+         */
+        void on_block_received(const RequestPipeline::BlockInfo& block_info);
+
+        /**
+         * @brief Hand the blocks in flight and the pieces owned back to the piece manager, when
+         * the peer will not send them
+         */
+        void return_pending_blocks();
+
         /**
          * @brief Reset the state of the peer connection
          * Used when connecting/reconnecting to a peer
@@ -177,9 +217,11 @@ class PeerConnection {
         void reset_state();
 
         asio::ip::tcp::socket socket_;
-        PieceManager&         piece_manager_;
-        PeerInfo              peer_info_;
-        uint8_t               retries_left_{MAX_RETRIES};
+        // Timer the sender waits on between refills, cancelled to wake it early
+        asio::steady_timer refill_timer_;
+        PieceManager&      piece_manager_;
+        PeerInfo           peer_info_;
+        uint8_t            retries_left_{MAX_RETRIES};
 
         // client is choking the peer
         bool am_choking_{true};
@@ -195,28 +237,27 @@ class PeerConnection {
         bool was_connected_{false};
         // Flag to indicate whether bitfield was received
         bool bitfield_received_{false};
+        // Flag to indicate whether the peer was counted as a seed when its bitfield was received
+        bool is_seed_{false};
+        // Flag to indicate whether a message called for more requests while the sender was busy
+        bool refill_requested_{false};
 
         // Buffer for the sent messages
         std::vector<std::byte> send_buffer_;
-        // Buffer for the received messages
-        // Initialize the buffer with the size of the handshake message, and resize it after the
-        // connection is done
-        std::vector<std::byte> receive_buffer_{message::HANDSHAKE_MESSAGE_SIZE};
-
-        std::vector<bool> bitfield_;
-
-        struct {
-                // The info of the pending blocks in form of
-                // ((piece_index, block_offset, block_size), request_time)
-                // The size of this vector should be at most MAX_BLOCKS_IN_FLIGHT
-                std::vector<std::pair<
-                    std::tuple<uint32_t, uint32_t, uint32_t>,
-                    std::chrono::steady_clock::time_point>>
-                    blocks_info;
-                // The number of blocks in flight
-                uint32_t count{0};
-
-        } pending_requests_;
+        // Buffer for the received messages, sized once the connection is done
+        message::MessageBuffer receive_buffer_;
+        // Time after which the peer is timed out if nothing was received
+        std::chrono::steady_clock::time_point receive_deadline_;
+
+        Bitfield bitfield_;
+
+        // State of the picker for the peer, e.g. where its next batch of requests starts
+        PieceManager::RequestCursor request_cursor_;
+        // Blocks picked for the current batch of requests, kept to reuse its memory
+        std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> block_requests_;
+
+        // The blocks requested from the peer and not received yet
+        RequestPipeline request_pipeline_;
 
         std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> endgame_remaining_blocks_;
 };
@@ -7,6 +7,7 @@
 
 #include <asio.hpp>
 #include <asio/experimental/as_tuple.hpp>
+#include <chrono>
 #include <exception>
 #include <thread>
 
@@ -79,6 +80,8 @@ void PeerManager::start() {
     utils_thread_ = std::jthread([this] { utils_ctx_.run(); });
     // Start the cleanup task
     co_spawn(utils_ctx_, cleanup_peer_connections(), asio::detached);
+    // Start the clock of the block requests
+    co_spawn(peer_conn_ctx_, tick_piece_manager(), asio::detached);
 
     started_ = true;
     LOG_DEBUG("PeerManager started");
@@ -135,6 +138,14 @@ asio::awaitable<void> PeerManager::try_reconnection(
     co_return;
 }
 
+awaitable<void> PeerManager::tick_piece_manager() {
+    while (started_) {
+        co_await asio::steady_timer(co_await this_coro::executor, duration::REQUEST_INTERVAL)
+            .async_wait(use_nothrow_awaitable);
+        piece_manager_->tick(std::chrono::steady_clock::now());
+    }
+}
+
 awaitable<void> PeerManager::cleanup_peer_connections() {
     while (started_) {
         co_await asio::steady_timer(co_await this_coro::executor, duration::PEER_CLEANUP_INTERVAL)
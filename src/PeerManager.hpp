@@ -92,6 +92,15 @@ class PeerManager {
          */
         asio::awaitable<void> cleanup_peer_connections();
 
+        /**
+         * @brief Drive the coarse clock of the block requests of the piece manager
+         * It runs on the context of the peer connections, which are the only users of the piece
+         * manager
+         *
+         * @note This function will run as long as the peer manager is running
+         */
+        asio::awaitable<void> tick_piece_manager();
+
         asio::io_context                                           peer_conn_ctx_;
         asio::executor_work_guard<asio::io_context::executor_type> peer_conn_work_guard_{
             asio::make_work_guard(peer_conn_ctx_)
@@ -1,21 +1,81 @@
 #include "Piece.hpp"
 
 #include <algorithm>
-#include <chrono>
+#include <cstdint>
 #include <ranges>
 
 namespace torrent {
 
-void Piece::receive_block(std::span<const std::byte> block, size_t offset) {
+Piece::~Piece() {
+    for (auto* block : block_data_) {
+        block_data_alloc_.deallocate(block, BLOCK_SIZE);
+    }
+}
+
+bool Piece::receive_block(std::span<const std::byte> block, size_t offset) {
+    // ignore the blocks that do not belong to the piece
+    if (!is_valid_block(offset, block.size())) {
+        return false;
+    }
+
+    // if the block was never requested, is already received, or is being received straight into
+    // the piece, ignore it
     auto block_index{get_block_index(offset)};
+    if (block_data_[block_index] == nullptr || is_block_received(block_index) ||
+        reserved_blocks_[block_index]) {
+        return false;
+    }
 
-    // if the block is already received, ignore it
-    if (is_block_received(block_index)) {
-        return;
+    std::ranges::copy(block, block_data_[block_index]);
+    mark_block_received(block_index);
+    return true;
+}
+
+auto Piece::reserve_block(uint32_t offset, uint32_t size) -> std::optional<std::span<std::byte>> {
+    if (!is_valid_block(offset, size)) {
+        return std::nullopt;
+    }
+
+    auto block_index{get_block_index(offset)};
+    if (block_data_[block_index] == nullptr || is_block_received(block_index) ||
+        reserved_blocks_[block_index]) {
+        return std::nullopt;
     }
 
-    std::ranges::copy(block, std::ranges::begin(piece_data_ | std::views::drop(offset)));
+    reserved_blocks_[block_index] = true;
+    return std::span<std::byte>(block_data_[block_index], size);
+}
+
+void Piece::commit_block(uint32_t offset) {
+    auto block_index{get_block_index(offset)};
+    assert(reserved_blocks_[block_index] && "Block not reserved");
+    reserved_blocks_[block_index] = false;
+    mark_block_received(block_index);
+}
+
+void Piece::release_block(uint32_t offset) {
+    auto block_index{get_block_index(offset)};
+    assert(reserved_blocks_[block_index] && "Block not reserved");
+    reserved_blocks_[block_index] = false;
+
+    // the block is requested again right away, its request is lost with the peer
+    block_deadline_[block_index] = NOT_REQUESTED;
+    timed_out_blocks_.push_back(static_cast<uint16_t>(block_index));
+}
+
+bool Piece::is_memory_in_use(bool written_through) const {
+    for (uint16_t block_index{0}; block_index < blocks_cnt_; ++block_index) {
+        // a received block keeps its memory until it is written
+        if (reserved_blocks_[block_index] ||
+            (written_through && is_block_received(block_index) &&
+             block_data_[block_index] != nullptr)) {
+            return true;
+        }
+    }
+    return false;
+}
 
+void Piece::mark_block_received(size_t block_index) {
     // mark the block as received by moving it to the end of the remaining blocks vector
     auto swapped_block{remaining_blocks_[blocks_left_ - 1]};
     std::swap(
@@ -25,30 +85,82 @@ void Piece::receive_block(std::span<const std::byte> block, size_t offset) {
 
     // decrement the number of blocks left
     --blocks_left_;
+
+    // The block that completes the piece and the blocks after it are left to the hasher, so the
+    // whole piece is never hashed on the receiving thread
+    if (is_complete()) {
+        return;
+    }
+
+    // hash the blocks received in order while they are still in the cache, up to the first block
+    // already written to disk and freed
+    for (; is_block_received(hashed_blocks_) && block_data_[hashed_blocks_] != nullptr;
+         ++hashed_blocks_) {
+        auto block_data{get_block_data(hashed_blocks_)};
+        hash_context_.update(std::span<const uint8_t>(
+            reinterpret_cast<const uint8_t*>(block_data.data()), block_data.size()
+        ));
+    }
 }
 
-auto Piece::request_next_block() -> std::optional<std::pair<uint32_t, uint32_t>> {
-    for (auto block_index : remaining_blocks_ | std::views::take(blocks_left_)) {
-        bool timed_out{is_block_timed_out(block_index)};
-        bool block_requested{is_block_requested(block_index)};
+auto Piece::request_next_block(uint64_t deadline_tick)
+    -> std::optional<std::pair<uint32_t, uint32_t>> {
+    // request the timed out blocks again first, since they hold back the hashing of the piece
+    if (auto block_info{request_timed_out_block(deadline_tick)}; block_info.has_value()) {
+        return block_info;
+    }
 
-        // if the block has been received or it has not timed out, skip it
-        if (is_block_received(block_index) || (block_requested && !timed_out)) {
-            continue;
-        }
+    if (next_unrequested_block_ == blocks_cnt_) {
+        return std::nullopt;
+    }
+
+    // the memory of the block is taken from the pool once it is in flight
+    auto* block{block_data_alloc_.allocate(BLOCK_SIZE)};
+    if (block == nullptr) {
+        return std::nullopt;
+    }
+    block_data_[next_unrequested_block_] = block;
+    ++allocated_blocks_;
 
-        unrequested_blocks_ -= static_cast<size_t>(!block_requested);
+    --unrequested_blocks_;
+    return request_block(next_unrequested_block_++, deadline_tick);
+}
 
-        block_request_time_[block_index] = std::chrono::steady_clock::now();
+auto Piece::request_timed_out_block(uint64_t deadline_tick)
+    -> std::optional<std::pair<uint32_t, uint32_t>> {
+    // lowest first, so the blocks received in order are hashed sooner
+    while (!timed_out_blocks_.empty()) {
+        auto block_it{std::ranges::min_element(timed_out_blocks_)};
+        auto block_index{*block_it};
+        *block_it = timed_out_blocks_.back();
+        timed_out_blocks_.pop_back();
 
-        uint32_t offset{static_cast<uint32_t>(block_index) * BLOCK_SIZE};
-        uint32_t block_size{
-            block_index == blocks_cnt_ - 1 ? 1 + (piece_size_ - 1) % BLOCK_SIZE : BLOCK_SIZE
-        };
+        // the block may have arrived, or be arriving, after its request timed out
+        if (!is_block_received(block_index) && !reserved_blocks_[block_index]) {
+            return request_block(block_index, deadline_tick);
+        }
+    }
+    return std::nullopt;
+}
 
-        return std::make_pair(offset, block_size);
+bool Piece::expire_block(uint16_t block_index, uint64_t deadline_tick) {
+    // a reserved block is being received, it is queued again only if it is released
+    if (is_block_received(block_index) || reserved_blocks_[block_index] ||
+        block_deadline_[block_index] != deadline_tick) {
+        return false;
     }
 
-    return std::nullopt;
+    block_deadline_[block_index] = NOT_REQUESTED;
+    timed_out_blocks_.push_back(block_index);
+    return true;
+}
+
+auto Piece::request_block(uint16_t block_index, uint64_t deadline_tick)
+    -> std::pair<uint32_t, uint32_t> {
+    block_deadline_[block_index] = deadline_tick;
+
+    return std::make_pair(
+        static_cast<uint32_t>(block_index) * BLOCK_SIZE, get_block_length(block_index)
+    );
 }
 };  // namespace torrent
@@ -1,13 +1,15 @@
 #pragma once
 
 #include "Constant.hpp"
-#include "Duration.hpp"
+#include "Crypto.hpp"
 #include "FixedSizeAllocator.hpp"
 #include "Utils.hpp"
 
+#include <algorithm>
 #include <cassert>
-#include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <optional>
 #include <ranges>
 #include <span>
@@ -17,21 +19,27 @@ namespace torrent {
 
 class Piece {
     public:
+        /**
+         * @brief Create a piece without any block memory
+         *
+         * @param size             the size of the piece
+         * @param block_data_alloc the allocator of the blocks, each block being allocated when it
+         *                         is first requested
+         * @param piece_util_alloc the allocator of the vectors that manage the remaining blocks
+         */
         Piece(
             uint32_t                                       size,
-            torrent::utils::FixedSizeAllocator<std::byte>& piece_data_alloc,
-            torrent::utils::FixedSizeAllocator<uint16_t>&  piece_util_alloc,
-            std::chrono::milliseconds request_timeout = duration::REQUEST_TIMEOUT
+            torrent::utils::FixedSizeAllocator<std::byte>& block_data_alloc,
+            torrent::utils::FixedSizeAllocator<uint16_t>&  piece_util_alloc
         )
             : piece_size_{size},
               blocks_cnt_{utils::ceil_div(size, BLOCK_SIZE)},
               blocks_left_{blocks_cnt_},
               unrequested_blocks_{blocks_cnt_},
-              block_request_timeout_{request_timeout},
-              piece_data_(size, piece_data_alloc),
-              block_request_time_(
-                  blocks_cnt_, std::chrono::time_point<std::chrono::steady_clock>::min()
-              ),
+              block_data_alloc_{block_data_alloc},
+              block_data_(blocks_cnt_, nullptr),
+              block_deadline_(blocks_cnt_, NOT_REQUESTED),
+              reserved_blocks_(blocks_cnt_, false),
               remaining_blocks_(blocks_cnt_, piece_util_alloc),
               block_pos_in_rem_(blocks_cnt_, piece_util_alloc) {
             // Fill the vectors with the indices of the blocks
@@ -40,23 +48,117 @@ class Piece {
             }
         }
 
+        Piece(const Piece&)            = delete;
+        Piece& operator=(const Piece&) = delete;
+        Piece(Piece&&)                 = delete;
+        Piece& operator=(Piece&&)      = delete;
+
+        /**
+         * @brief Give the memory of the blocks back to the allocator
+         */
+        ~Piece();
+
         /**
          * @brief  Receive a previously requested block of data.
+         * A block that was never requested has no memory and is ignored. The blocks that extend the
+         * prefix of the piece received in order are hashed right away,
+         * while they are still in the cache, except for the block that completes the piece
          *
          * @param block  the block of data
          * @param offset the offset of the block in the piece
+         * @return true if the block was received, false if it was ignored
+         */
+        bool receive_block(std::span<const std::byte> block, size_t offset);
+
+        /**
+         * @brief Reserve the memory of a block, to receive the block straight into the piece.
+         * The block is ignored when received from another peer until it is committed or released
+         *
+         * @param offset the offset of the block in the piece
+         * @param size   the size of the block
+         * @return a span to write the block to, or an empty optional if the block is invalid,
+         *         never requested, already received or already reserved
+         */
+        auto reserve_block(uint32_t offset, uint32_t size) -> std::optional<std::span<std::byte>>;
+
+        /**
+         * @brief Mark a reserved block as received once its data was written to the piece.
+         *
+         * @param offset the offset of the block in the piece
+         */
+        void commit_block(uint32_t offset);
+
+        /**
+         * @brief Give up a reserved block whose data could not be received, so it is requested
+         * again.
+         *
+         * @param offset the offset of the block in the piece
          */
-        void receive_block(std::span<const std::byte> block, size_t offset);
+        void release_block(uint32_t offset);
 
         /**
          * @brief Returns the offset of the next block to be requested.
          *
-         *@return a pair containing the offset and the size of the block to be requested
-         *         If there are no more blocks to be requested, returns an empty optional
+         * @param deadline_tick the tick of the coarse clock at which the request times out
+         * @return a pair containing the offset and the size of the block to be requested
+         *         If there are no more blocks to be requested, or no memory left for a new block,
+         *         returns an empty optional
+         *
+         * @note Timed out blocks are requested again first, then the unrequested blocks are
+         * requested in ascending order, so the piece can be hashed as the blocks arrive. The memory
+         * of a block is allocated on its first request, so a received block always has a place
+         */
+        auto request_next_block(uint64_t deadline_tick)
+            -> std::optional<std::pair<uint32_t, uint32_t>>;
+
+        /**
+         * @brief Returns the offset of the next block whose request timed out or was dropped.
+         *
+         * @param deadline_tick the tick of the coarse clock at which the request times out
+         * @return a pair containing the offset and the size of the block to be requested
+         *         If no block is waiting to be requested again, returns an empty optional
+         */
+        auto request_timed_out_block(uint64_t deadline_tick)
+            -> std::optional<std::pair<uint32_t, uint32_t>>;
+
+        /**
+         * @brief Queue a block whose request timed out to be requested again.
          *
-         * @note In endgame mode, timeouts are ignored
+         * @param block_index   the index of the block
+         * @param deadline_tick the deadline of the timed out request
+         * @return true if the block is queued, false if it was received or requested again since
          */
-        auto request_next_block() -> std::optional<std::pair<uint32_t, uint32_t>>;
+        bool expire_block(uint16_t block_index, uint64_t deadline_tick);
+
+        /**
+         * @brief Give the memory of a received block back to the allocator, once the block is
+         * written to disk.
+         * The block is then read back from the disk to hash it, unless it was hashed already
+         *
+         * @param block_index the index of the block
+         */
+        void free_block_data(size_t block_index) {
+            assert(is_block_received(block_index) && "Block not received");
+            block_data_alloc_.deallocate(block_data_[block_index], BLOCK_SIZE);
+            block_data_[block_index] = nullptr;
+            --allocated_blocks_;
+        }
+
+        /**
+         * @brief Get the number of blocks holding memory, i.e. requested or received and not freed.
+         *
+         * @return the number of blocks
+         */
+        [[nodiscard]] size_t get_allocated_blocks_cnt() const { return allocated_blocks_; }
+
+        /**
+         * @brief Check if the memory of a block is used outside of the piece, i.e. a block is
+         * being received in place, or a received block is still being written to disk.
+         *
+         * @param written_through true if the blocks are written as soon as they are received
+         * @return true if the piece must not be destroyed yet
+         */
+        [[nodiscard]] bool is_memory_in_use(bool written_through) const;
 
         /**
          * @brief Check if the piece is complete.
@@ -66,12 +168,37 @@ class Piece {
         [[nodiscard]] bool is_complete() const { return blocks_left_ == 0; }
 
         /**
-         * @brief Get a view to the underlying data of the piece.
+         * @brief Get a view to the data of a block.
+         *
+         * @param block_index the index of the block
+         * @return a span containing the data of the block
+         * @note The span is only valid if the block is received
+         */
+        [[nodiscard]] std::span<const std::byte> get_block_data(size_t block_index) const {
+            return {block_data_[block_index], get_block_length(block_index)};
+        }
+
+        /**
+         * @brief Get the number of blocks of the piece.
+         *
+         * @return the number of blocks
+         */
+        [[nodiscard]] size_t get_blocks_cnt() const { return blocks_cnt_; }
+
+        /**
+         * @brief Get the number of blocks at the start of the piece that have already been hashed.
          *
-         * @return a span containing the data of the piece
-         * @note The span is only valid if the piece is complete
+         * @return the index of the first block left to hash
          */
-        std::span<const std::byte> get_data() { return piece_data_; }
+        [[nodiscard]] size_t get_hashed_blocks_cnt() const { return hashed_blocks_; }
+
+        /**
+         * @brief Take the hash context that consumed the blocks received in order.
+         *
+         * @return the hash context, to be updated with the unhashed data of the piece
+         * @note The piece must not receive any block afterwards
+         */
+        crypto::Sha1Context take_hash_context() { return std::move(hash_context_); }
 
         /**
          * @brief Get the number of blocks that have not been requested yet.
@@ -132,38 +259,71 @@ class Piece {
         }
 
     private:
+        // Deadline of the blocks that are not waiting for an answer
+        static constexpr uint64_t NOT_REQUESTED{std::numeric_limits<uint64_t>::max()};
+
+        /**
+         * @brief Mark a block as requested.
+         *
+         * @param block_index   the index of the block
+         * @param deadline_tick the tick of the coarse clock at which the request times out
+         * @return a pair containing the offset and the size of the block
+         */
+        auto request_block(uint16_t block_index, uint64_t deadline_tick)
+            -> std::pair<uint32_t, uint32_t>;
+
         /**
-         * @brief Check if a block request has timed out.
+         * @brief Get the size of a block, the last block of the piece may be shorter.
          *
          * @param block_index the index of the block
-         * @return true if the block request has timed out, false otherwise
+         * @return the size of the block
          */
-        [[nodiscard]] bool is_block_timed_out(uint16_t block_index) const {
-            return std::chrono::steady_clock::now() - block_request_timeout_ >
-                   block_request_time_[block_index];
+        [[nodiscard]] uint32_t get_block_length(size_t block_index) const {
+            return block_index == blocks_cnt_ - 1 ? 1 + (piece_size_ - 1) % BLOCK_SIZE : BLOCK_SIZE;
         }
 
         /**
-         * @brief Check if a block has been requested.
+         * @brief Check if a block received from a peer fits in the piece.
          *
-         * @param block_index the index of the block
-         * @return true if the block has been requested, false otherwise
+         * @param offset the offset of the block
+         * @param size   the size of the block
+         * @return true if the block is one of the blocks of the piece
          */
-        [[nodiscard]] bool is_block_requested(uint16_t block_index) const {
-            return block_request_time_[block_index] !=
-                   std::chrono::time_point<std::chrono::steady_clock>::min();
+        [[nodiscard]] bool is_valid_block(size_t offset, size_t size) const {
+            return offset % BLOCK_SIZE == 0 && offset < piece_size_ &&
+                   size == get_block_length(offset / BLOCK_SIZE);
         }
 
-        const uint32_t            piece_size_;
-        const size_t              blocks_cnt_;
-        size_t                    blocks_left_;
-        size_t                    unrequested_blocks_;
-        std::chrono::milliseconds block_request_timeout_;
-        std::vector<std::byte, torrent::utils::FixedSizeAllocator<std::byte>> piece_data_;
+        /**
+         * @brief Mark a block as received and hash the blocks received in order.
+         *
+         * @param block_index the index of the block
+         */
+        void mark_block_received(size_t block_index);
+
+        const uint32_t piece_size_;
+        const size_t   blocks_cnt_;
+        size_t         blocks_left_;
+        size_t         unrequested_blocks_;
+        // Memory of each block, nullptr until the block is first requested or once it is freed
+        utils::FixedSizeAllocator<std::byte> block_data_alloc_;
+        std::vector<std::byte*>              block_data_;
+        size_t                               allocated_blocks_{0};
+        // Index of the first block that has never been requested, the blocks are requested in
+        // ascending order
+        uint16_t next_unrequested_block_{0};
+
+        // Number of blocks at the start of the piece that were received in order and hashed
+        size_t              hashed_blocks_{0};
+        crypto::Sha1Context hash_context_;
 
-        // Request time of each block
-        // Unrequested = time_point::min()
-        std::vector<std::chrono::time_point<std::chrono::steady_clock>> block_request_time_;
+        // Deadline of the last request of each block, set by the peer it was requested from,
+        // NOT_REQUESTED if no answer is expected
+        std::vector<uint64_t> block_deadline_;
+        // Blocks whose request timed out, waiting to be requested again
+        std::vector<uint16_t> timed_out_blocks_;
+        // Blocks being received straight into the piece
+        std::vector<bool> reserved_blocks_;
         // Vector containing indices of blocks that have not been received (will be moving the
         // received blocks to the end, pointed by blocks_left)
         // Using blocks_left as a pointer to the first received block
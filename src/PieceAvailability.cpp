@@ -0,0 +1,79 @@
+#include "PieceAvailability.hpp"
+
+#include "Constant.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace torrent {
+
+PieceAvailability::PieceAvailability(size_t pieces_cnt, uint32_t seed)
+    : pieces_(pieces_cnt),
+      piece_pos_(pieces_cnt),
+      availability_(pieces_cnt, 0),
+      bucket_start_{0, static_cast<uint32_t>(pieces_cnt)} {
+    std::iota(pieces_.begin(), pieces_.end(), 0);
+    // Shuffle the pieces once, the moves between buckets keep the ties in a random order
+    std::ranges::shuffle(pieces_, std::mt19937{seed});
+    for (uint32_t pos{0}; pos < pieces_cnt; ++pos) {
+        piece_pos_[pieces_[pos]] = pos;
+    }
+}
+
+void PieceAvailability::add_bitfield(const Bitfield& bitfield) {
+    assert(bitfield.size() == pieces_.size() && "Bitfield of a different torrent");
+    if (is_dense(bitfield)) {
+        bitfield.add_to(availability_);
+        rebuild_buckets();
+        return;
+    }
+    for (auto piece_index{bitfield.find_next_set(0)}; piece_index < bitfield.size();
+         piece_index = bitfield.find_next_set(piece_index + 1)) {
+        increment(static_cast<uint32_t>(piece_index));
+    }
+}
+
+void PieceAvailability::remove_bitfield(const Bitfield& bitfield) {
+    assert(bitfield.size() == pieces_.size() && "Bitfield of a different torrent");
+    if (is_dense(bitfield)) {
+        bitfield.subtract_from(availability_);
+        rebuild_buckets();
+        return;
+    }
+    for (auto piece_index{bitfield.find_next_set(0)}; piece_index < bitfield.size();
+         piece_index = bitfield.find_next_set(piece_index + 1)) {
+        decrement(static_cast<uint32_t>(piece_index));
+    }
+}
+
+bool PieceAvailability::is_dense(const Bitfield& bitfield) const {
+    // Each piece moved to another bucket costs a few random accesses, while a rebuild goes over
+    // all the pieces
+    return bitfield.count() * peer::DENSE_BITFIELD_RATIO >= pieces_.size();
+}
+
+void PieceAvailability::rebuild_buckets() {
+    if (pieces_.empty()) {
+        return;
+    }
+
+    // Count the pieces of each availability, then turn the counts into the bucket boundaries
+    bucket_start_.assign(static_cast<size_t>(std::ranges::max(availability_)) + 2, 0);
+    for (auto avail : availability_) {
+        ++bucket_start_[avail + 1];
+    }
+    std::partial_sum(bucket_start_.begin(), bucket_start_.end(), bucket_start_.begin());
+
+    // Distribute the pieces in their current order, so the ties keep their order
+    std::vector<uint32_t> next_pos(bucket_start_.begin(), bucket_start_.end() - 1);
+    std::vector<uint32_t> pieces(pieces_.size());
+    for (auto piece_index : pieces_) {
+        auto pos{next_pos[availability_[piece_index]]++};
+        pieces[pos]             = piece_index;
+        piece_pos_[piece_index] = pos;
+    }
+    pieces_.swap(pieces);
+    ++order_version_;
+}
+
+}  // namespace torrent
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "Bitfield.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace torrent {
+
+class PieceAvailability {
+    public:
+        /**
+         * @brief Create an index of the pieces ordered by the number of peers that have them
+         *
+         * @param pieces_cnt Number of pieces in the torrent
+         * @param seed Seed of the shuffle that breaks the ties between equally available pieces
+         */
+        explicit PieceAvailability(size_t pieces_cnt, uint32_t seed = std::random_device{}());
+
+        /**
+         * @brief Record that one more peer has a piece
+         *
+         * @param piece_index Index of the piece
+         */
+        void increment(uint32_t piece_index) {
+            auto avail{availability_[piece_index]};
+            if (static_cast<size_t>(avail) + 2 == bucket_start_.size()) {
+                // Open an empty bucket for the new highest availability
+                bucket_start_.push_back(static_cast<uint32_t>(pieces_.size()));
+            }
+            // Swap the piece with the last piece of its bucket, and move the bucket boundary
+            // over it
+            move_piece(piece_index, --bucket_start_[avail + 1]);
+            ++availability_[piece_index];
+        }
+
+        /**
+         * @brief Record that one less peer has a piece
+         *
+         * @param piece_index Index of the piece
+         */
+        void decrement(uint32_t piece_index) {
+            auto avail{availability_[piece_index]};
+            assert(avail > 0 && "Piece availability underflow");
+            // Swap the piece with the first piece of its bucket, and move the bucket boundary
+            // over it
+            move_piece(piece_index, bucket_start_[avail]++);
+            --availability_[piece_index];
+        }
+
+        /**
+         * @brief Record that a seed joined
+         * A seed has every piece, so it does not change the order of the pieces
+         */
+        void add_seed() { ++seeds_cnt_; }
+
+        /**
+         * @brief Record that a seed left
+         */
+        void remove_seed() {
+            assert(seeds_cnt_ > 0 && "Seed count underflow");
+            --seeds_cnt_;
+        }
+
+        /**
+         * @brief Get the number of seeds
+         *
+         * @return Number of seeds
+         */
+        [[nodiscard]] uint32_t get_seed_count() const { return seeds_cnt_; }
+
+        /**
+         * @brief Record the pieces of a peer that joined
+         *
+         * @param bitfield Bitfield of the peer
+         * @note The pieces of a peer that has most of them are counted all at once, and the
+         * buckets are rebuilt afterwards
+         */
+        void add_bitfield(const Bitfield& bitfield);
+
+        /**
+         * @brief Forget the pieces of a peer that left
+         *
+         * @param bitfield Bitfield of the peer
+         */
+        void remove_bitfield(const Bitfield& bitfield);
+
+        /**
+         * @brief Get the number of peers that have a piece
+         *
+         * @param piece_index Index of the piece
+         * @return Availability of the piece, seeds included
+         */
+        [[nodiscard]] uint32_t get_availability(uint32_t piece_index) const {
+            return availability_[piece_index] + seeds_cnt_;
+        }
+
+        /**
+         * @brief Get the pieces ordered from the rarest to the most available
+         *
+         * @return A view of the pieces, valid until the availability changes
+         * @note The order of equally available pieces is random
+         */
+        [[nodiscard]] auto get_rarest_first() const -> std::span<const uint32_t> {
+            return pieces_;
+        }
+
+        /**
+         * @brief Get the position of a piece in the rarest-first order
+         *
+         * @param piece_index Index of the piece
+         * @return Position of the piece in get_rarest_first()
+         */
+        [[nodiscard]] uint32_t get_rank(uint32_t piece_index) const {
+            return piece_pos_[piece_index];
+        }
+
+        /**
+         * @brief Get the version of the order of the pieces
+         *
+         * @return A number that changes every time the buckets are rebuilt, so a position in the
+         * order can be checked for staleness
+         * @note A single piece moved to another bucket only swaps places with another piece, so
+         * the positions stay meaningful and the version is kept
+         */
+        [[nodiscard]] uint64_t get_order_version() const { return order_version_; }
+
+    private:
+        /**
+         * @brief Check if a bitfield has enough pieces to be counted all at once
+         *
+         * @param bitfield Bitfield of a peer
+         * @return True if rebuilding the buckets is cheaper than moving each piece
+         */
+        [[nodiscard]] bool is_dense(const Bitfield& bitfield) const;
+
+        /**
+         * @brief Sort the pieces by availability again after the availabilities were changed
+         * directly
+         * The pieces keep their order within a bucket, so the ties stay in a random order
+         */
+        void rebuild_buckets();
+
+        /**
+         * @brief Swap a piece with the piece at a given position in the ordered pieces
+         *
+         * @param piece_index Index of the piece
+         * @param pos New position of the piece
+         */
+        void move_piece(uint32_t piece_index, uint32_t pos) {
+            auto other_piece{pieces_[pos]};
+            std::swap(pieces_[piece_pos_[piece_index]], pieces_[pos]);
+            std::swap(piece_pos_[piece_index], piece_pos_[other_piece]);
+        }
+
+        // Pieces ordered by availability, each availability forming a contiguous bucket
+        std::vector<uint32_t> pieces_;
+        // Position of each piece in pieces_
+        std::vector<uint32_t> piece_pos_;
+        // Number of peers that have the ith piece, seeds excluded
+        std::vector<uint16_t> availability_;
+        // Position in pieces_ of the first piece of each availability, followed by the number of
+        // pieces
+        std::vector<uint32_t> bucket_start_;
+        // Number of peers that have every piece, which are not counted in availability_
+        uint32_t seeds_cnt_{0};
+        // Incremented every time the buckets are rebuilt
+        uint64_t order_version_{0};
+};
+
+}  // namespace torrent
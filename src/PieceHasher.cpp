@@ -0,0 +1,87 @@
+#include "PieceHasher.hpp"
+
+#include "Constant.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+namespace torrent::crypto {
+
+PieceHasher::PieceHasher(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count =
+            std::clamp<size_t>(std::thread::hardware_concurrency(), 1, MAX_HASHER_THREADS);
+    }
+
+    hasher_threads_.reserve(thread_count);
+    for (size_t i{0}; i < thread_count; ++i) {
+        hasher_threads_.emplace_back([this](std::stop_token stop_token) {
+            run(std::move(stop_token));
+        });
+    }
+}
+
+PieceHasher::~PieceHasher() {
+    for (auto& hasher_thread : hasher_threads_) {
+        hasher_thread.request_stop();
+    }
+    for (auto& hasher_thread : hasher_threads_) {
+        if (hasher_thread.joinable()) {
+            hasher_thread.join();
+        }
+    }
+}
+
+void PieceHasher::submit(HashJob job) {
+    {
+        std::scoped_lock lock(queue_mutex_);
+        queue_.push_back(std::move(job));
+        queue_depth_.fetch_add(1, std::memory_order_relaxed);
+    }
+    queue_not_empty_.notify_one();
+}
+
+void PieceHasher::wait_idle() {
+    std::unique_lock lock(queue_mutex_);
+    queue_idle_.wait(lock, [this] { return queue_.empty() && active_jobs_ == 0; });
+}
+
+void PieceHasher::run(std::stop_token stop_token) {
+    while (true) {
+        std::unique_lock lock(queue_mutex_);
+
+        // Only returns false if a stop was requested and there is nothing left to hash
+        if (!queue_not_empty_.wait(lock, stop_token, [this] { return !queue_.empty(); })) {
+            return;
+        }
+
+        HashJob job{std::move(queue_.front())};
+        queue_.pop_front();
+        ++active_jobs_;
+
+        lock.unlock();
+
+        for (auto buffer : job.buffers) {
+            job.context.update(std::span<const uint8_t>(
+                reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size()
+            ));
+        }
+        auto hash{job.context.finalize()};
+
+        queue_depth_.fetch_sub(1, std::memory_order_relaxed);
+
+        if (job.on_complete) {
+            job.on_complete(hash == job.expected_hash);
+        }
+
+        lock.lock();
+        --active_jobs_;
+        if (queue_.empty() && active_jobs_ == 0) {
+            queue_idle_.notify_all();
+        }
+    }
+}
+
+}  // namespace torrent::crypto
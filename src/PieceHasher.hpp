@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Crypto.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace torrent::crypto {
+
+class PieceHasher {
+    public:
+        struct HashJob {
+                // The data to hash, e.g. the blocks of a piece, hashed one after the other. It must
+                // stay valid until the completion handler is called
+                std::vector<std::span<const std::byte>> buffers;
+                // The hash state of the data that precedes the buffers, if it was hashed
+                // incrementally
+                Sha1Context context;
+                // The hash the data is expected to have
+                Sha1 expected_hash;
+                // Called on a hasher thread once the data is hashed, with true if the hash matches
+                std::function<void(bool)> on_complete;
+        };
+
+        /**
+         * @brief Start the hasher threads
+         *
+         * @param thread_count the number of hasher threads, or 0 to use one thread per hardware
+         * thread, up to MAX_HASHER_THREADS
+         */
+        explicit PieceHasher(size_t thread_count = 0);
+
+        PieceHasher(const PieceHasher&)            = delete;
+        PieceHasher& operator=(const PieceHasher&) = delete;
+        PieceHasher(PieceHasher&&)                 = delete;
+        PieceHasher& operator=(PieceHasher&&)      = delete;
+
+        /**
+         * @brief Stop the hasher threads after all the queued jobs have been hashed
+         */
+        ~PieceHasher();
+
+        /**
+         * @brief Queue a hash job
+         *
+         * @param job the job to queue
+         */
+        void submit(HashJob job);
+
+        /**
+         * @brief Block until every queued job has been hashed and its completion handler has
+         * returned
+         */
+        void wait_idle();
+
+        /**
+         * @brief Get the number of jobs that have been queued but not yet hashed
+         *
+         * @return the number of pending jobs
+         * @note This function is thread-safe
+         */
+        [[nodiscard]] size_t get_queue_depth() const {
+            return queue_depth_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Main loop of a hasher thread
+         *
+         * @param stop_token token used to stop the thread once the queue is drained
+         */
+        void run(std::stop_token stop_token);
+
+        std::mutex                  queue_mutex_;
+        std::condition_variable_any queue_not_empty_;
+        std::condition_variable     queue_idle_;
+        std::deque<HashJob>         queue_;
+        // Number of jobs that have been popped from the queue but not completed yet
+        size_t active_jobs_{0};
+
+        std::atomic<size_t> queue_depth_{0};
+
+        // Must be the last member, so the threads are joined before the other members are
+        // destroyed
+        std::vector<std::jthread> hasher_threads_;
+};
+
+}  // namespace torrent::crypto
@@ -6,98 +6,265 @@
 #include <algorithm>
 #include <atomic>
 #include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <ranges>
 #include <span>
+#include <vector>
 
 namespace torrent {
 
-void PieceManager::update_pieces_availability(const std::vector<bool>& bitfield, int8_t sign) {
-    size_t set_bits{0U};
-    for (auto piece_idx : std::views::iota(0U, pieces_cnt_)) {
-        // Get the bit that represents the availability of the piece
-        int8_t cur_piece_avail{static_cast<int8_t>(bitfield[piece_idx])};
-        piece_avail_[piece_idx] += sign * cur_piece_avail;
-        set_bits += static_cast<size_t>(cur_piece_avail);
-    }
-    // Require resorting if the number of set bits changed
-    are_pieces_sorted_ &= (set_bits == 0);
-}
+void PieceManager::restore_completed_pieces(const std::vector<bool>& completed_pieces) {
+    piece_completed_ = Bitfield(completed_pieces);
 
-void PieceManager::add_available_piece(uint32_t piece_index) {
-    // If the pieces are sorted, we can update the availability without resorting the entire vector
-    if (are_pieces_sorted_) {
-        // The index in the sorted_pieces vector of the last piece with the same availability as the
-        // piece to be increased
-        auto last_equal_piece =
-            std::upper_bound(
-                sorted_pieces_.begin(),
-                sorted_pieces_.end(),
-                piece_avail_[piece_index],
-                [&](uint32_t a, uint32_t b) { return piece_avail_[a] < piece_avail_[b]; }
-            ) -
-            sorted_pieces_.begin() - 1;
-
-        // The index in the sorted_pieces vector of the piece to be increased
-        auto increased_piece = last_equal_piece;
-        for (; increased_piece > 0 && sorted_pieces_[increased_piece] != piece_index;
-             --increased_piece) {
-            ;
-        }
+    auto completed_cnt{piece_completed_.count()};
+    pieces_left_.store(pieces_cnt_ - completed_cnt, std::memory_order_release);
+    pieces_written_.store(completed_cnt, std::memory_order_release);
 
-        // Swap the piece with the last piece that has the same availability
-        std::swap(sorted_pieces_[increased_piece], sorted_pieces_[last_equal_piece]);
+    if (completed_cnt == pieces_cnt_) {
+        completion_flag_.test_and_set(std::memory_order_release);
     }
-    ++piece_avail_[piece_index];
 }
 
 void PieceManager::receive_block(
     uint32_t piece_index, std::span<const std::byte> block, uint32_t offset
 ) {
-    // If the piece is not requested, ignore the block
-    if (!requested_pieces_.contains(piece_index)) {
+    reclaim_finished_pieces();
+
+    // If the piece is not requested, or is already complete, ignore the block
+    auto* piece{piece_index < pieces_cnt_ ? active_pieces_.find(piece_index) : nullptr};
+    if (piece == nullptr || piece_pending_.test(piece_index)) {
         return;
     }
 
-    auto& piece = requested_pieces_.at(piece_index);
-    piece.receive_block(block, offset);
+    if (piece->receive_block(block, offset)) {
+        on_block_received(piece_index, *piece, offset);
+    }
+}
+
+auto PieceManager::reserve_block(uint32_t piece_index, uint32_t offset, uint32_t size)
+    -> std::optional<std::span<std::byte>> {
+    reclaim_finished_pieces();
+
+    auto* piece{piece_index < pieces_cnt_ ? active_pieces_.find(piece_index) : nullptr};
+    if (piece == nullptr || piece_pending_.test(piece_index)) {
+        return std::nullopt;
+    }
+    return piece->reserve_block(offset, size);
+}
+
+void PieceManager::commit_block(uint32_t piece_index, uint32_t offset) {
+    // A piece with a reserved block is neither complete nor reclaimed
+    auto& piece{*active_pieces_.find(piece_index)};
+    piece.commit_block(offset);
+    on_block_received(piece_index, piece, offset);
+}
+
+void PieceManager::on_block_received(uint32_t piece_index, Piece& piece, uint32_t offset) {
+    piece_progress_tick_[piece_index] = get_current_tick();
+
+    if (piece_buffering_ == PieceBuffering::WRITE_THROUGH) {
+        write_block(piece_index, piece, offset);
+    }
+
+    // Piece is complete, verify it off the network thread
+    if (piece.is_complete()) {
+        hash_piece(piece_index);
+    }
+}
+
+void PieceManager::hash_piece(uint32_t piece_index) {
+    // The piece keeps its slot, so its memory is kept alive until its result is reclaimed
+    piece_pending_.set(piece_index);
+    ++pending_pieces_cnt_;
+    pieces_hashing_.fetch_add(1, std::memory_order_release);
 
-    if (!piece.is_complete()) {
+    // The blocks of a piece written through are still being written, see reclaim_finished_pieces
+    if (piece_buffering_ == PieceBuffering::WRITE_THROUGH) {
         return;
     }
 
-    // Piece is complete
+    // The blocks are scattered in the pool, so they are hashed and written one after the other.
+    // Only the blocks that were not received in order are left to hash
+    auto&                                   piece{*active_pieces_.find(piece_index)};
+    std::vector<std::span<const std::byte>> unhashed_blocks;
+    std::vector<std::span<const char>>      piece_blocks;
+    piece_blocks.reserve(piece.get_blocks_cnt());
+    for (size_t block_index{0}; block_index < piece.get_blocks_cnt(); ++block_index) {
+        auto block_data{piece.get_block_data(block_index)};
+        if (block_index >= piece.get_hashed_blocks_cnt()) {
+            unhashed_blocks.push_back(block_data);
+        }
+        piece_blocks.emplace_back(
+            reinterpret_cast<const char*>(block_data.data()), block_data.size()
+        );
+    }
+
+    hasher_->submit(
+        {.buffers       = std::move(unhashed_blocks),
+         .context       = piece.take_hash_context(),
+         .expected_hash = get_piece_hash(piece_index),
+         .on_complete   = [this, piece_index, piece_blocks = std::move(piece_blocks)](bool valid) {
+             if (!valid) {
+                 pieces_hashing_.fetch_sub(1, std::memory_order_release);
+                 finish_piece(piece_index, PieceResult::HASH_MISMATCH);
+                 return;
+             }
+             // The piece counts as downloaded as soon as it is verified, so the peers stop
+             // requesting blocks even if no other block arrives to reclaim it. The hashing count is
+             // decreased first, so the endgame check never sees fewer pieces than there are left
+             pieces_hashing_.fetch_sub(1, std::memory_order_release);
+             pieces_left_.fetch_sub(1, std::memory_order_release);
+             write_piece(piece_index, piece_blocks);
+         }}
+    );
+}
+
+void PieceManager::write_piece(
+    uint32_t piece_index, std::vector<std::span<const char>> piece_blocks
+) {
+    disk_writer_->submit(
+        {.buffers     = std::move(piece_blocks),
+         .offset      = static_cast<size_t>(piece_index) * piece_size_,
+         .on_complete = [this, piece_index](bool written) { finish_write(piece_index, written); }}
+    );
+}
+
+void PieceManager::finish_write(uint32_t piece_index, bool written) {
+    finish_piece(piece_index, written ? PieceResult::WRITTEN : PieceResult::WRITE_FAILED);
+    if (written && on_piece_written_) {
+        on_piece_written_(piece_index);
+    }
+    if (written && pieces_written_.fetch_add(1, std::memory_order_acq_rel) + 1 == pieces_cnt_) {
+        completion_flag_.test_and_set(std::memory_order_release);
+    }
+}
 
-    auto piece_data{piece.get_data()};
-    auto piece_data_uint8_view{std::span<const uint8_t>(
-        reinterpret_cast<const uint8_t*>(piece_data.data()), piece_data.size()
-    )};
+void PieceManager::write_block(uint32_t piece_index, const Piece& piece, uint32_t offset) {
+    auto block_data{piece.get_block_data(Piece::get_block_index(offset))};
 
-    auto hash{crypto::Sha1::digest(piece_data_uint8_view)};
-    auto ref_hash{
-        crypto::Sha1::from_raw_data(piece_hashes_.data() + piece_index * crypto::SHA1_SIZE)
+    submit_write(
+        {.buffers = {std::span<const char>(
+             reinterpret_cast<const char*>(block_data.data()), block_data.size()
+         )},
+         .offset      = static_cast<size_t>(piece_index) * piece_size_ + offset,
+         .on_complete = [this, piece_index, offset](bool written) {
+             if (!written) {
+                 // The piece is read back before it is verified, so a lost block only fails its
+                 // hash check
+                 LOG_WARN("Block {} of piece {} could not be written", offset, piece_index);
+             }
+             std::scoped_lock lock(finished_pieces_mutex_);
+             written_blocks_.emplace_back(piece_index, offset);
+         }}
+    );
+}
+
+void PieceManager::verify_written_piece(uint32_t piece_index) {
+    auto& piece{*active_pieces_.find(piece_index)};
+    auto  hashed_size{
+        std::min<size_t>(piece.get_hashed_blocks_cnt() * BLOCK_SIZE, get_piece_size(piece_index))
     };
+    // Shared, so the handler of the job can be copied
+    auto context{std::make_shared<crypto::Sha1Context>(piece.take_hash_context())};
 
-    if (hash != ref_hash) {
-        // If hashes mismatch, mark piecd as incomplete
-        piece_completed_[piece_index] = false;
-        LOG_WARN("Piece {} hash mismatch. Discarding...", piece_index);
-    } else {
-        // If hashes match, write the piece to disk
-        auto piece_data_char_view{std::span<const char>(
-            reinterpret_cast<const char*>(piece_data.data()), piece_data.size()
-        )};
+    // The piece is read back on the disk thread, so the read is ordered after the writes of its
+    // blocks
+    submit_write(
+        {.offset      = static_cast<size_t>(piece_index) * piece_size_,
+         .on_complete = [this, piece_index, context, hashed_size](bool) {
+             if (!read_back_hash(piece_index, *context, hashed_size)) {
+                 pieces_hashing_.fetch_sub(1, std::memory_order_release);
+                 finish_piece(piece_index, PieceResult::HASH_MISMATCH);
+                 return;
+             }
+             // Same order as for the pieces hashed from memory, see hash_piece
+             pieces_hashing_.fetch_sub(1, std::memory_order_release);
+             pieces_left_.fetch_sub(1, std::memory_order_release);
+             finish_write(piece_index, true);
+         }}
+    );
+}
+
+bool PieceManager::read_back_hash(
+    uint32_t piece_index, crypto::Sha1Context& context, size_t hashed_size
+) {
+    auto piece_offset{static_cast<size_t>(piece_index) * piece_size_};
+    auto piece_size{get_piece_size(piece_index)};
+
+    if (read_back_buffer_.empty()) {
+        read_back_buffer_.resize(fs::READ_BACK_CHUNK_SIZE);
+    }
 
-        file_manager_->write(piece_data_char_view, piece_index * piece_size_);
-        piece_completed_[piece_index] = true;
-        if (pieces_left_.fetch_sub(1, std::memory_order_release) == 1) {
-            completion_flag_.test_and_set(std::memory_order_release);
+    bool read{true};
+    try {
+        for (auto pos{hashed_size}; pos < piece_size;) {
+            auto chunk{std::span<char>(read_back_buffer_)
+                           .first(std::min(read_back_buffer_.size(), piece_size - pos))};
+            file_manager_->read(chunk, piece_offset + pos);
+            context.update(std::span<const uint8_t>(
+                reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size()
+            ));
+            pos += chunk.size();
         }
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to read back piece {}: {}", piece_index, e.what());
+        read = false;
     }
-    // in either cases, remove the piece from the requested pieces
-    requested_pieces_.erase(piece_index);
+
+    // The piece is not read again, valid or not, so its pages make room for the next pieces
+    file_manager_->advise(piece_offset, piece_size, fs::AccessAdvice::DONT_NEED);
+
+    return read && context.finalize() == get_piece_hash(piece_index);
 }
 
-auto PieceManager::endgame_remaining_blocks(const std::vector<bool>& bitfield
+void PieceManager::reclaim_finished_pieces() {
+    flush_deferred_writes();
+
+    std::vector<std::pair<uint32_t, PieceResult>> finished_pieces;
+    std::vector<std::pair<uint32_t, uint32_t>>    written_blocks;
+    {
+        std::scoped_lock lock(finished_pieces_mutex_);
+        finished_pieces.swap(finished_pieces_);
+        written_blocks.swap(written_blocks_);
+    }
+
+    // A piece written through keeps its slot until it is verified, which waits for its last block
+    for (auto [piece_index, offset] : written_blocks) {
+        auto& piece{*active_pieces_.find(piece_index)};
+        piece.free_block_data(Piece::get_block_index(offset));
+        if (piece_pending_.test(piece_index) && piece.get_allocated_blocks_cnt() == 0) {
+            verify_written_piece(piece_index);
+        }
+    }
+
+    for (auto [piece_index, result] : finished_pieces) {
+        // The memory of the blocks goes back to the pool, including the reserve
+        active_pieces_.erase(piece_index);
+        if (reserve_piece_ == piece_index) {
+            reserve_piece_.reset();
+        }
+        piece_pending_.reset(piece_index);
+        --pending_pieces_cnt_;
+
+        switch (result) {
+            case PieceResult::WRITTEN:
+                piece_completed_.set(piece_index);
+                break;
+            case PieceResult::WRITE_FAILED:
+                // The data never reached the disk, so the piece has to be downloaded again
+                LOG_WARN("Piece {} could not be written. Downloading it again...", piece_index);
+                pieces_left_.fetch_add(1, std::memory_order_release);
+                break;
+            case PieceResult::HASH_MISMATCH:
+                LOG_WARN("Piece {} hash mismatch. Discarding...", piece_index);
+                break;
+        }
+    }
+}
+
+auto PieceManager::endgame_remaining_blocks(const Bitfield& bitfield
 ) const -> std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> {
     if (!endgame_) {
         return {};
@@ -106,86 +273,282 @@ auto PieceManager::endgame_remaining_blocks(const std::vector<bool>& bitfield
     return {
         endgame_requests_ |
         std::views::filter([&bitfield](const std::tuple<uint32_t, uint32_t, uint32_t>& block) {
-            return bitfield[std::get<0>(block)];
+            return bitfield.test(std::get<0>(block));
         }) |
         std::ranges::to<std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>>()
     };
 }
 
-auto PieceManager::request_next_block(const std::vector<bool>& bitfield
-) -> std::optional<std::tuple<uint32_t, uint32_t, uint32_t>> {
+size_t PieceManager::request_next_blocks(
+    const Bitfield&                                        bitfield,
+    size_t                                                 blocks_cnt,
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>& blocks,
+    RequestCursor&                                         cursor,
+    std::chrono::milliseconds                              request_timeout
+) {
+    if (blocks_cnt == 0) {
+        return 0;
+    }
+
     if (completed()) {
         LOG_DEBUG("No more blocks to download");
-        return std::nullopt;
+        return 0;
     }
 
-    if (!are_pieces_sorted_) {
-        std::ranges::sort(sorted_pieces_, [&](uint32_t a, uint32_t b) {
-            return piece_avail_[a] < piece_avail_[b];
-        });
-        are_pieces_sorted_ = true;
+    // Release the memory of the finished pieces before allocating new ones
+    reclaim_finished_pieces();
+    check_reserve_piece(get_current_tick());
+
+    // Back off while the disk writer cannot keep up with the blocks written through
+    if (!deferred_writes_.empty()) {
+        return 0;
     }
 
-    for (auto piece_idx : sorted_pieces_) {
-        // Skip completed pieces or pieces that the peer does not have
-        if (piece_completed_[piece_idx] || !bitfield[piece_idx]) {
-            continue;
+    // Skip the scan of the pieces if the peer has none of the pieces we still need
+    if (bitfield.count_and_not(piece_completed_) == 0) {
+        return 0;
+    }
+
+    auto pieces{piece_avail_.get_rarest_first()};
+    // The position is meaningless once the pieces have been reordered
+    if (cursor.order_version != piece_avail_.get_order_version() || cursor.pos >= pieces.size()) {
+        cursor.pos           = 0;
+        cursor.order_version = piece_avail_.get_order_version();
+    }
+
+    auto deadline_tick{get_deadline_tick(request_timeout)};
+
+    if (!cursor.peer_id.has_value()) {
+        cursor.peer_id = next_peer_id_++;
+    }
+    auto peer_id{*cursor.peer_id};
+    auto is_fast{is_fast_peer(cursor.download_rate)};
+    // Owner of the pieces the peer starts
+    auto owner{is_fast ? peer_id : SLOW_PEERS};
+
+    // Finish the pieces in progress before starting new ones, so fewer pieces are held in memory.
+    // Only the active pieces are gone over, still rarest first
+    active_candidates_.clear();
+    active_pieces_.for_each([&](uint32_t piece_idx, const Piece&) {
+        if (!piece_pending_.test(piece_idx) && bitfield.test(piece_idx)) {
+            active_candidates_.push_back(piece_idx);
         }
+    });
+    std::ranges::sort(active_candidates_, {}, [this](uint32_t piece_idx) {
+        return piece_avail_.get_rank(piece_idx);
+    });
 
-        if (!requested_pieces_.contains(piece_idx)) {
-            if (requested_pieces_.size() >= max_active_requests_) {
-                continue;
-            }
-            uint32_t cur_piece_size =
-                piece_idx == pieces_cnt_ - 1 ? 1 + (torrent_size_ - 1) % piece_size_ : piece_size_;
-            requested_pieces_.emplace(
-                piece_idx,
-                Piece(cur_piece_size, piece_data_alloc_, piece_util_alloc_, block_request_timeout_)
-            );
+    auto current_tick{get_current_tick()};
+    // Time without progress after which the piece of another owner is open to the peer
+    auto stall_ticks{deadline_tick - current_tick};
+
+    size_t requested{0};
+    for (auto piece_idx : active_candidates_) {
+        if (requested == blocks_cnt) {
+            break;
         }
+        auto* piece{active_pieces_.find(piece_idx)};
 
-        auto& piece = requested_pieces_.at(piece_idx);
+        auto& piece_owner{piece_owner_[piece_idx]};
+        // A peer that is no longer fast shares its pieces with the slow peers, and the owner of a
+        // piece that stalled gives it up
+        if ((piece_owner == peer_id && !is_fast) ||
+            (piece_owner != NO_OWNER && piece_owner != peer_id && piece_owner != owner &&
+             current_tick - piece_progress_tick_[piece_idx] >= stall_ticks)) {
+            piece_owner = NO_OWNER;
+        }
+        // A released piece is adopted by the next peer that starts its unrequested blocks
+        if (piece_owner == NO_OWNER && piece->get_unreq_blocks_cnt() > 0) {
+            piece_owner                     = owner;
+            piece_progress_tick_[piece_idx] = current_tick;
+        }
+        // A fast peer also takes the timed out blocks of the other pieces, so a slow peer cannot
+        // hold them back
+        if (piece_owner == NO_OWNER || piece_owner == peer_id || piece_owner == owner) {
+            requested += request_piece_blocks(
+                piece_idx, *piece, false, peer_id, deadline_tick, blocks_cnt - requested, blocks
+            );
+        } else if (is_fast) {
+            requested += request_piece_blocks(
+                piece_idx, *piece, true, peer_id, deadline_tick, blocks_cnt - requested, blocks
+            );
+        }
+    }
+    if (requested == blocks_cnt) {
+        return requested;
+    }
 
-        auto block_info = piece.request_next_block();
+    // New pieces are only started while the pool has blocks left besides the reserve
+    for (size_t scanned{0}; scanned < pieces.size() && !active_pieces_.full() &&
+                            block_data_alloc_.get_free_count() > reserve_blocks_cnt_;
+         ++scanned) {
+        auto pos{(cursor.pos + scanned) % pieces.size()};
+        auto piece_idx{pieces[pos]};
 
-        if (!block_info.has_value()) {
+        // Skip completed pieces, pieces in progress, or pieces that the peer does not have
+        if (piece_completed_.test(piece_idx) || active_pieces_.contains(piece_idx) ||
+            !bitfield.test(piece_idx)) {
             continue;
         }
 
+        auto& piece{active_pieces_.emplace(
+            piece_idx, get_piece_size(piece_idx), block_data_alloc_, piece_util_alloc_
+        )};
+        piece_owner_[piece_idx]         = owner;
+        piece_progress_tick_[piece_idx] = current_tick;
+
+        // Take as many blocks as possible from the piece, so it completes sooner
+        requested += request_piece_blocks(
+            piece_idx, piece, false, peer_id, deadline_tick, blocks_cnt - requested, blocks
+        );
+
+        if (requested == blocks_cnt) {
+            // The next batch starts from the pieces after this one
+            cursor.pos = pos + 1;
+            return requested;
+        }
+    }
+
+    check_endgame();
+
+    return requested;
+}
+
+size_t PieceManager::request_piece_blocks(
+    uint32_t                                               piece_index,
+    Piece&                                                 piece,
+    bool                                                   timed_out_only,
+    uint32_t                                               peer_id,
+    uint64_t                                               deadline_tick,
+    size_t                                                 blocks_cnt,
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>& blocks
+) {
+    size_t requested{0};
+    while (requested < blocks_cnt) {
+        auto block_info{
+            timed_out_only || !may_allocate_block(piece_index, piece)
+                ? piece.request_timed_out_block(deadline_tick)
+                : piece.request_next_block(deadline_tick)
+        };
+        if (!block_info.has_value()) {
+            break;
+        }
         auto [offset, block_size] = *block_info;
+        blocks.emplace_back(piece_index, offset, block_size);
+        request_timeouts_.schedule(
+            {.piece_index   = piece_index,
+             .block_index   = static_cast<uint16_t>(Piece::get_block_index(offset)),
+             .peer_id       = peer_id,
+             .deadline_tick = deadline_tick},
+            deadline_tick
+        );
+        ++requested;
+    }
+    return requested;
+}
 
-        return std::make_tuple(piece_idx, offset, block_size);
+bool PieceManager::may_allocate_block(uint32_t piece_index, const Piece& piece) {
+    if (block_data_alloc_.get_free_count() > reserve_blocks_cnt_) {
+        return true;
     }
+    // The reserve covers a whole piece, so the piece that takes it can complete whatever the
+    // other pieces hold
+    if (!reserve_piece_.has_value() && piece.get_unreq_blocks_cnt() > 0) {
+        reserve_piece_                    = piece_index;
+        piece_progress_tick_[piece_index] = get_current_tick();
+    }
+    return reserve_piece_ == piece_index;
+}
 
-    // If all the pieces have been requested, check if all blocks have been requested and enter
-    // endgame mode
-    if (!endgame_ && pieces_left_.load(std::memory_order_acquire) == requested_pieces_.size()) {
-        bool enter_endgame{true};
-        for (const auto& [piece_idx, piece] : requested_pieces_) {
-            if (piece.get_unreq_blocks_cnt() > 0) {
-                enter_endgame = false;
-                break;
-            }
-        }
-        endgame_ = enter_endgame;
-        if (endgame_) {
-            LOG_INFO("Entering endgame mode");
-            // fetch all the blocks that have not been received
-            for (auto& [piece_idx, piece] : requested_pieces_) {
-                std::ranges::copy(
-                    piece.get_remaining_blocks(
-                    ) | std::views::transform([piece_idx](uint16_t block_idx) {
-                        return std::make_tuple(
-                            piece_idx, Piece::get_block_offset(block_idx), Piece::get_block_size()
-                        );
-                    }),
-                    std::back_inserter(endgame_requests_)
-                );
-            }
+void PieceManager::check_reserve_piece(uint64_t current_tick) {
+    if (!reserve_piece_.has_value() || piece_pending_.test(*reserve_piece_)) {
+        return;
+    }
+
+    auto  piece_idx{*reserve_piece_};
+    auto& piece{*active_pieces_.find(piece_idx)};
+
+    if (piece_avail_.get_availability(piece_idx) == 0 &&
+        !piece.is_memory_in_use(piece_buffering_ == PieceBuffering::WRITE_THROUGH)) {
+        // The blocks left can never be received, so the blocks of the piece go back to the pool.
+        // The piece is started again once a peer that has it shows up
+        LOG_DEBUG("Dropping piece {}, which no peer has anymore", piece_idx);
+        active_pieces_.erase(piece_idx);
+        piece_owner_[piece_idx] = NO_OWNER;
+        reserve_piece_.reset();
+        return;
+    }
+
+    if (current_tick - piece_progress_tick_[piece_idx] >=
+        get_deadline_tick(request_timeout_) - current_tick) {
+        reserve_piece_.reset();
+    }
+}
+
+void PieceManager::release_pieces(const RequestCursor& cursor) {
+    if (!cursor.peer_id.has_value()) {
+        return;
+    }
+    active_pieces_.for_each([&](uint32_t piece_idx, const Piece&) {
+        if (piece_owner_[piece_idx] == *cursor.peer_id) {
+            piece_owner_[piece_idx] = NO_OWNER;
+        }
+    });
+}
+
+void PieceManager::tick(std::chrono::steady_clock::time_point now) {
+    // The deferred writes go on even if no block arrives
+    flush_deferred_writes();
+
+    auto now_tick{static_cast<uint64_t>((now - clock_start_) / tick_duration_)};
+    request_timeouts_.advance(now_tick, [this](const BlockTimeout& timeout) {
+        // The piece may have been completed, or dropped and downloaded again, since the request
+        auto* piece{active_pieces_.find(timeout.piece_index)};
+        if (piece == nullptr || piece_pending_.test(timeout.piece_index) ||
+            !piece->expire_block(timeout.block_index, timeout.deadline_tick)) {
+            return;
+        }
+        // A peer that lets its requests time out no longer holds the piece back
+        if (piece_owner_[timeout.piece_index] == timeout.peer_id) {
+            piece_owner_[timeout.piece_index] = NO_OWNER;
         }
+    });
+}
+
+void PieceManager::check_endgame() {
+    // If all the pieces have been requested, check if all blocks have been requested and enter
+    // endgame mode. The pieces left are loaded before the pieces being hashed, see hash_piece
+    auto pieces_left{pieces_left_.load(std::memory_order_acquire)};
+    auto pieces_hashing{pieces_hashing_.load(std::memory_order_acquire)};
+    if (endgame_ || pieces_left != active_pieces_.size() - pending_pieces_cnt_ + pieces_hashing) {
+        return;
     }
 
-    return std::nullopt;
+    bool enter_endgame{true};
+    active_pieces_.for_each([&](uint32_t piece_idx, const Piece& piece) {
+        enter_endgame = enter_endgame &&
+                        (piece_pending_.test(piece_idx) || piece.get_unreq_blocks_cnt() == 0);
+    });
+    if (!enter_endgame) {
+        return;
+    }
+
+    endgame_ = true;
+    LOG_INFO("Entering endgame mode");
+    // fetch all the blocks that have not been received
+    active_pieces_.for_each([&](uint32_t piece_idx, const Piece& piece) {
+        if (piece_pending_.test(piece_idx)) {
+            return;
+        }
+        std::ranges::copy(
+            piece.get_remaining_blocks() | std::views::transform([piece_idx](uint16_t block_idx) {
+                return std::make_tuple(
+                    piece_idx, Piece::get_block_offset(block_idx), Piece::get_block_size()
+                );
+            }),
+            std::back_inserter(endgame_requests_)
+        );
+    });
 }
 
 }  // namespace torrent
@@ -1,71 +1,154 @@
 #pragma once
 
+#include "ActivePieces.hpp"
+#include "Bitfield.hpp"
 #include "Constant.hpp"
+#include "DiskWriter.hpp"
 #include "Duration.hpp"
 #include "FileManager.hpp"
 #include "FixedSizeAllocator.hpp"
 #include "Piece.hpp"
+#include "PieceAvailability.hpp"
+#include "PieceHasher.hpp"
+#include "TimerWheel.hpp"
 #include "Utils.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
 #include <memory>
-#include <numeric>
+#include <mutex>
 #include <optional>
 #include <span>
 #include <tuple>
-#include <unordered_map>
 #include <vector>
 
 namespace torrent {
 
+// Where the blocks of a piece are kept until the piece is verified
+enum class PieceBuffering : uint8_t {
+    // The blocks stay in memory, and the piece is written once verified
+    MEMORY,
+    // Each block is written as soon as it is received, and the piece is read back to be verified,
+    // so almost no piece memory is held
+    WRITE_THROUGH
+};
+
 class PieceManager {
     public:
+        // State of the picker for a peer, kept between its batches of requests
+        struct RequestCursor {
+                // Position of the piece the previous batch stopped at, so the next batch resumes
+                // there in the rarest-first order
+                size_t pos{0};
+                // Version of the order the position refers to
+                uint64_t order_version{0};
+                // Download rate of the peer in bytes per second, which decides its speed class
+                double download_rate{0.0};
+                // Owner id of the peer, assigned on its first batch
+                std::optional<uint32_t> peer_id;
+        };
+
         PieceManager(
             uint32_t                         piece_size,
             size_t                           torrent_size,
             std::shared_ptr<fs::FileManager> file_manager,
             std::span<const uint8_t>         piece_hashes,
-            std::chrono::milliseconds        request_timeout = duration::REQUEST_TIMEOUT
+            std::chrono::milliseconds        request_timeout = duration::REQUEST_TIMEOUT,
+            PieceBuffering                   piece_buffering = PieceBuffering::MEMORY
         )
-            : max_active_requests_{utils::ceil_div(MAX_MEMPOOL_SIZE, piece_size)},
+            : max_active_pieces_{std::max<size_t>(
+                  utils::ceil_div(MAX_MEMPOOL_SIZE, piece_size), ACTIVE_PIECES_CAPACITY
+              )},
               piece_size_{piece_size},
               torrent_size_{torrent_size},
               pieces_cnt_{utils::ceil_div(torrent_size, piece_size)},
-              block_request_timeout_{request_timeout},
               pieces_left_{pieces_cnt_},
+              tick_duration_{std::clamp(
+                  request_timeout, std::chrono::milliseconds{1}, duration::REQUEST_INTERVAL
+              )},
+              request_timeout_{request_timeout},
+              piece_buffering_{piece_buffering},
               file_manager_{std::move(file_manager)},
-              piece_data_alloc_(piece_size, max_active_requests_),
+              piece_completed_(pieces_cnt_),
+              piece_avail_(pieces_cnt_),
+              active_pieces_(pieces_cnt_, std::min(max_active_pieces_, pieces_cnt_)),
+              piece_hashes_{piece_hashes},
+              piece_owner_(pieces_cnt_, NO_OWNER),
+              piece_progress_tick_(pieces_cnt_, 0),
+              reserve_blocks_cnt_{utils::ceil_div(piece_size, BLOCK_SIZE)},
+              block_data_alloc_(
+                  BLOCK_SIZE, std::max(MAX_MEMPOOL_SIZE / BLOCK_SIZE, 2 * reserve_blocks_cnt_)
+              ),
               piece_util_alloc_(
                   utils::ceil_div(piece_size, BLOCK_SIZE) * sizeof(uint16_t),
-                  2 * max_active_requests_
+                  2 * max_active_pieces_
               ),
-              piece_completed_(pieces_cnt_, false),
-              piece_avail_(pieces_cnt_),
-              piece_hashes_{piece_hashes},
-              sorted_pieces_(pieces_cnt_) {
-            // Fill the sorted_pieces vector with indices of pieces
-            std::iota(sorted_pieces_.begin(), sorted_pieces_.end(), 0);
+              piece_pending_(pieces_cnt_),
+              disk_writer_{std::make_unique<fs::DiskWriter>(
+                  file_manager_,
+                  piece_buffering == PieceBuffering::WRITE_THROUGH ? fs::MAX_QUEUED_BLOCK_WRITES
+                                                                   : fs::MAX_QUEUED_WRITES
+              )},
+              hasher_{std::make_unique<crypto::PieceHasher>()} {
+            // The verified pieces are written straight from the block pool. The blocks are not
+            // contiguous, so the io_uring storage issues a fixed write for each of them
+            file_manager_->register_buffer(block_data_alloc_.get_arena());
+        }
+
+        /**
+         * @brief Mark the pieces that are already on disk as completed, e.g. when resuming a
+         * download
+         *
+         * @param completed_pieces The pieces that are completed
+         * @note This function must be called before the download starts
+         */
+        void restore_completed_pieces(const std::vector<bool>& completed_pieces);
+
+        /**
+         * @brief Set the function called once a verified piece has been written to disk
+         *
+         * @param on_piece_written Function called with the index of the written piece
+         * @note The function is called on the disk thread
+         * @note This function must be called before the download starts
+         */
+        void set_on_piece_written(std::function<void(uint32_t)> on_piece_written) {
+            on_piece_written_ = std::move(on_piece_written);
         }
 
         /**
          * @brief Add a peer bitfield
+         * A full bitfield is only counted as a seed, without going over the pieces
          *
          * @param bitfield Bitfield of the peer
+         * @return True if the peer was counted as a seed
          */
-        void add_peer_bitfield(const std::vector<bool>& bitfield) {
-            update_pieces_availability(bitfield, +1);
+        bool add_peer_bitfield(const Bitfield& bitfield) {
+            if (bitfield.all()) {
+                piece_avail_.add_seed();
+                return true;
+            }
+            piece_avail_.add_bitfield(bitfield);
+            return false;
         }
 
         /**
          * @brief Remove a peer bitfield
          *
          * @param bitfield Bitfield of the peer
+         * @param is_seed Whether the peer was counted as a seed when its bitfield was added
          */
-        void remove_peer_bitfield(const std::vector<bool>& bitfield) {
-            update_pieces_availability(bitfield, -1);
+        void remove_peer_bitfield(const Bitfield& bitfield, bool is_seed) {
+            if (is_seed) {
+                piece_avail_.remove_seed();
+            } else {
+                piece_avail_.remove_bitfield(bitfield);
+            }
         }
 
         /**
@@ -73,7 +156,7 @@ class PieceManager {
          *
          * @param piece_index Index of the piece
          */
-        void add_available_piece(uint32_t piece_index);
+        void add_available_piece(uint32_t piece_index) { piece_avail_.increment(piece_index); }
 
         /**
          * @brief Receive a requested block
@@ -84,25 +167,159 @@ class PieceManager {
          */
         void receive_block(uint32_t piece_index, std::span<const std::byte> block, uint32_t offset);
 
+        /**
+         * @brief Hand back a block requested from a peer that will not send it, e.g. because the
+         * peer choked or disconnected, so other peers can request it right away
+         *
+         * @param piece_index Index of the piece
+         * @param offset Offset of the block in the piece
+         * @param deadline_tick Deadline of the request, so the block is only handed back if it was
+         * not requested again since, e.g. from another peer
+         */
+        void return_block(uint32_t piece_index, uint32_t offset, uint64_t deadline_tick) {
+            auto* piece{active_pieces_.find(piece_index)};
+            if (piece != nullptr && !piece_pending_.test(piece_index)) {
+                piece->expire_block(
+                    static_cast<uint16_t>(Piece::get_block_index(offset)), deadline_tick
+                );
+            }
+        }
+
+        /**
+         * @brief Reserve the memory of a block in its piece, to receive the block without copying
+         * it
+         *
+         * @param piece_index Index of the piece
+         * @param offset Offset of the block in the piece
+         * @param size Size of the block
+         * @return The memory to receive the block in, or nullopt if the block is not needed or is
+         * already being received
+         * @note The block must then be committed or released
+         */
+        auto reserve_block(uint32_t piece_index, uint32_t offset, uint32_t size)
+            -> std::optional<std::span<std::byte>>;
+
+        /**
+         * @brief Mark a reserved block as received once its memory is filled
+         *
+         * @param piece_index Index of the piece
+         * @param offset Offset of the block in the piece
+         */
+        void commit_block(uint32_t piece_index, uint32_t offset);
+
+        /**
+         * @brief Give up a reserved block that could not be received, so it is requested again
+         *
+         * @param piece_index Index of the piece
+         * @param offset Offset of the block in the piece
+         */
+        void release_block(uint32_t piece_index, uint32_t offset) {
+            active_pieces_.find(piece_index)->release_block(offset);
+        }
+
         /**
          * @brief Request the next block to download
          *
          * @param bitfield Bitfield of the peer
          * @return Index of the piece, offset of the block in the piece, size of the block
          */
-        auto request_next_block(const std::vector<bool>& bitfield
-        ) -> std::optional<std::tuple<uint32_t, uint32_t, uint32_t>>;
+        auto request_next_block(const Bitfield& bitfield
+        ) -> std::optional<std::tuple<uint32_t, uint32_t, uint32_t>> {
+            std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> blocks;
+            RequestCursor                                         cursor;
+            if (request_next_blocks(bitfield, 1, blocks, cursor, request_timeout_) == 0) {
+                return std::nullopt;
+            }
+            return blocks.front();
+        }
+
+        /**
+         * @brief Request the next blocks to download in a single scan of the pieces
+         * The pieces in progress are finished before new pieces are started. A fast peer, which
+         * downloads a piece within FAST_PEER_PIECE_TIME, gets the pieces it starts to itself and
+         * only helps with the blocks of the other pieces that timed out, while the slow peers
+         * share their pieces. A piece is given up by its owner once the owner is no longer fast,
+         * once one of its requests times out, or once the piece received no block for a timeout
+         * of the requesting peer
+         *
+         * @param bitfield Bitfield of the peer
+         * @param blocks_cnt Maximum number of blocks to request
+         * @param blocks Vector the blocks are appended to, in form of (piece index, block offset,
+         * block size)
+         * @param cursor Cursor of the peer. The scan of the new pieces starts from it and wraps
+         * around, unless the buckets of the pieces were rebuilt since the previous scan
+         * @param request_timeout Time after which the blocks are requested again from other peers,
+         * e.g. from the round-trip time of the peer
+         * @return Number of blocks appended
+         */
+        size_t request_next_blocks(
+            const Bitfield&                                        bitfield,
+            size_t                                                 blocks_cnt,
+            std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>& blocks,
+            RequestCursor&                                         cursor,
+            std::chrono::milliseconds                              request_timeout
+        );
+
+        /**
+         * @brief Give up the pieces a peer owns, e.g. because the peer choked or disconnected, so
+         * the other peers can finish them
+         *
+         * @param cursor Cursor of the peer
+         */
+        void release_pieces(const RequestCursor& cursor);
+
+        /**
+         * @brief Advance the coarse clock of the block requests, and queue the blocks whose
+         * request timed out to be requested again
+         *
+         * @param now The current time
+         * @note This function is meant to be called once per tick, e.g. every REQUEST_INTERVAL, so
+         * picking the blocks never checks for timeouts
+         */
+        void tick(std::chrono::steady_clock::time_point now);
+
+        /**
+         * @brief Get the tick the coarse clock was last advanced to
+         *
+         * @return The current tick
+         */
+        uint64_t get_current_tick() const { return request_timeouts_.get_current_tick(); }
+
+        /**
+         * @brief Get the deadline of the blocks requested before the next tick
+         * Each peer has its own timeout, rounded up to whole ticks
+         *
+         * @param request_timeout Time after which the blocks are requested again from other peers
+         * @return Tick at which the requests time out
+         */
+        uint64_t get_deadline_tick(std::chrono::milliseconds request_timeout) const {
+            auto timeout_ticks{utils::ceil_div(request_timeout.count(), tick_duration_.count())};
+            return get_current_tick() + std::max<uint64_t>(1, timeout_ticks);
+        }
+
+        /**
+         * @brief Check if a peer is fast enough to get pieces to itself
+         *
+         * @param download_rate Download rate of the peer in bytes per second
+         * @return True if the peer downloads a whole piece within FAST_PEER_PIECE_TIME
+         */
+        bool is_fast_peer(double download_rate) const {
+            return download_rate *
+                       std::chrono::duration<double>(duration::FAST_PEER_PIECE_TIME).count() >=
+                   piece_size_;
+        }
 
         /**
          * @brief Check if the all the pieces have been downloaded
          *
          * @return True if the torrent is completed
-         * @note This function is not thread-safe
+         * @note This function is thread-safe
+         * @note Some of the pieces might still be waiting to be written to disk
          */
-        bool completed() const { return pieces_left_ == 0; }
+        bool completed() const { return pieces_left_.load(std::memory_order_acquire) == 0; }
 
         /**
-         * @brief Check if the all the pieces have been downloaded
+         * @brief Check if the all the pieces have been downloaded and written to disk
          *
          * @return True if the torrent is completed
          * @note This function is thread-safe
@@ -128,6 +345,50 @@ class PieceManager {
             return (pieces_cnt_ - pieces_left_.load(std::memory_order_acquire)) * piece_size_;
         }
 
+        /**
+         * @brief Block until all the complete pieces have been verified and written to disk and
+         * release their memory
+         *
+         * @note This function is not thread-safe
+         */
+        void wait_pending_writes() {
+            do {
+                // The hasher hands the verified pieces over to the disk writer, so it goes idle
+                // first
+                hasher_->wait_idle();
+                disk_writer_->wait_idle();
+                reclaim_finished_pieces();
+                // The pieces written through are read back once their blocks are reclaimed, and
+                // the writes deferred by a full queue are submitted then
+            } while (disk_writer_->get_queue_depth() > 0 || !deferred_writes_.empty());
+        }
+
+        /**
+         * @brief Get the number of complete pieces waiting to be verified
+         *
+         * @return Number of queued pieces
+         * @note This function is thread-safe
+         */
+        size_t get_hash_queue_depth() const { return hasher_->get_queue_depth(); }
+
+        /**
+         * @brief Get the number of pieces waiting to be written to disk
+         *
+         * @return Number of queued pieces
+         * @note This function is thread-safe
+         */
+        size_t get_disk_queue_depth() const { return disk_writer_->get_queue_depth(); }
+
+        /**
+         * @brief Get the average time it takes a verified piece to reach the disk
+         *
+         * @return Average write latency
+         * @note This function is thread-safe
+         */
+        auto get_disk_write_latency() const -> std::chrono::microseconds {
+            return disk_writer_->get_write_latency();
+        }
+
         /**
          * @brief Check if a block has been received
          *
@@ -137,10 +398,12 @@ class PieceManager {
          */
         bool is_block_received(uint32_t piece_index, uint32_t block_offset) const {
             assert(piece_index < pieces_cnt_ && "Piece index out of bounds");
-            return piece_completed_[piece_index] ||
-                   (requested_pieces_.contains(piece_index) &&
-                    requested_pieces_.at(piece_index)
-                        .is_block_received(Piece::get_block_index(block_offset)));
+            if (piece_completed_.test(piece_index) || piece_pending_.test(piece_index)) {
+                return true;
+            }
+            const auto* piece{active_pieces_.find(piece_index)};
+            return piece != nullptr &&
+                   piece->is_block_received(Piece::get_block_index(block_offset));
         }
 
         /**
@@ -150,7 +413,7 @@ class PieceManager {
          * @param bitfield Bitfield of the peer
          * @return A vector containing tuples in the form (piece index, block offset, block size)
          */
-        auto endgame_remaining_blocks(const std::vector<bool>& bitfield
+        auto endgame_remaining_blocks(const Bitfield& bitfield
         ) const -> std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>;
 
         /**
@@ -161,42 +424,276 @@ class PieceManager {
         bool is_endgame() const { return endgame_; }
 
     private:
+        enum class PieceResult : uint8_t { WRITTEN, WRITE_FAILED, HASH_MISMATCH };
+
+        // Owner of the active pieces that any peer may adopt
+        static constexpr uint32_t NO_OWNER{std::numeric_limits<uint32_t>::max()};
+        // Owner of the active pieces shared by the slow peers
+        static constexpr uint32_t SLOW_PEERS{NO_OWNER - 1};
+
         /**
-         * @brief Update the availability of pieces
+         * @brief Request as many blocks as possible from a piece
          *
-         * @param bitfield Bitfield of the peer
-         * @param sign +1 to add, -1 to remove
+         * @param piece_index Index of the piece
+         * @param piece The piece
+         * @param timed_out_only Only request the blocks whose request timed out or was dropped
+         * @param peer_id Owner id of the peer the blocks are requested from
+         * @param deadline_tick Tick of the coarse clock at which the requests time out
+         * @param blocks_cnt Maximum number of blocks to request in the batch
+         * @param blocks Vector the blocks are appended to
+         * @return Number of blocks appended
+         */
+        size_t request_piece_blocks(
+            uint32_t                                               piece_index,
+            Piece&                                                 piece,
+            bool                                                   timed_out_only,
+            uint32_t                                               peer_id,
+            uint64_t                                               deadline_tick,
+            size_t                                                 blocks_cnt,
+            std::vector<std::tuple<uint32_t, uint32_t, uint32_t>>& blocks
+        );
+
+        /**
+         * @brief Get the size of a piece
+         *
+         * @param piece_index Index of the piece
+         * @return Size of the piece (only the last piece can be smaller than piece_size_)
          */
-        void update_pieces_availability(const std::vector<bool>& bitfield, int8_t sign);
+        uint32_t get_piece_size(uint32_t piece_index) const {
+            return piece_index == pieces_cnt_ - 1 ? 1 + (torrent_size_ - 1) % piece_size_
+                                                  : piece_size_;
+        }
+
+        /**
+         * @brief Get the expected hash of a piece
+         *
+         * @param piece_index Index of the piece
+         * @return SHA-1 hash of the piece
+         */
+        crypto::Sha1 get_piece_hash(uint32_t piece_index) const {
+            return crypto::Sha1::from_raw_data(
+                piece_hashes_.data() + static_cast<size_t>(piece_index) * crypto::SHA1_SIZE
+            );
+        }
 
-        size_t                           max_active_requests_;
+        /**
+         * @brief Write a received block, or hash its piece once complete
+         *
+         * @param piece_index Index of the piece
+         * @param piece The piece
+         * @param offset Offset of the block in the piece
+         */
+        void on_block_received(uint32_t piece_index, Piece& piece, uint32_t offset);
+
+        /**
+         * @brief Hand a complete piece over to the hasher, which finishes its incremental hash
+         * The piece is kept alive until its result is reclaimed, and is written to disk straight
+         * from the hasher thread if its hash matches. A piece written through is only verified
+         * once all its blocks are written
+         *
+         * @param piece_index Index of the piece
+         */
+        void hash_piece(uint32_t piece_index);
+
+        /**
+         * @brief Hand a write over to the disk writer without blocking the network thread
+         * The write waits behind the writes deferred before it if the queue is full
+         *
+         * @param job The write
+         */
+        void submit_write(fs::DiskWriter::WriteJob job) {
+            deferred_writes_.push_back(std::move(job));
+            flush_deferred_writes();
+        }
+
+        /**
+         * @brief Submit the deferred writes, in order, until the queue of the disk writer is full
+         */
+        void flush_deferred_writes() {
+            while (!deferred_writes_.empty() &&
+                   disk_writer_->try_submit(deferred_writes_.front())) {
+                deferred_writes_.pop_front();
+            }
+        }
+
+        /**
+         * @brief Hand a received block over to the disk writer, its memory being freed once it
+         * is written
+         *
+         * @param piece_index Index of the piece
+         * @param piece The piece
+         * @param offset Offset of the block in the piece
+         */
+        void write_block(uint32_t piece_index, const Piece& piece, uint32_t offset);
+
+        /**
+         * @brief Read back a piece whose blocks were all written, on the disk thread, and finish
+         * its incremental hash
+         *
+         * @param piece_index Index of the piece
+         */
+        void verify_written_piece(uint32_t piece_index);
+
+        /**
+         * @brief Hash the part of a written piece that was not hashed when its blocks arrived, by
+         * reading it back from the disk, where it is usually still in the page cache
+         *
+         * @param piece_index Index of the piece
+         * @param context Hash context of the blocks hashed when they arrived
+         * @param hashed_size Size of the start of the piece hashed when its blocks arrived
+         * @return True if the hash of the piece matches
+         * @note This function is called on the disk thread
+         */
+        bool read_back_hash(
+            uint32_t piece_index, crypto::Sha1Context& context, size_t hashed_size
+        );
+
+        /**
+         * @brief Hand a verified piece over to the disk writer
+         *
+         * @param piece_index Index of the piece
+         * @param piece_blocks Blocks of the piece, written with a single vectored write
+         * @note This function is called on a hasher thread
+         */
+        void write_piece(uint32_t piece_index, std::vector<std::span<const char>> piece_blocks);
+
+        /**
+         * @brief Record the result of the write of a verified piece
+         *
+         * @param piece_index Index of the piece
+         * @param written True if the piece reached the disk
+         * @note This function is called on the disk thread
+         */
+        void finish_write(uint32_t piece_index, bool written);
+
+        /**
+         * @brief Check if a piece may take the memory of a new block from the pool
+         * The last blocks of the pool are kept for a single piece, so at least one piece can
+         * complete and free its memory when the other pieces took the rest of the pool, as long
+         * as some peer sends its blocks (see check_reserve_piece)
+         *
+         * @param piece_index Index of the piece
+         * @param piece The piece
+         * @return True if a new block of the piece may be requested
+         */
+        bool may_allocate_block(uint32_t piece_index, const Piece& piece);
+
+        /**
+         * @brief Give up the reserve piece if it cannot complete, so the reserve is not held
+         * forever
+         * A piece that no connected peer has is dropped with its memory, and a piece that made no
+         * progress for a request timeout lets the next piece that needs the reserve take it
+         *
+         * @param current_tick The current tick of the coarse clock
+         */
+        void check_reserve_piece(uint64_t current_tick);
+
+        /**
+         * @brief Store the final result of a pending piece, so it is reclaimed by the network
+         * thread
+         *
+         * @param piece_index Index of the piece
+         * @param result Result of the piece
+         * @note This function is thread-safe
+         */
+        void finish_piece(uint32_t piece_index, PieceResult result) {
+            std::scoped_lock lock(finished_pieces_mutex_);
+            finished_pieces_.emplace_back(piece_index, result);
+        }
+
+        /**
+         * @brief Enter the endgame mode if every block of the pieces left has been requested
+         */
+        void check_endgame();
+
+        /**
+         * @brief Release the pieces that the hasher and the disk writer are done with
+         * Pieces that failed their hash check or failed to be written are marked as incomplete, so
+         * they are downloaded again
+         */
+        void reclaim_finished_pieces();
+
+        size_t                           max_active_pieces_;
         uint32_t                         piece_size_;
         size_t                           torrent_size_;
         const size_t                     pieces_cnt_;
         std::atomic<size_t>              pieces_left_;
-        std::chrono::milliseconds        block_request_timeout_;
+        // Duration of a tick of the coarse clock of the block requests
+        std::chrono::milliseconds        tick_duration_;
+        // Timeout of the requests made without a timeout of their own
+        std::chrono::milliseconds        request_timeout_;
+        PieceBuffering                   piece_buffering_;
         std::shared_ptr<fs::FileManager> file_manager_;
-        std::vector<bool>                piece_completed_;
-        // Number of peers that have the ith piece
-        std::vector<uint16_t>               piece_avail_;
-        std::unordered_map<uint32_t, Piece> requested_pieces_;
-        std::span<const uint8_t>            piece_hashes_;
-
-        // Allocator used for the piece data
-        utils::FixedSizeAllocator<std::byte> piece_data_alloc_;
+        Bitfield                         piece_completed_;
+        // Pieces ordered by the number of peers that have them
+        PieceAvailability piece_avail_;
+        // Pieces being downloaded, and complete pieces owned by the hasher and then the disk
+        // writer until they are done with their data
+        ActivePieces             active_pieces_;
+        std::span<const uint8_t> piece_hashes_;
+        // Peer or speed class each active piece is requested from
+        std::vector<uint32_t> piece_owner_;
+        // Tick at which each active piece last received a block, changed owner or took the
+        // reserve, so a piece that stalled is opened to the other peers or gives the reserve up
+        std::vector<uint64_t> piece_progress_tick_;
+        uint32_t              next_peer_id_{0};
+        // Active pieces a peer may request blocks of, kept to reuse its memory between batches
+        std::vector<uint32_t> active_candidates_;
+
+        // Number of blocks of the pool kept for the reserve piece, enough for a whole piece
+        size_t reserve_blocks_cnt_;
+        // Piece allowed to take the blocks kept in reserve, until it is reclaimed
+        std::optional<uint32_t> reserve_piece_;
+        // Allocator used for the blocks of the pieces
+        utils::FixedSizeAllocator<std::byte> block_data_alloc_;
         // Allocator used for the vectors that manage remaining blocks
         utils::FixedSizeAllocator<uint16_t> piece_util_alloc_;
 
-        // Vector of indices of pieces sorted by availability
-        std::vector<uint32_t> sorted_pieces_;
-        bool                  are_pieces_sorted_{false};
-
         // Atomic flag that indicates completion of the download
         std::atomic_flag completion_flag_{ATOMIC_FLAG_INIT};
 
+        // Outstanding block request, which times out unless the block was received or requested
+        // again since
+        struct BlockTimeout {
+                uint32_t piece_index;
+                uint16_t block_index;
+                // Owner id of the peer the block was requested from
+                uint32_t peer_id;
+                uint64_t deadline_tick;
+        };
+
+        // Start of the coarse clock
+        std::chrono::steady_clock::time_point clock_start_{std::chrono::steady_clock::now()};
+        // Timeouts of the block requests, in ticks of the coarse clock
+        utils::TimerWheel<BlockTimeout> request_timeouts_;
+
         // Flag that indicates if we entered the endgame mode
         bool                                                  endgame_{false};
         std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> endgame_requests_;
+
+        // Active pieces that are complete and wait for the hasher or the disk writer
+        Bitfield piece_pending_;
+        size_t   pending_pieces_cnt_{0};
+        // Number of pending pieces that have not been verified yet
+        std::atomic<size_t> pieces_hashing_{0};
+        // Pieces the hasher or the disk writer are done with, in form of (piece_index, result)
+        std::mutex                                    finished_pieces_mutex_;
+        std::vector<std::pair<uint32_t, PieceResult>> finished_pieces_;
+        std::atomic<size_t>                           pieces_written_{0};
+        std::function<void(uint32_t)>                 on_piece_written_;
+        // Blocks written through to disk, in form of (piece_index, offset), whose memory is freed
+        // by the network thread. Guarded by finished_pieces_mutex_
+        std::vector<std::pair<uint32_t, uint32_t>> written_blocks_;
+        // Buffer the written pieces are read back in, only used by the disk thread
+        std::vector<char> read_back_buffer_;
+        // Writes of the network thread that did not fit in the queue of the disk writer, in
+        // submission order
+        std::deque<fs::DiskWriter::WriteJob> deferred_writes_;
+
+        // Must be the last members, so the hasher threads, which submit writes, and then the disk
+        // thread are stopped before the pieces are destroyed
+        std::unique_ptr<fs::DiskWriter>      disk_writer_;
+        std::unique_ptr<crypto::PieceHasher> hasher_;
 };
 
 }  // namespace torrent
@@ -0,0 +1,130 @@
+#include "PieceVerifier.hpp"
+
+#include "Constant.hpp"
+#include "Crypto.hpp"
+#include "Logger.hpp"
+#include "Utils.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <numeric>
+#include <thread>
+#include <utility>
+
+namespace torrent {
+
+PieceVerifier::PieceVerifier(
+    std::shared_ptr<fs::FileManager> file_manager,
+    std::span<const uint8_t>         piece_hashes,
+    uint32_t                         piece_size,
+    size_t                           torrent_size,
+    size_t                           thread_count
+)
+    : file_manager_{std::move(file_manager)},
+      piece_hashes_{piece_hashes},
+      piece_size_{piece_size},
+      torrent_size_{torrent_size},
+      pieces_cnt_{utils::ceil_div(torrent_size, piece_size)},
+      thread_count_{
+          thread_count != 0 ? thread_count : std::max(1U, std::thread::hardware_concurrency())
+      } {}
+
+std::vector<bool> PieceVerifier::verify(std::span<const uint32_t> pieces) {
+    // Each thread writes the results of its own pieces, which a vector<bool> does not allow
+    std::vector<uint8_t> piece_results(pieces.size(), 0);
+    std::atomic<size_t>  next_piece{0};
+
+    checked_cnt_.store(0, std::memory_order_relaxed);
+
+    // Number of pieces whose data is requested before it is needed
+    size_t read_ahead{std::max<size_t>(1, fs::VERIFY_READ_AHEAD / piece_size_)};
+
+    for (size_t i{0}; i < std::min(read_ahead, pieces.size()); ++i) {
+        advise_piece(pieces[i], fs::AccessAdvice::WILL_NEED);
+    }
+
+    // Number of pieces read before being hashed together, small enough to keep every thread busy
+    size_t batch_size{std::max<size_t>(
+        1,
+        std::min(fs::VERIFY_BATCH_SIZE / piece_size_, utils::ceil_div(pieces.size(), thread_count_))
+    )};
+
+    auto worker = [&] {
+        std::vector<char>                     batch_buffer(batch_size * piece_size_);
+        std::vector<std::span<const uint8_t>> batch_data;
+        // Positions in pieces of the pieces of the batch that were read
+        std::vector<size_t> batch_pieces;
+
+        // The batches are handed out in order, so the files are read mostly sequentially
+        for (size_t first{next_piece.fetch_add(batch_size)}; first < pieces.size();
+             first = next_piece.fetch_add(batch_size)) {
+            auto last{std::min(first + batch_size, pieces.size())};
+
+            batch_data.clear();
+            batch_pieces.clear();
+
+            for (size_t i{first}; i < last; ++i) {
+                // Keep the read-ahead window ahead of the pieces being checked
+                if (i + read_ahead < pieces.size()) {
+                    advise_piece(pieces[i + read_ahead], fs::AccessAdvice::WILL_NEED);
+                }
+
+                uint32_t piece_index{pieces[i]};
+                auto     piece_data{std::span<char>(batch_buffer)
+                                        .subspan((i - first) * piece_size_)
+                                        .first(get_piece_size(piece_index))};
+
+                try {
+                    file_manager_->read(piece_data, static_cast<size_t>(piece_index) * piece_size_);
+                    batch_data.emplace_back(
+                        reinterpret_cast<const uint8_t*>(piece_data.data()), piece_data.size()
+                    );
+                    batch_pieces.push_back(i);
+                } catch (const std::exception& e) {
+                    LOG_WARN("Failed to read piece {}: {}", piece_index, e.what());
+                }
+            }
+
+            // Hash the pieces of the batch together, so they fill the lanes of the SIMD hashers
+            auto hashes{crypto::Sha1::digest_many(batch_data)};
+
+            for (size_t j{0}; j < batch_pieces.size(); ++j) {
+                auto ref_hash{crypto::Sha1::from_raw_data(
+                    piece_hashes_.data() + pieces[batch_pieces[j]] * crypto::SHA1_SIZE
+                )};
+                piece_results[batch_pieces[j]] = static_cast<uint8_t>(hashes[j] == ref_hash);
+            }
+
+            // The pieces are not going to be read again, so they should not push other data out
+            // of the page cache
+            for (size_t i{first}; i < last; ++i) {
+                advise_piece(pieces[i], fs::AccessAdvice::DONT_NEED);
+            }
+
+            checked_cnt_.fetch_add(last - first, std::memory_order_relaxed);
+        }
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (size_t i{1}; i < std::min(thread_count_, pieces.size()); ++i) {
+            workers.emplace_back(worker);
+        }
+        worker();
+    }
+
+    std::vector<bool> valid_pieces(pieces_cnt_, false);
+    for (size_t i{0}; i < pieces.size(); ++i) {
+        valid_pieces[pieces[i]] = piece_results[i] != 0;
+    }
+
+    return valid_pieces;
+}
+
+std::vector<bool> PieceVerifier::verify_all() {
+    std::vector<uint32_t> pieces(pieces_cnt_);
+    std::iota(pieces.begin(), pieces.end(), 0);
+    return verify(pieces);
+}
+
+}  // namespace torrent
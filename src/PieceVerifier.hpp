@@ -0,0 +1,96 @@
+#pragma once
+
+#include "FileManager.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace torrent {
+
+class PieceVerifier {
+    public:
+        /**
+         * @brief Create a verifier for the pieces stored by a file manager
+         *
+         * @param file_manager the file manager used to read the pieces
+         * @param piece_hashes the concatenated SHA-1 hashes of the pieces
+         * @param piece_size   the size of a piece
+         * @param torrent_size the total size of the torrent
+         * @param thread_count the number of threads that read and hash the pieces, or 0 to use
+         * one thread per hardware thread
+         */
+        PieceVerifier(
+            std::shared_ptr<fs::FileManager> file_manager,
+            std::span<const uint8_t>         piece_hashes,
+            uint32_t                         piece_size,
+            size_t                           torrent_size,
+            size_t                           thread_count = 0
+        );
+
+        /**
+         * @brief Check pieces stored on disk against their hashes
+         * The pieces are read in order by a pool of threads, with the next pieces being read
+         * ahead, and the pages of the checked pieces being dropped from the page cache
+         *
+         * @param pieces the indices of the pieces to check, in ascending order
+         * @return a bitfield with the pieces that matched their hash (the pieces that were not
+         * checked are not set)
+         * @note No write must be issued to the file manager while the pieces are checked
+         */
+        [[nodiscard]] std::vector<bool> verify(std::span<const uint32_t> pieces);
+
+        /**
+         * @brief Check all the pieces of the torrent against their hashes
+         *
+         * @return a bitfield with the pieces that matched their hash
+         */
+        [[nodiscard]] std::vector<bool> verify_all();
+
+        /**
+         * @brief Get the number of pieces checked so far by the current verification
+         *
+         * @return the number of checked pieces
+         * @note This function is thread-safe
+         */
+        [[nodiscard]] size_t get_checked_count() const {
+            return checked_cnt_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        /**
+         * @brief Get the size of a piece
+         *
+         * @param piece_index the index of the piece
+         * @return the size of the piece (only the last piece can be smaller than piece_size_)
+         */
+        [[nodiscard]] uint32_t get_piece_size(uint32_t piece_index) const {
+            return piece_index == pieces_cnt_ - 1 ? 1 + (torrent_size_ - 1) % piece_size_
+                                                  : piece_size_;
+        }
+
+        /**
+         * @brief Tell the storage how the data of a piece is going to be accessed
+         *
+         * @param piece_index the index of the piece
+         * @param advice      the expected access
+         */
+        void advise_piece(uint32_t piece_index, fs::AccessAdvice advice) {
+            file_manager_->advise(
+                static_cast<size_t>(piece_index) * piece_size_, get_piece_size(piece_index), advice
+            );
+        }
+
+        std::shared_ptr<fs::FileManager> file_manager_;
+        std::span<const uint8_t>         piece_hashes_;
+        uint32_t                         piece_size_;
+        size_t                           torrent_size_;
+        size_t                           pieces_cnt_;
+        size_t                           thread_count_;
+        std::atomic<size_t>              checked_cnt_{0};
+};
+
+}  // namespace torrent
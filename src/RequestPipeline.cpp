@@ -0,0 +1,117 @@
+#include "RequestPipeline.hpp"
+
+#include "Duration.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace torrent::peer {
+
+RequestPipeline::RequestPipeline(uint32_t max_depth)
+    : max_depth_{max_depth}, depth_{std::min(INITIAL_BLOCKS_IN_FLIGHT, max_depth)} {
+    requests_.reserve(max_depth_);
+    request_pos_.reserve(max_depth_);
+}
+
+bool RequestPipeline::add(
+    const BlockInfo& block_info, Clock::time_point request_time, uint64_t deadline_tick
+) {
+    auto pos{static_cast<uint32_t>(requests_.size())};
+    if (!request_pos_.try_emplace(key(block_info), pos).second) {
+        return false;
+    }
+    requests_.push_back(
+        {.block_info = block_info, .request_time = request_time, .deadline_tick = deadline_tick}
+    );
+    return true;
+}
+
+bool RequestPipeline::receive(const BlockInfo& block_info, Clock::time_point now) {
+    window_bytes_ += std::get<2>(block_info);
+
+    auto it{request_pos_.find(key(block_info))};
+    if (it == request_pos_.end()) {
+        return false;
+    }
+
+    auto rtt{now - requests_[it->second].request_time};
+    min_rtt_ = min_rtt_.has_value() ? std::min(*min_rtt_, rtt) : rtt;
+    // Same smoothing as the TCP round-trip time estimator, the variation being updated first
+    if (srtt_.has_value()) {
+        auto deviation{*srtt_ > rtt ? *srtt_ - rtt : rtt - *srtt_};
+        rttvar_ = (rttvar_ * 3 + deviation) / 4;
+        srtt_   = (*srtt_ * 7 + rtt) / 8;
+    } else {
+        rttvar_ = rtt / 2;
+        srtt_   = rtt;
+    }
+
+    erase_at(it->second);
+    return true;
+}
+
+void RequestPipeline::update(Clock::time_point now) {
+    if (!window_start_.has_value()) {
+        window_start_ = now;
+        return;
+    }
+    auto elapsed{now - *window_start_};
+    if (elapsed < duration::RATE_WINDOW) {
+        return;
+    }
+
+    auto seconds{std::chrono::duration<double>(elapsed).count()};
+    auto sample{static_cast<double>(window_bytes_) / seconds};
+    rate_         = rate_ == 0.0 ? sample : (rate_ + sample) / 2;
+    window_bytes_ = 0;
+    window_start_ = now;
+
+    // Without a round-trip time, the initial depth is kept
+    if (!min_rtt_.has_value()) {
+        return;
+    }
+    // The rate is capped by the depth while the pipeline is too shallow, and the blocks are only
+    // received a queue time later, so the depth grows by (1 + queue_time / rtt) per window until
+    // the bandwidth of the peer is reached
+    auto cover{std::chrono::duration<double>(*min_rtt_ + duration::REQUEST_QUEUE_TIME).count()};
+    auto blocks{std::ceil(rate_ * cover / BLOCK_SIZE)};
+    depth_ = static_cast<uint32_t>(std::clamp(
+        blocks, static_cast<double>(MIN_BLOCKS_IN_FLIGHT), static_cast<double>(max_depth_)
+    ));
+}
+
+std::chrono::milliseconds RequestPipeline::get_request_timeout() const {
+    if (!srtt_.has_value()) {
+        return duration::REQUEST_TIMEOUT;
+    }
+    // The timeouts are checked once per request interval, so a smaller variation is meaningless
+    auto timeout{*srtt_ + std::max<Clock::duration>(4 * rttvar_, duration::REQUEST_INTERVAL)};
+    return std::clamp(
+        std::chrono::ceil<std::chrono::milliseconds>(timeout),
+        duration::MIN_REQUEST_TIMEOUT,
+        std::chrono::milliseconds{duration::MAX_REQUEST_TIMEOUT}
+    );
+}
+
+void RequestPipeline::clear() {
+    depth_ = std::min(INITIAL_BLOCKS_IN_FLIGHT, max_depth_);
+    requests_.clear();
+    request_pos_.clear();
+    window_bytes_ = 0;
+    rate_         = 0.0;
+    window_start_.reset();
+    min_rtt_.reset();
+    srtt_.reset();
+    rttvar_ = {};
+}
+
+void RequestPipeline::erase_at(size_t pos) {
+    request_pos_.erase(key(requests_[pos].block_info));
+    if (pos + 1 != requests_.size()) {
+        requests_[pos]                               = std::move(requests_.back());
+        request_pos_[key(requests_[pos].block_info)] = static_cast<uint32_t>(pos);
+    }
+    requests_.pop_back();
+}
+
+}  // namespace torrent::peer
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "Constant.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace torrent::peer {
+
+/**
+ * @brief Blocks requested from a peer and not received yet, with the depth of the pipeline
+ *
+ * The pipeline measures the download rate and the round-trip time of the blocks of the peer, and
+ * keeps enough blocks in flight to cover the bandwidth-delay product plus a target queue time
+ */
+class RequestPipeline {
+    public:
+        using Clock = std::chrono::steady_clock;
+        // A block in form of (piece_index, block_offset, block_size)
+        using BlockInfo = std::tuple<uint32_t, uint32_t, uint32_t>;
+
+        // A block in flight
+        struct Request {
+                BlockInfo         block_info;
+                // Time the request was sent, which the round-trip time is measured from
+                Clock::time_point request_time;
+                // Tick of the coarse clock of the piece manager at which the request times out
+                uint64_t deadline_tick;
+        };
+
+        /**
+         * @brief Create an empty pipeline
+         *
+         * @param max_depth Maximum number of blocks in flight, e.g. the request queue of the peer
+         */
+        explicit RequestPipeline(uint32_t max_depth = MAX_BLOCKS_IN_FLIGHT);
+
+        /**
+         * @brief Record a block request
+         *
+         * @param block_info The block
+         * @param request_time Time the request was sent
+         * @param deadline_tick Tick at which the request times out, which identifies the request
+         * in the piece manager
+         * @return False if the block was already in flight
+         */
+        bool add(
+            const BlockInfo& block_info, Clock::time_point request_time, uint64_t deadline_tick = 0
+        );
+
+        /**
+         * @brief Record a received block and take it out of the pipeline
+         * The block counts toward the download rate, and samples the round-trip time if it was
+         * in flight
+         *
+         * @param block_info The block
+         * @param now Time the block was received
+         * @return True if the block was in flight
+         */
+        bool receive(const BlockInfo& block_info, Clock::time_point now);
+
+        /**
+         * @brief Check if a block is in flight
+         *
+         * @param block_info The block
+         * @return True if the block was requested and not received yet
+         */
+        [[nodiscard]] bool contains(const BlockInfo& block_info) const {
+            return request_pos_.contains(key(block_info));
+        }
+
+        /**
+         * @brief Take the blocks matching a predicate out of the pipeline
+         *
+         * @param pred Predicate called with the request of each block
+         * @return Number of blocks removed
+         */
+        template <typename Pred>
+        uint32_t remove_if(Pred&& pred) {
+            uint32_t removed{0};
+            for (size_t i{0}; i < requests_.size();) {
+                if (pred(std::as_const(requests_[i]))) {
+                    erase_at(i);
+                    ++removed;
+                } else {
+                    ++i;
+                }
+            }
+            return removed;
+        }
+
+        /**
+         * @brief Update the download rate and the depth once a rate window has elapsed
+         *
+         * @param now The current time
+         */
+        void update(Clock::time_point now);
+
+        /**
+         * @brief Forget every block in flight and every measurement, e.g. on reconnection
+         */
+        void clear();
+
+        /**
+         * @brief Get the number of blocks in flight
+         *
+         * @return Number of blocks
+         */
+        [[nodiscard]] uint32_t size() const { return static_cast<uint32_t>(requests_.size()); }
+
+        /**
+         * @brief Get the number of blocks to keep in flight
+         *
+         * @return Depth of the pipeline
+         */
+        [[nodiscard]] uint32_t get_depth() const { return depth_; }
+
+        /**
+         * @brief Get the number of blocks that can be requested without exceeding the depth
+         *
+         * @return Number of blocks
+         */
+        [[nodiscard]] uint32_t get_free_slots() const {
+            return depth_ > size() ? depth_ - size() : 0;
+        }
+
+        /**
+         * @brief Get the measured download rate
+         *
+         * @return Rate in bytes per second
+         */
+        [[nodiscard]] double get_rate() const { return rate_; }
+
+        /**
+         * @brief Get the lowest round-trip time of a block, i.e. without queueing at the peer
+         *
+         * @return The round-trip time if a block was received
+         */
+        [[nodiscard]] std::optional<Clock::duration> get_min_rtt() const { return min_rtt_; }
+
+        /**
+         * @brief Get the smoothed round-trip time of the blocks
+         *
+         * @return The round-trip time if a block was received
+         */
+        [[nodiscard]] std::optional<Clock::duration> get_srtt() const { return srtt_; }
+
+        /**
+         * @brief Get the time after which a block of the peer is considered lost
+         * The timeout is computed like the retransmission timeout of TCP, from the smoothed
+         * round-trip time and its variation
+         *
+         * @return The timeout, REQUEST_TIMEOUT until a block was received
+         */
+        [[nodiscard]] std::chrono::milliseconds get_request_timeout() const;
+
+    private:
+        /**
+         * @brief Get the key of a block in the index
+         *
+         * @param block_info The block
+         * @return The key
+         */
+        static uint64_t key(const BlockInfo& block_info) {
+            return (static_cast<uint64_t>(std::get<0>(block_info)) << 32U) |
+                   std::get<1>(block_info);
+        }
+
+        /**
+         * @brief Remove a block by swapping it with the last one
+         *
+         * @param pos Position of the block in requests_
+         */
+        void erase_at(size_t pos);
+
+        uint32_t max_depth_;
+        uint32_t depth_{INITIAL_BLOCKS_IN_FLIGHT};
+
+        // The blocks in flight
+        std::vector<Request> requests_;
+        // Position of each block in flight in requests_
+        std::unordered_map<uint64_t, uint32_t> request_pos_;
+
+        // Bytes received since the start of the rate window
+        size_t                           window_bytes_{0};
+        std::optional<Clock::time_point> window_start_;
+        double                           rate_{0.0};
+        std::optional<Clock::duration>   min_rtt_;
+        std::optional<Clock::duration>   srtt_;
+        Clock::duration                  rttvar_{};
+};
+
+}  // namespace torrent::peer
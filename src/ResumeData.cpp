@@ -0,0 +1,225 @@
+#include "ResumeData.hpp"
+
+#include "Bencode.hpp"
+#include "Logger.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <sys/stat.h>
+#include <system_error>
+#include <utility>
+
+namespace torrent::fs {
+
+ResumeData::ResumeData(
+    std::filesystem::path         resume_file,
+    std::span<const md::FileInfo> files_info,
+    const std::filesystem::path&  dest_dir,
+    const crypto::Sha1&           info_hash,
+    size_t                        piece_length,
+    size_t                        pieces_cnt
+)
+    : resume_file_{std::move(resume_file)},
+      info_hash_{info_hash},
+      piece_length_{piece_length},
+      changed_files_(files_info.size(), false),
+      completed_pieces_(pieces_cnt, false) {
+    files_.reserve(files_info.size());
+    for (const auto& file_info : files_info) {
+        files_.push_back({dest_dir / file_info.path, file_info.start_off, file_info.length});
+    }
+}
+
+bool ResumeData::load() {
+    if (!std::filesystem::exists(resume_file_)) {
+        return false;
+    }
+
+    std::ifstream resume_istream(resume_file_, std::ios::binary | std::ios::in);
+
+    try {
+        using namespace Bencode;
+
+        const auto resume_dict{std::get<BencodeDict>(BDecode(resume_istream))};
+
+        const auto& info_hash{std::get<BencodeString>(resume_dict.at("info-hash"))};
+        if (!std::ranges::equal(info_hash, info_hash_.get(), [](char a, uint8_t b) {
+                return static_cast<uint8_t>(a) == b;
+            })) {
+            LOG_WARN("Resume file {} belongs to another torrent", resume_file_.string());
+            return false;
+        }
+
+        const auto& pieces{std::get<BencodeString>(resume_dict.at("pieces"))};
+        const auto& files{std::get<BencodeList>(resume_dict.at("files"))};
+
+        if (pieces.size() != (completed_pieces_.size() + 7) / 8 || files.size() != files_.size()) {
+            LOG_WARN("Resume file {} does not match the torrent", resume_file_.string());
+            return false;
+        }
+
+        // The pieces are stored as a bitfield, with the first piece in the highest bit
+        for (size_t i{0}; i < completed_pieces_.size(); ++i) {
+            completed_pieces_[i] = (static_cast<uint8_t>(pieces[i / 8]) >> (7 - i % 8) & 1U) != 0;
+        }
+
+        for (size_t i{0}; i < files_.size(); ++i) {
+            const auto& file_dict{std::get<BencodeDict>(files[i])};
+
+            FileState recorded_state{
+                .size     = std::get<BencodeInt>(file_dict.at("size")),
+                .mtime_ns = std::get<BencodeInt>(file_dict.at("mtime")),
+            };
+
+            changed_files_[i] = recorded_state != get_file_state(files_[i].path);
+        }
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to load resume file {}: {}", resume_file_.string(), e.what());
+        completed_pieces_.assign(completed_pieces_.size(), false);
+        return false;
+    }
+
+    LOG_INFO(
+        "Loaded resume file {}: {} pieces completed, {} files changed",
+        resume_file_.string(),
+        std::ranges::count(completed_pieces_, true),
+        std::ranges::count(changed_files_, true)
+    );
+
+    return true;
+}
+
+std::vector<bool> ResumeData::get_completed_pieces() const {
+    std::scoped_lock lock(completed_pieces_mutex_);
+    return completed_pieces_;
+}
+
+std::vector<uint32_t> ResumeData::get_pieces_to_verify() const {
+    std::vector<bool> to_verify(completed_pieces_.size(), false);
+
+    for (size_t i{0}; i < files_.size(); ++i) {
+        if (!changed_files_[i] || files_[i].length == 0) {
+            continue;
+        }
+
+        // Every piece that overlaps the file might have been affected by the change
+        size_t first_piece{files_[i].start_off / piece_length_};
+        size_t last_piece{(files_[i].start_off + files_[i].length - 1) / piece_length_};
+
+        for (size_t piece_idx{first_piece}; piece_idx <= last_piece; ++piece_idx) {
+            to_verify[piece_idx] = true;
+        }
+    }
+
+    std::scoped_lock lock(completed_pieces_mutex_);
+
+    std::vector<uint32_t> pieces_to_verify;
+    for (uint32_t piece_idx{0}; piece_idx < completed_pieces_.size(); ++piece_idx) {
+        if (to_verify[piece_idx] && completed_pieces_[piece_idx]) {
+            pieces_to_verify.push_back(piece_idx);
+        }
+    }
+
+    return pieces_to_verify;
+}
+
+void ResumeData::set_piece_completed(uint32_t piece_index, bool completed) {
+    std::scoped_lock lock(completed_pieces_mutex_);
+    if (completed_pieces_[piece_index] != completed) {
+        completed_pieces_[piece_index] = completed;
+        dirty_                         = true;
+    }
+}
+
+void ResumeData::save(const std::function<void()>& sync_files) {
+    std::string pieces((completed_pieces_.size() + 7) / 8, '\0');
+    {
+        std::scoped_lock lock(completed_pieces_mutex_);
+        if (!dirty_) {
+            return;
+        }
+        dirty_ = false;
+
+        for (size_t i{0}; i < completed_pieces_.size(); ++i) {
+            if (completed_pieces_[i]) {
+                pieces[i / 8] = static_cast<char>(pieces[i / 8] | (1U << (7 - i % 8)));
+            }
+        }
+    }
+
+    // A piece is recorded once written, which only puts it in the page cache. After a crash, the
+    // resume file must not vouch for data that never reached the disk
+    if (sync_files) {
+        try {
+            sync_files();
+        } catch (const std::exception& e) {
+            LOG_WARN("Failed to sync the files, the resume file is not saved: {}", e.what());
+            std::scoped_lock lock(completed_pieces_mutex_);
+            dirty_ = true;
+            return;
+        }
+    }
+
+    using namespace Bencode;
+
+    // The state of the files is taken after the pieces, so every recorded piece was written
+    // before the recorded modification time. A piece written afterwards changes the
+    // modification time, which only causes the file to be verified on the next start
+    BencodeList files;
+    files.reserve(files_.size());
+    for (const auto& file : files_) {
+        auto [size, mtime_ns] = get_file_state(file.path);
+
+        BencodeDict file_dict;
+        file_dict.emplace("size", BencodeItem(BencodeInt{size}));
+        file_dict.emplace("mtime", BencodeItem(BencodeInt{mtime_ns}));
+        files.emplace_back(std::move(file_dict));
+    }
+
+    BencodeDict resume_dict;
+    resume_dict.emplace(
+        "info-hash",
+        BencodeItem(BencodeString(info_hash_.get().begin(), info_hash_.get().end()))
+    );
+    resume_dict.emplace("pieces", BencodeItem(std::move(pieces)));
+    resume_dict.emplace("files", BencodeItem(std::move(files)));
+
+    std::string encoded{BEncode(BencodeItem(std::move(resume_dict)))};
+
+    // Write to a temporary file first, and replace the resume file with it once it is complete
+    auto tmp_file{resume_file_};
+    tmp_file += ".tmp";
+
+    std::ofstream resume_ostream(tmp_file, std::ios::binary | std::ios::out | std::ios::trunc);
+    resume_ostream.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+    resume_ostream.close();
+
+    std::error_code ec;
+    if (!resume_ostream.fail()) {
+        std::filesystem::rename(tmp_file, resume_file_, ec);
+    }
+
+    if (resume_ostream.fail() || ec) {
+        LOG_WARN("Failed to save resume file {}", resume_file_.string());
+        // Try again on the next save
+        std::scoped_lock lock(completed_pieces_mutex_);
+        dirty_ = true;
+    }
+}
+
+auto ResumeData::get_file_state(const std::filesystem::path& path) -> FileState {
+    struct stat file_stat {};
+    if (::stat(path.c_str(), &file_stat) != 0) {
+        return {};
+    }
+
+    return {
+        .size     = static_cast<int64_t>(file_stat.st_size),
+        .mtime_ns = static_cast<int64_t>(file_stat.st_mtim.tv_sec) * 1'000'000'000 +
+                    file_stat.st_mtim.tv_nsec,
+    };
+}
+
+}  // namespace torrent::fs
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "Crypto.hpp"
+#include "TorrentMetadata.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace torrent::fs {
+
+class ResumeData {
+    public:
+        /**
+         * @brief Create the resume data of a torrent, with no completed pieces
+         *
+         * @param resume_file  the path of the resume file
+         * @param files_info   the files of the torrent
+         * @param dest_dir     the directory the files are created in
+         * @param info_hash    the info hash of the torrent, used to match the resume file with it
+         * @param piece_length the length of a piece
+         * @param pieces_cnt   the number of pieces of the torrent
+         */
+        ResumeData(
+            std::filesystem::path         resume_file,
+            std::span<const md::FileInfo> files_info,
+            const std::filesystem::path&  dest_dir,
+            const crypto::Sha1&           info_hash,
+            size_t                        piece_length,
+            size_t                        pieces_cnt
+        );
+
+        /**
+         * @brief Load the resume file and compare the recorded state of the files with the
+         * current one
+         *
+         * @return true if a resume file matching the torrent was loaded, false otherwise
+         * @note A missing or invalid resume file is not an error, the download simply starts
+         * from scratch
+         */
+        bool load();
+
+        /**
+         * @brief Get the pieces that were completed according to the resume file
+         *
+         * @return the completed pieces
+         */
+        [[nodiscard]] std::vector<bool> get_completed_pieces() const;
+
+        /**
+         * @brief Get the completed pieces that lie in a file whose size or modification time
+         * changed since the resume file was saved
+         *
+         * @return the indices of the pieces that have to be verified again
+         */
+        [[nodiscard]] std::vector<uint32_t> get_pieces_to_verify() const;
+
+        /**
+         * @brief Mark a piece as completed or not
+         *
+         * @param piece_index the index of the piece
+         * @param completed   true if the piece is on disk and verified
+         * @note This function is thread-safe
+         */
+        void set_piece_completed(uint32_t piece_index, bool completed);
+
+        /**
+         * @brief Write the resume file, if anything changed since it was last written
+         * The file is replaced atomically, so a crash never leaves a partial resume file behind
+         *
+         * @param sync_files called once the completed pieces are taken, to make their data durable
+         * before they are recorded, e.g. FileManager::sync
+         * @note This function is thread-safe
+         * @note Failures are logged but not reported, since they do not affect the download
+         */
+        void save(const std::function<void()>& sync_files = {});
+
+    private:
+        struct FileState {
+                int64_t size{-1};
+                int64_t mtime_ns{-1};
+
+                friend bool operator==(const FileState&, const FileState&) = default;
+        };
+
+        /**
+         * @brief Get the current size and modification time of a file
+         *
+         * @param path the path of the file
+         * @return the state of the file, or the default state if the file does not exist
+         */
+        [[nodiscard]] static FileState get_file_state(const std::filesystem::path& path);
+
+        std::filesystem::path     resume_file_;
+        std::vector<md::FileInfo> files_;
+        crypto::Sha1              info_hash_;
+        size_t                    piece_length_;
+        // Files whose state differs from the one recorded in the resume file
+        std::vector<bool> changed_files_;
+
+        mutable std::mutex completed_pieces_mutex_;
+        std::vector<bool>  completed_pieces_;
+        // Set when the completed pieces changed since the resume file was last written
+        bool dirty_{false};
+};
+
+}  // namespace torrent::fs
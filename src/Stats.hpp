@@ -24,7 +24,8 @@ struct Stats {
          * @return The download rate
          */
         [[nodiscard]] double get_download_rate() const {
-            return static_cast<double>(downloaded_bytes * 1'000) / get_elapsed_ms().count();
+            return static_cast<double>((downloaded_bytes - resumed_bytes) * 1'000) /
+                   get_elapsed_ms().count();
         }
 
         /**
@@ -71,6 +72,14 @@ struct Stats {
         size_t                                             downloaded_bytes{};
         std::chrono::time_point<std::chrono::steady_clock> start_time;
         uint16_t                                           connected_peers{};
+        // Number of bytes that were already on disk when the download started
+        size_t resumed_bytes{};
+        // Number of complete pieces waiting to be verified
+        size_t hash_queue_depth{};
+        // Number of verified pieces waiting to be written to disk
+        size_t disk_queue_depth{};
+        // Average time it takes a verified piece to reach the disk
+        std::chrono::microseconds disk_write_latency{};
 };
 
 }  // namespace torrent
@@ -0,0 +1,14 @@
+#include "SyncStorage.hpp"
+
+namespace torrent::fs {
+
+SyncStorage::SyncStorage(
+    std::span<const md::FileInfo> files_info, const std::filesystem::path& dest_dir
+) {
+    files_.reserve(files_info.size());
+    for (const auto& file_info : files_info) {
+        files_.emplace_back(dest_dir / file_info.path, file_info.length);
+    }
+}
+
+}  // namespace torrent::fs
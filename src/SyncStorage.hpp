@@ -0,0 +1,86 @@
+#pragma once
+
+#include "File.hpp"
+#include "IStorage.hpp"
+#include "TorrentMetadata.hpp"
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace torrent::fs {
+
+class SyncStorage final : public IStorage {
+    public:
+        SyncStorage(
+            std::span<const md::FileInfo> files_info, const std::filesystem::path& dest_dir
+        );
+
+        /**
+         * @brief Write data to a file at a given offset
+         * The write is completed by the time the function returns
+         *
+         * @param file_index the index of the file
+         * @param data       the data to write
+         * @param offset     the offset in the file to write the data at
+         */
+        void write(size_t file_index, std::span<const char> data, size_t offset) override {
+            files_[file_index].write(data, offset);
+        }
+
+        /**
+         * @brief Write multiple buffers to a file with a single pwritev call
+         * The write is completed by the time the function returns
+         *
+         * @param file_index the index of the file
+         * @param buffers    the buffers to write
+         * @param offset     the offset in the file to write the first buffer at
+         */
+        void writev(
+            size_t file_index, std::span<const std::span<const char>> buffers, size_t offset
+        ) override {
+            files_[file_index].writev(buffers, offset);
+        }
+
+        /**
+         * @brief All the writes are synchronous, so there is nothing to wait for
+         */
+        void flush() override {}
+
+        /**
+         * @brief Wait until the data written to the files has reached the disk
+         */
+        void sync() override {
+            for (const auto& file : files_) {
+                file.sync();
+            }
+        }
+
+        /**
+         * @brief Read data from a file at a given offset
+         *
+         * @param file_index the index of the file
+         * @param data       the buffer to read the data into
+         * @param offset     the offset in the file to read the data from
+         */
+        void read(size_t file_index, std::span<char> data, size_t offset) override {
+            files_[file_index].read(data, offset);
+        }
+
+        /**
+         * @brief Tell the kernel how a range of a file is going to be accessed
+         *
+         * @param file_index the index of the file
+         * @param offset     the offset of the range in the file
+         * @param length     the length of the range
+         * @param advice     the expected access
+         */
+        void advise(size_t file_index, size_t offset, size_t length, AccessAdvice advice) override {
+            files_[file_index].advise(offset, length, advice);
+        }
+
+    private:
+        std::vector<File> files_;
+};
+
+}  // namespace torrent::fs
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace torrent::utils {
+
+/**
+ * @brief Hierarchical timer wheel driven by a coarse clock counted in ticks
+ *
+ * The timers expiring in the next 64 ticks are stored in the slot of their tick in the first
+ * level, the later ones in the slots of the higher levels, each covering 64 times more ticks. The
+ * timers of a higher level slot move down a level when the clock reaches the slot, so scheduling
+ * and expiring a timer cost O(1) no matter how many timers are pending
+ *
+ * @tparam T Type of the value carried by a timer
+ */
+template <typename T>
+class TimerWheel {
+    public:
+        /**
+         * @brief Schedule a timer
+         *
+         * @param value Value handed back when the timer expires
+         * @param expiry_tick Tick at which the timer expires, a past tick expires on the next
+         * advance
+         */
+        void schedule(T value, uint64_t expiry_tick) {
+            expiry_tick = std::max(expiry_tick, current_tick_ + 1);
+            insert({expiry_tick, std::move(value)});
+            ++size_;
+        }
+
+        /**
+         * @brief Advance the clock and expire the timers up to a tick
+         *
+         * @param now_tick The current tick
+         * @param on_expired Function called with the value of each expired timer, in the order
+         * of their expiry
+         * @note A clock that jumped ahead, e.g. after a suspend, costs O(timers) rather than one
+         * step per tick
+         */
+        template <typename Func>
+        void advance(uint64_t now_tick, Func&& on_expired) {
+            if (now_tick <= current_tick_) {
+                return;
+            }
+            if (size_ == 0) {
+                current_tick_ = now_tick;
+                return;
+            }
+            // Going over every slot once is cheaper than stepping through a long gap
+            if (now_tick - current_tick_ > SLOTS_PER_LEVEL * LEVELS) {
+                jump(now_tick, on_expired);
+                return;
+            }
+
+            while (current_tick_ < now_tick) {
+                ++current_tick_;
+                cascade();
+
+                // Swap the slot out, so the expiry handler is free to schedule new timers
+                auto& slot{levels_[0][current_tick_ & SLOT_MASK]};
+                expired_.swap(slot);
+                size_ -= expired_.size();
+                for (auto& timer : expired_) {
+                    on_expired(std::move(timer.second));
+                }
+                expired_.clear();
+            }
+        }
+
+        /**
+         * @brief Get the tick the clock was last advanced to
+         *
+         * @return The current tick
+         */
+        [[nodiscard]] uint64_t get_current_tick() const { return current_tick_; }
+
+        /**
+         * @brief Get the number of pending timers
+         *
+         * @return Number of timers
+         */
+        [[nodiscard]] size_t size() const { return size_; }
+
+    private:
+        static constexpr size_t   LEVEL_BITS{6};
+        static constexpr size_t   SLOTS_PER_LEVEL{1ULL << LEVEL_BITS};
+        static constexpr uint64_t SLOT_MASK{SLOTS_PER_LEVEL - 1};
+        static constexpr size_t   LEVELS{4};
+
+        // A timer, in form of (expiry_tick, value)
+        using Timer = std::pair<uint64_t, T>;
+
+        /**
+         * @brief Store a timer in the slot of the lowest level that covers its expiry
+         *
+         * @param timer The timer, which expires after the current tick
+         */
+        void insert(Timer timer) {
+            auto   delta{timer.first - current_tick_};
+            size_t level{0};
+            while (level + 1 < LEVELS && delta >= (1ULL << (LEVEL_BITS * (level + 1)))) {
+                ++level;
+            }
+            // The timers too far away for the last level are moved down again when their slot is
+            // reached, until they get close enough
+            auto slot{(timer.first >> (LEVEL_BITS * level)) & SLOT_MASK};
+            levels_[level][slot].push_back(std::move(timer));
+        }
+
+        /**
+         * @brief Move the clock straight to a tick, expiring the timers up to it in the order of
+         * their expiry and storing the others again
+         *
+         * @param now_tick The current tick
+         * @param on_expired Function called with the value of each expired timer
+         */
+        template <typename Func>
+        void jump(uint64_t now_tick, Func&& on_expired) {
+            std::vector<Timer> timers;
+            timers.reserve(size_);
+            for (auto& level : levels_) {
+                for (auto& slot : level) {
+                    std::ranges::move(slot, std::back_inserter(timers));
+                    slot.clear();
+                }
+            }
+            std::ranges::stable_sort(timers, {}, &Timer::first);
+
+            current_tick_ = now_tick;
+            size_         = 0;
+            auto first_pending{std::ranges::upper_bound(timers, now_tick, {}, &Timer::first)};
+            for (auto it{first_pending}; it != timers.end(); ++it) {
+                insert(std::move(*it));
+                ++size_;
+            }
+            // The expiry handler may schedule new timers, which are stored after the current tick
+            for (auto it{timers.begin()}; it != first_pending; ++it) {
+                on_expired(std::move(it->second));
+            }
+        }
+
+        /**
+         * @brief Move the timers of the higher level slots that the clock reached down a level
+         * The highest level is moved first, since its timers may land in a slot of a lower level
+         * that is reached at the same tick
+         */
+        void cascade() {
+            size_t top_level{0};
+            while (top_level + 1 < LEVELS &&
+                   (current_tick_ & ((1ULL << (LEVEL_BITS * (top_level + 1))) - 1)) == 0) {
+                ++top_level;
+            }
+
+            for (auto level{top_level}; level > 0; --level) {
+                auto& slot{levels_[level][(current_tick_ >> (LEVEL_BITS * level)) & SLOT_MASK]};
+                expired_.swap(slot);
+                for (auto& timer : expired_) {
+                    insert(std::move(timer));
+                }
+                expired_.clear();
+            }
+        }
+
+        std::array<std::array<std::vector<Timer>, SLOTS_PER_LEVEL>, LEVELS> levels_;
+        // Timers taken out of a slot, kept to reuse its memory
+        std::vector<Timer> expired_;
+        uint64_t           current_tick_{0};
+        size_t             size_{0};
+};
+
+}  // namespace torrent::utils
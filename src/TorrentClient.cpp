@@ -1,12 +1,15 @@
 #include "TorrentClient.hpp"
 
 #include "Constant.hpp"
+#include "Duration.hpp"
 #include "Error.hpp"
 #include "FileManager.hpp"
 #include "Logger.hpp"
 #include "PeerRetriever.hpp"
+#include "PieceVerifier.hpp"
 #include "Utils.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <filesystem>
@@ -14,13 +17,36 @@
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <numeric>
+#include <span>
 #include <string>
+#include <system_error>
 #include <thread>
+#include <vector>
+
+namespace {
+
+bool has_existing_data(
+    std::span<const torrent::md::FileInfo> files_info, const std::filesystem::path& dest_dir
+) {
+    return std::ranges::any_of(files_info, [&dest_dir](const auto& file_info) {
+        std::error_code ec;
+        auto            file_size{std::filesystem::file_size(dest_dir / file_info.path, ec)};
+        return !ec && file_size > 0;
+    });
+}
+
+}  // namespace
 
 namespace torrent {
 
 TorrentClient::TorrentClient(
-    std::filesystem::path torrent_file, std::filesystem::path output_dir, uint16_t port
+    std::filesystem::path torrent_file,
+    std::filesystem::path output_dir,
+    fs::StorageType       storage_type,
+    fs::AllocationPolicy  allocation_policy,
+    PieceBuffering        piece_buffering,
+    uint16_t              port
 ) {
     std::ifstream torrent_istream(torrent_file, std::ios::binary | std::ios::in);
 
@@ -30,18 +56,39 @@ TorrentClient::TorrentClient(
 
     torrent_md_ = md::parse_torrent_file(torrent_istream);
 
-    file_manager_ = std::make_shared<fs::FileManager>(torrent_md_.files, output_dir);
+    // The resume file is kept next to the downloaded files
+    resume_data_ = std::make_shared<fs::ResumeData>(
+        output_dir / (torrent_md_.name + std::string(fs::RESUME_FILE_EXTENSION)),
+        torrent_md_.files,
+        output_dir,
+        torrent_md_.info_hash,
+        torrent_md_.piece_length,
+        torrent_md_.piece_hashes.size() / crypto::SHA1_SIZE
+    );
+
+    resumed_ = resume_data_->load();
+    // Without a resume file, the data already in the files can still be reused once it is checked
+    existing_data_ = !resumed_ && has_existing_data(torrent_md_.files, output_dir);
+
+    // Keep the content of the files if there is something to reuse
+    file_manager_ = std::make_shared<fs::FileManager>(
+        torrent_md_.files, output_dir, storage_type, allocation_policy, resumed_ || existing_data_
+    );
 
     piece_manager_ = std::make_shared<PieceManager>(
         torrent_md_.piece_length,
         file_manager_->get_total_length(),
         file_manager_,
-        std::span<const uint8_t>(
-            reinterpret_cast<const uint8_t*>(torrent_md_.piece_hashes.data()),
-            torrent_md_.piece_hashes.size()
-        )
+        get_piece_hashes(),
+        duration::REQUEST_TIMEOUT,
+        piece_buffering
     );
 
+    // Record the pieces in the resume file as soon as they are on disk
+    piece_manager_->set_on_piece_written([resume_data = resume_data_](uint32_t piece_index) {
+        resume_data->set_piece_completed(piece_index, true);
+    });
+
     // Generate the client ID
     std::string client_id{
         std::format("{}{}", CLIENT_ID_BASE, utils::generate_random<uint64_t>(1e11, 1e12 - 1))
@@ -69,13 +116,85 @@ TorrentClient::TorrentClient(
               << std::flush;
 }
 
+size_t TorrentClient::check_existing_data(bool full) {
+    std::vector<bool>     completed_pieces(piece_manager_->get_piece_count(), false);
+    std::vector<uint32_t> pieces_to_check;
+
+    if (full || existing_data_) {
+        pieces_to_check.resize(piece_manager_->get_piece_count());
+        std::iota(pieces_to_check.begin(), pieces_to_check.end(), 0);
+    } else if (resumed_) {
+        // Only the pieces of the files changed since the resume file was saved are checked
+        completed_pieces = resume_data_->get_completed_pieces();
+        pieces_to_check  = resume_data_->get_pieces_to_verify();
+    }
+
+    if (!pieces_to_check.empty()) {
+        LOG_INFO("Checking {} pieces of the existing data", pieces_to_check.size());
+
+        PieceVerifier verifier(
+            file_manager_,
+            get_piece_hashes(),
+            torrent_md_.piece_length,
+            file_manager_->get_total_length()
+        );
+        auto valid_pieces{verifier.verify(pieces_to_check)};
+
+        for (auto piece_idx : pieces_to_check) {
+            completed_pieces[piece_idx] = valid_pieces[piece_idx];
+            resume_data_->set_piece_completed(piece_idx, valid_pieces[piece_idx]);
+        }
+    }
+
+    piece_manager_->restore_completed_pieces(completed_pieces);
+    stats_.resumed_bytes = piece_manager_->get_downloaded_bytes();
+
+    return static_cast<size_t>(std::ranges::count(completed_pieces, true));
+}
+
+bool TorrentClient::verify_files() {
+    download_status_.store(DownloadStatus::CHECKING, std::memory_order_release);
+
+    auto valid_pieces_cnt{check_existing_data(true)};
+    save_resume_data();
+
+    download_status_.store(DownloadStatus::STOPPED, std::memory_order_release);
+
+    std::cout << std::format(
+                     "Valid pieces: {}/{}\n", valid_pieces_cnt, piece_manager_->get_piece_count()
+                 )
+              << std::flush;
+
+    return valid_pieces_cnt == piece_manager_->get_piece_count();
+}
+
 void TorrentClient::update_stats() const {
-    stats_.downloaded_bytes = piece_manager_->get_downloaded_bytes();
-    stats_.connected_peers  = peer_manager_->get_connected_peers();
+    stats_.downloaded_bytes   = piece_manager_->get_downloaded_bytes();
+    stats_.connected_peers    = peer_manager_->get_connected_peers();
+    stats_.hash_queue_depth   = piece_manager_->get_hash_queue_depth();
+    stats_.disk_queue_depth   = piece_manager_->get_disk_queue_depth();
+    stats_.disk_write_latency = piece_manager_->get_disk_write_latency();
 }
 
 void TorrentClient::start_download() {
-    auto peers = peer_retriever_->retrieve_peers(0);
+    download_status_.store(DownloadStatus::CHECKING, std::memory_order_release);
+
+    if (auto valid_pieces_cnt{check_existing_data()}; valid_pieces_cnt > 0) {
+        std::cout << std::format(
+                         "Resumed {}/{} pieces\n",
+                         valid_pieces_cnt,
+                         piece_manager_->get_piece_count()
+                     )
+                  << std::flush;
+    }
+
+    if (piece_manager_->completed_thread_safe()) {
+        LOG_INFO("All the pieces are already downloaded");
+        download_status_.store(DownloadStatus::FINISHED, std::memory_order_release);
+        return;
+    }
+
+    auto peers = peer_retriever_->retrieve_peers(piece_manager_->get_downloaded_bytes());
 
     if (!peers.has_value()) {
         err::throw_with_trace("Failed to retrieve peers from the tracker");
@@ -90,10 +209,17 @@ void TorrentClient::start_download() {
     peer_manager_->add_peers(*peers);
 
     auto next_request_time{std::chrono::steady_clock::now() + peer_retriever_->get_interval()};
+    auto next_save_time{std::chrono::steady_clock::now() + duration::RESUME_SAVE_INTERVAL};
 
     while (!piece_manager_->completed_thread_safe()) {
         std::this_thread::sleep_for(std::chrono::seconds(1));
 
+        // Persist the pieces written since the last save
+        if (std::chrono::steady_clock::now() >= next_save_time) {
+            save_resume_data();
+            next_save_time = std::chrono::steady_clock::now() + duration::RESUME_SAVE_INTERVAL;
+        }
+
         if (std::chrono::steady_clock::now() >= next_request_time &&
             peer_manager_->get_connected_peers() < TARGET_PEER_COUNT) {
             peers = peer_retriever_->retrieve_peers(piece_manager_->get_downloaded_bytes());
@@ -107,6 +233,7 @@ void TorrentClient::start_download() {
     // Mark the end of the download
     LOG_INFO("Download completed");
     peer_manager_->stop();
+    save_resume_data();
     download_status_.store(DownloadStatus::FINISHED, std::memory_order_release);
 }
 
@@ -4,6 +4,7 @@
 #include "PeerManager.hpp"
 #include "PeerRetriever.hpp"
 #include "PieceManager.hpp"
+#include "ResumeData.hpp"
 #include "Stats.hpp"
 #include "TorrentMetadata.hpp"
 
@@ -11,24 +12,38 @@
 #include <cstdint>
 #include <filesystem>
 #include <memory>
+#include <span>
 
 namespace torrent {
 
-enum class DownloadStatus { STOPPED, DOWNLOADING, FINISHED };
+enum class DownloadStatus { STOPPED, CHECKING, DOWNLOADING, FINISHED };
 
 class TorrentClient {
     public:
         TorrentClient(
             std::filesystem::path torrent_file,
-            std::filesystem::path output_dir = ".",
-            uint16_t              port       = 6'881
+            std::filesystem::path output_dir        = ".",
+            fs::StorageType       storage_type      = fs::StorageType::SYNC,
+            fs::AllocationPolicy  allocation_policy = fs::DEFAULT_ALLOCATION_POLICY,
+            PieceBuffering        piece_buffering   = PieceBuffering::MEMORY,
+            uint16_t              port              = 6'881
         );
 
         /**
          * Start the download process.
+         * The data already in the files is checked first, so it does not have to be downloaded
+         * again.
          */
         void start_download();
 
+        /**
+         * Check every piece of the files against its hash, and record the result in the resume
+         * file.
+         *
+         * @return True if all the pieces are valid.
+         */
+        bool verify_files();
+
         /**
          * Get the stats of the torrent client.
          *
@@ -53,13 +68,47 @@ class TorrentClient {
     private:
         void update_stats() const;
 
+        /**
+         * Check the data already in the files and mark the valid pieces as completed.
+         * With a resume file, only the pieces of the files changed since it was saved are
+         * checked, unless a full check is requested.
+         *
+         * @param full Check every piece, even if a resume file was loaded.
+         * @return The number of completed pieces.
+         */
+        size_t check_existing_data(bool full = false);
+
+        /**
+         * Record the written pieces in the resume file, once their data has reached the disk.
+         */
+        void save_resume_data() {
+            resume_data_->save([file_manager = file_manager_] { file_manager->sync(); });
+        }
+
+        /**
+         * Get the hashes of the pieces of the torrent.
+         *
+         * @return The concatenated SHA-1 hashes of the pieces.
+         */
+        [[nodiscard]] std::span<const uint8_t> get_piece_hashes() const {
+            return {
+                reinterpret_cast<const uint8_t*>(torrent_md_.piece_hashes.data()),
+                torrent_md_.piece_hashes.size()
+            };
+        }
+
         md::TorrentMetadata              torrent_md_;
+        std::shared_ptr<fs::ResumeData>  resume_data_;
         std::shared_ptr<fs::FileManager> file_manager_;
         std::shared_ptr<PieceManager>    piece_manager_;
         std::shared_ptr<PeerManager>     peer_manager_;
         std::shared_ptr<PeerRetriever>   peer_retriever_;
         mutable Stats                    stats_;
         std::atomic<DownloadStatus>      download_status_{DownloadStatus::STOPPED};
+        // Set if the resume file of the torrent was loaded
+        bool resumed_{false};
+        // Set if there is no resume file, but the files already contain data
+        bool existing_data_{false};
 };
 
 }  // namespace torrent
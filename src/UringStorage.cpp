@@ -0,0 +1,272 @@
+#include "UringStorage.hpp"
+
+#include "Error.hpp"
+#include "FileUtils.hpp"
+#include "Logger.hpp"
+
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <climits>
+#include <format>
+#include <optional>
+#include <ranges>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace torrent::fs {
+
+UringStorage::UringStorage(
+    std::span<const md::FileInfo> files_info,
+    const std::filesystem::path&  dest_dir,
+    unsigned                      queue_depth
+)
+    : pending_writes_(queue_depth) {
+    if (int ret = io_uring_queue_init(queue_depth, &ring_, 0); ret < 0) {
+        err::throw_with_trace(
+            std::format("Failed to initialize io_uring: {}", std::strerror(-ret))
+        );
+    }
+
+    // Hand out the lower slots first
+    free_slots_ = std::views::iota(0U, queue_depth) | std::views::reverse |
+                  std::ranges::to<std::vector<uint32_t>>();
+
+    fds_.reserve(files_info.size());
+    for (const auto& file_info : files_info) {
+        try {
+            fds_.push_back(open_file(dest_dir / file_info.path));
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    // Registered files save the kernel a file table lookup on every write
+    if (int ret = io_uring_register_files(&ring_, fds_.data(), fds_.size()); ret < 0) {
+        LOG_DEBUG("Failed to register the files with io_uring: {}", std::strerror(-ret));
+    } else {
+        files_registered_ = true;
+    }
+}
+
+UringStorage::~UringStorage() {
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to flush the pending writes: {}", e.what());
+    }
+    release();
+}
+
+void UringStorage::writev(
+    size_t file_index, std::span<const std::span<const char>> buffers, size_t offset
+) {
+    std::scoped_lock        lock(ring_mutex_);
+    std::optional<uint32_t> slot;
+
+    auto queue_write = [this, &slot] {
+        prepare_write(*slot);
+        slot.reset();
+
+        // Submit the batch once the submission queue is full
+        if (io_uring_sq_space_left(&ring_) == 0) {
+            io_uring_submit(&ring_);
+            unsubmitted_ = 0;
+        }
+    };
+
+    for (auto buffer : buffers) {
+        if (buffer.empty()) {
+            continue;
+        }
+
+        iovec iov{const_cast<char*>(buffer.data()), buffer.size()};
+
+        // A fixed write only takes a single buffer, so each buffer of the registered region gets
+        // a submission of its own instead of joining a vectored write
+        bool fixed{is_in_registered_buffer(iov)};
+        if (fixed && slot.has_value()) {
+            queue_write();
+        }
+
+        if (!slot.has_value()) {
+            // Wait for a slot to be freed if all of them are in flight
+            while (free_slots_.empty()) {
+                reap_completions();
+            }
+
+            slot = free_slots_.back();
+            free_slots_.pop_back();
+
+            auto& pending_write{pending_writes_[*slot]};
+            pending_write.file_index = file_index;
+            pending_write.offset     = offset;
+            pending_write.size       = 0;
+            pending_write.iovecs.clear();
+        }
+
+        auto& pending_write{pending_writes_[*slot]};
+        pending_write.iovecs.push_back(iov);
+        pending_write.size += buffer.size();
+        offset += buffer.size();
+
+        // A fixed write goes out alone, and a single submission can carry at most IOV_MAX buffers
+        if (fixed || pending_write.iovecs.size() == IOV_MAX) {
+            queue_write();
+        }
+    }
+
+    if (slot.has_value()) {
+        queue_write();
+    }
+}
+
+void UringStorage::flush() {
+    std::scoped_lock lock(ring_mutex_);
+    wait_pending_writes();
+
+    if (first_error_ != 0) {
+        int error{first_error_};
+        first_error_ = 0;
+        err::throw_with_trace(std::format("Failed to write to file: {}", std::strerror(error)));
+    }
+}
+
+void UringStorage::read(size_t file_index, std::span<char> data, size_t offset) {
+    {
+        // The errors of the writes are left to the flush of the writer
+        std::scoped_lock lock(ring_mutex_);
+        wait_pending_writes();
+    }
+    read_at(fds_[file_index], data, offset);
+}
+
+void UringStorage::register_buffer(std::span<std::byte> buffer) {
+    // The buffers can only be changed while there are no writes in flight
+    std::scoped_lock lock(ring_mutex_);
+    wait_pending_writes();
+
+    if (!registered_buffer_.empty()) {
+        io_uring_unregister_buffers(&ring_);
+        registered_buffer_ = {};
+    }
+
+    iovec iov{buffer.data(), buffer.size()};
+
+    if (int ret = io_uring_register_buffers(&ring_, &iov, 1); ret < 0) {
+        LOG_WARN("Failed to register the io_uring fixed buffer: {}", std::strerror(-ret));
+        return;
+    }
+
+    registered_buffer_ = buffer;
+}
+
+void UringStorage::prepare_write(uint32_t slot) {
+    const auto& pending_write{pending_writes_[slot]};
+
+    io_uring_sqe* sqe{io_uring_get_sqe(&ring_)};
+    if (sqe == nullptr) {
+        // The submission queue is full, submit the batch to make room
+        io_uring_submit(&ring_);
+        unsubmitted_ = 0;
+        sqe          = io_uring_get_sqe(&ring_);
+    }
+
+    int fd{files_registered_ ? static_cast<int>(pending_write.file_index)
+                             : fds_[pending_write.file_index]};
+
+    const auto& iovecs{pending_write.iovecs};
+
+    if (iovecs.size() > 1) {
+        io_uring_prep_writev(
+            sqe, fd, iovecs.data(), static_cast<unsigned>(iovecs.size()), pending_write.offset
+        );
+    } else if (is_in_registered_buffer(iovecs.front())) {
+        io_uring_prep_write_fixed(
+            sqe,
+            fd,
+            iovecs.front().iov_base,
+            static_cast<unsigned>(iovecs.front().iov_len),
+            pending_write.offset,
+            0
+        );
+    } else {
+        io_uring_prep_write(
+            sqe,
+            fd,
+            iovecs.front().iov_base,
+            static_cast<unsigned>(iovecs.front().iov_len),
+            pending_write.offset
+        );
+    }
+
+    if (files_registered_) {
+        io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+    }
+    io_uring_sqe_set_data64(sqe, slot);
+    ++unsubmitted_;
+}
+
+void UringStorage::reap_completions() {
+    // Submit whatever is still queued and wait for at least one completion
+    if (int ret = io_uring_submit_and_wait(&ring_, 1); ret < 0 && ret != -EINTR) {
+        err::throw_with_trace(std::format("Failed to submit to io_uring: {}", std::strerror(-ret)));
+    }
+    unsubmitted_ = 0;
+
+    std::vector<uint32_t> short_writes;
+    unsigned              head{};
+    unsigned              completions{0};
+    io_uring_cqe*         cqe{nullptr};
+
+    io_uring_for_each_cqe(&ring_, head, cqe) {
+        auto  slot{static_cast<uint32_t>(io_uring_cqe_get_data64(cqe))};
+        auto& pending_write{pending_writes_[slot]};
+
+        if (cqe->res <= 0) {
+            // A write of 0 bytes would never make progress, so treat it as an error
+            if (first_error_ == 0) {
+                first_error_ = cqe->res < 0 ? -cqe->res : EIO;
+            }
+            free_slots_.push_back(slot);
+        } else if (static_cast<size_t>(cqe->res) < pending_write.size) {
+            auto written{static_cast<size_t>(cqe->res)};
+            pending_write.size -= written;
+            pending_write.offset += written;
+
+            // Drop the buffers that have been written entirely, and advance into the partially
+            // written one
+            auto& iovecs{pending_write.iovecs};
+            auto  first_left{iovecs.begin()};
+            while (written >= first_left->iov_len) {
+                written -= first_left->iov_len;
+                ++first_left;
+            }
+            iovecs.erase(iovecs.begin(), first_left);
+            iovecs.front().iov_base = static_cast<char*>(iovecs.front().iov_base) + written;
+            iovecs.front().iov_len -= written;
+
+            short_writes.push_back(slot);
+        } else {
+            free_slots_.push_back(slot);
+        }
+        ++completions;
+    }
+    io_uring_cq_advance(&ring_, completions);
+
+    // Requeue the remaining data of the short writes
+    for (auto slot : short_writes) {
+        prepare_write(slot);
+    }
+}
+
+void UringStorage::release() {
+    io_uring_queue_exit(&ring_);
+    for (int fd : fds_) {
+        ::close(fd);
+    }
+    fds_.clear();
+}
+
+}  // namespace torrent::fs
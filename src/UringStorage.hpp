@@ -0,0 +1,192 @@
+#pragma once
+
+#include "Constant.hpp"
+#include "IStorage.hpp"
+#include "TorrentMetadata.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <liburing.h>
+#include <mutex>
+#include <span>
+#include <sys/uio.h>
+#include <vector>
+
+namespace torrent::fs {
+
+class UringStorage final : public IStorage {
+    public:
+        /**
+         * @brief Open the files and set up the io_uring instance
+         *
+         * @param files_info the files of the torrent
+         * @param dest_dir   the directory the files are created in
+         * @param queue_depth the number of entries of the submission queue
+         * @note Throws if the kernel does not support io_uring
+         */
+        UringStorage(
+            std::span<const md::FileInfo> files_info,
+            const std::filesystem::path&  dest_dir,
+            unsigned                      queue_depth = URING_QUEUE_DEPTH
+        );
+
+        UringStorage(const UringStorage&)            = delete;
+        UringStorage& operator=(const UringStorage&) = delete;
+        UringStorage(UringStorage&&)                 = delete;
+        UringStorage& operator=(UringStorage&&)      = delete;
+
+        /**
+         * @brief Wait for the pending writes and release the ring and the files
+         */
+        ~UringStorage() override;
+
+        /**
+         * @brief Queue a write to a file at a given offset
+         * The writes are submitted to the kernel in batches, either when the submission queue is
+         * full or when flush is called
+         *
+         * @param file_index the index of the file
+         * @param data       the data to write
+         * @param offset     the offset in the file to write the data at
+         */
+        void write(size_t file_index, std::span<const char> data, size_t offset) override {
+            writev(file_index, std::span<const std::span<const char>>(&data, 1), offset);
+        }
+
+        /**
+         * @brief Queue a vectored write of multiple buffers to a file at a given offset
+         * The buffers inside the registered buffer are queued as separate fixed writes
+         *
+         * @param file_index the index of the file
+         * @param buffers    the buffers to write
+         * @param offset     the offset in the file to write the first buffer at
+         */
+        void writev(
+            size_t file_index, std::span<const std::span<const char>> buffers, size_t offset
+        ) override;
+
+        /**
+         * @brief Submit the queued writes and reap the completions of all the pending ones
+         *
+         * @note Throws if any of the writes failed
+         */
+        void flush() override;
+
+        /**
+         * @brief Wait until the data of the completed writes has reached the disk
+         * The ring is left alone, so the writes still in flight are not waited for
+         */
+        void sync() override {
+            for (int fd : fds_) {
+                sync_file(fd);
+            }
+        }
+
+        /**
+         * @brief Read data from a file at a given offset
+         * Reads are rare (they only happen when checking the pieces), so they are done
+         * synchronously, after the pending writes have been completed. Any thread may read, even
+         * while another one writes
+         *
+         * @param file_index the index of the file
+         * @param data       the buffer to read the data into
+         * @param offset     the offset in the file to read the data from
+         */
+        void read(size_t file_index, std::span<char> data, size_t offset) override;
+
+        /**
+         * @brief Tell the kernel how a range of a file is going to be accessed
+         *
+         * @param file_index the index of the file
+         * @param offset     the offset of the range in the file
+         * @param length     the length of the range
+         * @param advice     the expected access
+         */
+        void advise(size_t file_index, size_t offset, size_t length, AccessAdvice advice) override {
+            advise_file(fds_[file_index], offset, length, advice);
+        }
+
+        /**
+         * @brief Register the buffer as an io_uring fixed buffer
+         * Buffers that lie inside it are issued as fixed writes, one per buffer, which saves the
+         * kernel from pinning the pages on every write
+         *
+         * @param buffer the memory region
+         * @note Registration may fail (e.g. because of RLIMIT_MEMLOCK), in which case the regular
+         * writes are used
+         */
+        void register_buffer(std::span<std::byte> buffer) override;
+
+    private:
+        struct PendingWrite {
+                size_t             file_index{};
+                std::vector<iovec> iovecs;
+                size_t             size{};
+                size_t             offset{};
+        };
+
+        /**
+         * @brief Prepare a submission queue entry for a pending write
+         *
+         * @param slot the index of the pending write in the pending_writes vector
+         */
+        void prepare_write(uint32_t slot);
+
+        /**
+         * @brief Check if a buffer lies inside the registered fixed buffer
+         *
+         * @param iov the buffer
+         * @return true if a fixed write can be used for the buffer, false otherwise
+         */
+        [[nodiscard]] bool is_in_registered_buffer(const iovec& iov) const {
+            const auto* begin{static_cast<const std::byte*>(iov.iov_base)};
+            return !registered_buffer_.empty() && begin >= registered_buffer_.data() &&
+                   begin + iov.iov_len <= registered_buffer_.data() + registered_buffer_.size();
+        }
+
+        /**
+         * @brief Wait for at least one completion and process all the available ones
+         * Short writes are requeued with the remaining data
+         *
+         * @note The ring must be locked
+         */
+        void reap_completions();
+
+        /**
+         * @brief Wait until every pending write has been completed, without reporting the errors
+         *
+         * @note The ring must be locked
+         */
+        void wait_pending_writes() {
+            while (free_slots_.size() < pending_writes_.size()) {
+                reap_completions();
+            }
+        }
+
+        /**
+         * @brief Tear down the ring and close the files
+         */
+        void release();
+
+        // Guards the ring and the pending writes, since the pieces may be read from other threads
+        // than the one that writes them, e.g. by the hasher threads
+        std::mutex       ring_mutex_;
+        io_uring         ring_{};
+        std::vector<int> fds_;
+        bool             files_registered_{false};
+
+        std::span<std::byte> registered_buffer_;
+
+        // Slots for the writes that have been queued but not completed yet
+        // The slot index is used as the user data of the submission
+        std::vector<PendingWrite> pending_writes_;
+        std::vector<uint32_t>     free_slots_;
+
+        // Number of prepared entries that have not been submitted yet
+        unsigned unsubmitted_{0};
+        // Error code of the first failed write since the last flush
+        int first_error_{0};
+};
+
+}  // namespace torrent::fs
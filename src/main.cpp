@@ -3,6 +3,37 @@
 #include "TorrentClient.hpp"
 
 #include <argparse/argparse.hpp>
+#include <optional>
+#include <string_view>
+
+namespace {
+
+std::optional<torrent::fs::StorageType> parse_storage_type(std::string_view storage) {
+    if (storage == "sync") {
+        return torrent::fs::StorageType::SYNC;
+    } else if (storage == "io_uring") {
+        return torrent::fs::StorageType::IO_URING;
+    } else if (storage == "mmap") {
+        return torrent::fs::StorageType::MMAP;
+    } else {
+        return std::nullopt;
+    }
+}
+
+std::optional<torrent::fs::AllocationPolicy> parse_allocation_policy(std::string_view allocation
+) {
+    if (allocation == "none") {
+        return torrent::fs::AllocationPolicy::NONE;
+    } else if (allocation == "sparse") {
+        return torrent::fs::AllocationPolicy::SPARSE;
+    } else if (allocation == "full") {
+        return torrent::fs::AllocationPolicy::FULL;
+    } else {
+        return std::nullopt;
+    }
+}
+
+}  // namespace
 
 int main(int argc, char** argv) {
     argparse::ArgumentParser arg_parser("cpp-torrent");
@@ -22,6 +53,24 @@ int main(int argc, char** argv) {
         .help("Path to the log file")
         .default_value(std::string("./log.txt"));
 
+    arg_parser.add_argument("-s", "--storage")
+        .help("Storage backend used to write the files (sync, io_uring, mmap)")
+        .default_value(std::string("sync"));
+
+    arg_parser.add_argument("-a", "--allocation")
+        .help("How the space of the files is reserved (none, sparse, full)")
+        .default_value(std::string("sparse"));
+
+    arg_parser.add_argument("-w", "--write-through")
+        .help("Write each block as soon as it is received, and read the pieces back to check them")
+        .default_value(false)
+        .implicit_value(true);
+
+    arg_parser.add_argument("--verify")
+        .help("Check the downloaded files against the piece hashes and exit")
+        .default_value(false)
+        .implicit_value(true);
+
     try {
         arg_parser.parse_args(argc, argv);
     } catch (const std::exception& e) {
@@ -30,6 +79,24 @@ int main(int argc, char** argv) {
         return 1;
     }
 
+    auto storage_type = parse_storage_type(arg_parser.get<std::string>("--storage"));
+
+    if (!storage_type.has_value()) {
+        std::cerr << "Invalid storage backend: " << arg_parser.get<std::string>("--storage")
+                  << std::endl;
+        std::cerr << arg_parser;
+        return 1;
+    }
+
+    auto allocation_policy = parse_allocation_policy(arg_parser.get<std::string>("--allocation"));
+
+    if (!allocation_policy.has_value()) {
+        std::cerr << "Invalid allocation policy: " << arg_parser.get<std::string>("--allocation")
+                  << std::endl;
+        std::cerr << arg_parser;
+        return 1;
+    }
+
     if (arg_parser.get<bool>("--logging")) {
         torrent::logger::init(arg_parser.get<std::string>("--log-file"));
 #ifdef DEBUG
@@ -42,9 +109,18 @@ int main(int argc, char** argv) {
     }
 
     torrent::TorrentClient client(
-        arg_parser.get<std::string>("torrent_file"), arg_parser.get<std::string>("--output-dir")
+        arg_parser.get<std::string>("torrent_file"),
+        arg_parser.get<std::string>("--output-dir"),
+        *storage_type,
+        *allocation_policy,
+        arg_parser.get<bool>("--write-through") ? torrent::PieceBuffering::WRITE_THROUGH
+                                                : torrent::PieceBuffering::MEMORY
     );
 
+    if (arg_parser.get<bool>("--verify")) {
+        return client.verify_files() ? 0 : 1;
+    }
+
     torrent::ui::ProgressBar progress_bar(client);
 
     std::jthread draw_thread([&progress_bar] { progress_bar.start_draw(); });
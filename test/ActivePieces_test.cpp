@@ -0,0 +1,91 @@
+#include "ActivePieces.hpp"
+
+#include "Constant.hpp"
+#include "FixedSizeAllocator.hpp"
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace torrent;
+
+TEST_CASE("ActivePieces: slots", "[ActivePieces]") {
+    static constexpr size_t   pieces_cnt{100};
+    static constexpr size_t   capacity{3};
+    static constexpr uint32_t piece_size{2 * BLOCK_SIZE};
+
+    utils::FixedSizeAllocator<std::byte> block_data_alloc(BLOCK_SIZE, capacity);
+    utils::FixedSizeAllocator<uint16_t>  piece_util_alloc(2 * sizeof(uint16_t), 2 * capacity);
+
+    ActivePieces active_pieces{pieces_cnt, capacity};
+
+    REQUIRE(active_pieces.size() == 0);
+    REQUIRE(active_pieces.find(42) == nullptr);
+
+    auto& piece1{active_pieces.emplace(42, piece_size, block_data_alloc, piece_util_alloc)};
+    auto& piece2{active_pieces.emplace(7, piece_size, block_data_alloc, piece_util_alloc)};
+    active_pieces.emplace(99, piece_size, block_data_alloc, piece_util_alloc);
+
+    REQUIRE(active_pieces.size() == 3);
+    REQUIRE(active_pieces.full());
+    REQUIRE(active_pieces.contains(42));
+    REQUIRE_FALSE(active_pieces.contains(43));
+    REQUIRE(active_pieces.find(42) == &piece1);
+    REQUIRE(active_pieces.find(7) == &piece2);
+
+    // The slot of an erased piece is reused, the other pieces stay where they are
+    active_pieces.erase(42);
+    REQUIRE_FALSE(active_pieces.full());
+    REQUIRE(active_pieces.find(42) == nullptr);
+
+    auto& piece3{active_pieces.emplace(0, piece_size, block_data_alloc, piece_util_alloc)};
+    REQUIRE(&piece3 == &piece1);
+    REQUIRE(active_pieces.find(7) == &piece2);
+
+    std::vector<uint32_t> pieces;
+    active_pieces.for_each([&pieces](uint32_t piece_index, const Piece&) {
+        pieces.push_back(piece_index);
+    });
+    REQUIRE(pieces == std::vector<uint32_t>{0, 7, 99});
+}
+
+TEST_CASE("ActivePieces: block memory", "[ActivePieces]") {
+    static constexpr size_t   pieces_cnt{10};
+    static constexpr size_t   capacity{2};
+    static constexpr uint32_t piece_size{2 * BLOCK_SIZE};
+
+    // Room for 3 blocks only, less than the 2 pieces
+    utils::FixedSizeAllocator<std::byte> block_data_alloc(BLOCK_SIZE, 3);
+    utils::FixedSizeAllocator<uint16_t>  piece_util_alloc(2 * sizeof(uint16_t), 2 * capacity);
+
+    ActivePieces active_pieces{pieces_cnt, capacity};
+
+    // The pieces take no memory until their blocks are requested
+    auto& piece1{active_pieces.emplace(1, piece_size, block_data_alloc, piece_util_alloc)};
+    auto& piece2{active_pieces.emplace(2, piece_size, block_data_alloc, piece_util_alloc)};
+    REQUIRE(block_data_alloc.get_free_count() == 3);
+
+    REQUIRE(piece1.request_next_block(1).has_value());
+    REQUIRE(piece1.request_next_block(1).has_value());
+    REQUIRE(piece2.request_next_block(1).has_value());
+    REQUIRE(block_data_alloc.get_free_count() == 0);
+
+    // No memory is left for the second block of the second piece, and the block is ignored if it
+    // is received without being requested
+    REQUIRE_FALSE(piece2.request_next_block(1).has_value());
+    std::vector<std::byte> block(BLOCK_SIZE, std::byte{0x42});
+    REQUIRE_FALSE(piece2.receive_block(block, BLOCK_SIZE));
+    REQUIRE_FALSE(piece2.is_block_received(1));
+
+    // The received blocks are kept where they were received
+    REQUIRE(piece1.receive_block(block, BLOCK_SIZE));
+    REQUIRE(piece1.is_block_received(1));
+    REQUIRE(std::ranges::equal(piece1.get_block_data(1), block));
+
+    // Erasing a piece gives its blocks back to the pool
+    active_pieces.erase(1);
+    REQUIRE(block_data_alloc.get_free_count() == 2);
+    REQUIRE(piece2.request_next_block(1) == std::make_pair(BLOCK_SIZE, BLOCK_SIZE));
+}
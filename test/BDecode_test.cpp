@@ -212,3 +212,24 @@ TEST_CASE("Bencode: BDecode: Mixt", "[Bencode][BDecode]") {
         }
     }
 }
+
+TEST_CASE("Bencode: BEncode", "[Bencode][BEncode]") {
+    SECTION("Integers and strings") {
+        REQUIRE(BEncode(BencodeItem(BencodeInt{42})) == "i42e");
+        REQUIRE(BEncode(BencodeItem(BencodeInt{-42})) == "i-42e");
+        REQUIRE(BEncode(BencodeItem(BencodeString{"foo"})) == "3:foo");
+        REQUIRE(BEncode(BencodeItem(BencodeString{})) == "0:");
+    }
+
+    SECTION("Dictionary keys are sorted") {
+        BencodeDict dict;
+        dict.emplace("foo", BencodeItem(BencodeInt{1}));
+        dict.emplace("bar", BencodeItem(BencodeList{BencodeItem(BencodeString{"baz"})}));
+        REQUIRE(BEncode(BencodeItem(std::move(dict))) == "d3:barl3:baze3:fooi1ee");
+    }
+
+    SECTION("Round trip") {
+        std::string encoded{"d3:fool3:foo3:bar3:baz3:quxe3:quxi-7e3:zzzd1:a0:ee"};
+        REQUIRE(BEncode(BDecode(encoded)) == encoded);
+    }
+}
@@ -0,0 +1,134 @@
+#include "Bitfield.hpp"
+
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace torrent;
+
+TEST_CASE("Bitfield: set and test", "[Bitfield]") {
+    Bitfield bitfield(130);
+
+    REQUIRE(bitfield.size() == 130);
+    REQUIRE(bitfield.count() == 0);
+
+    bitfield.set(0);
+    bitfield.set(63);
+    bitfield.set(64);
+    bitfield.set(129);
+
+    REQUIRE(bitfield.test(0));
+    REQUIRE_FALSE(bitfield.test(1));
+    REQUIRE(bitfield.test(63));
+    REQUIRE(bitfield.test(64));
+    REQUIRE(bitfield.test(129));
+    REQUIRE(bitfield.count() == 4);
+
+    bitfield.reset(63);
+    REQUIRE_FALSE(bitfield.test(63));
+    REQUIRE(bitfield.count() == 3);
+
+    // The first bit is the most significant bit of the first word
+    REQUIRE(bitfield.get_words()[0] == 1ULL << 63U);
+}
+
+TEST_CASE("Bitfield: from bytes", "[Bitfield]") {
+    static constexpr std::array<std::byte, 2> payload{
+        std::byte{0b1010'0001}, std::byte{0b1100'0000}
+    };
+
+    SECTION("Whole payload") {
+        auto bitfield{Bitfield::from_bytes(payload, 10)};
+        REQUIRE(
+            bitfield == Bitfield{true, false, true, false, false, false, false, true, true, true}
+        );
+    }
+
+    SECTION("Spare bits are cleared") {
+        auto bitfield{Bitfield::from_bytes(payload, 9)};
+        REQUIRE(bitfield == Bitfield{true, false, true, false, false, false, false, true, true});
+        REQUIRE(bitfield.count() == 4);
+    }
+
+    SECTION("Short payload") {
+        auto bitfield{Bitfield::from_bytes(std::span(payload).first(1), 100)};
+        REQUIRE(bitfield.size() == 100);
+        REQUIRE(bitfield.count() == 3);
+        REQUIRE(bitfield.test(7));
+        REQUIRE_FALSE(bitfield.test(8));
+    }
+
+    SECTION("Several words") {
+        std::vector<std::byte> long_payload(20, std::byte{0});
+        long_payload[9]  = std::byte{0b0100'0000};
+        long_payload[19] = std::byte{0b0000'0001};
+
+        auto bitfield{Bitfield::from_bytes(long_payload, 160)};
+        REQUIRE(bitfield.count() == 2);
+        REQUIRE(bitfield.test(73));
+        REQUIRE(bitfield.test(159));
+    }
+}
+
+TEST_CASE("Bitfield: all", "[Bitfield]") {
+    for (size_t size : {1, 63, 64, 65, 128, 200}) {
+        Bitfield bitfield(size);
+        for (size_t i{0}; i < size; ++i) {
+            REQUIRE_FALSE(bitfield.all());
+            bitfield.set(i);
+        }
+        REQUIRE(bitfield.all());
+    }
+
+    REQUIRE(Bitfield().all());
+}
+
+TEST_CASE("Bitfield: and not", "[Bitfield]") {
+    Bitfield peer_bitfield{true, true, false, true, false, true};
+    Bitfield completed{true, false, false, true, true, false};
+
+    REQUIRE(peer_bitfield.and_not(completed) == Bitfield{false, true, false, false, false, true});
+    REQUIRE(peer_bitfield.count_and_not(completed) == 2);
+    REQUIRE(completed.count_and_not(completed) == 0);
+}
+
+TEST_CASE("Bitfield: find next set", "[Bitfield]") {
+    Bitfield bitfield(200);
+    bitfield.set(5);
+    bitfield.set(64);
+    bitfield.set(199);
+
+    REQUIRE(bitfield.find_next_set(0) == 5);
+    REQUIRE(bitfield.find_next_set(5) == 5);
+    REQUIRE(bitfield.find_next_set(6) == 64);
+    REQUIRE(bitfield.find_next_set(65) == 199);
+    REQUIRE(bitfield.find_next_set(200) == 200);
+
+    REQUIRE(Bitfield(100).find_next_set(0) == 100);
+}
+
+TEST_CASE("Bitfield: counters", "[Bitfield]") {
+    // Covers the full words and the last partial word
+    static constexpr size_t bits_cnt{150};
+
+    Bitfield bitfield(bits_cnt);
+    for (size_t i{0}; i < bits_cnt; i += 3) {
+        bitfield.set(i);
+    }
+    bitfield.set(149);
+
+    std::vector<uint16_t> counters(bits_cnt, 1);
+    bitfield.add_to(counters);
+    bitfield.add_to(counters);
+
+    for (size_t i{0}; i < bits_cnt; ++i) {
+        REQUIRE(counters[i] == (bitfield.test(i) ? 3 : 1));
+    }
+
+    bitfield.subtract_from(counters);
+    bitfield.subtract_from(counters);
+
+    REQUIRE(counters == std::vector<uint16_t>(bits_cnt, 1));
+}
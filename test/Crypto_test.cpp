@@ -0,0 +1,102 @@
+#include "Crypto.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+using namespace torrent::crypto;
+
+namespace {
+
+std::vector<uint8_t> make_data(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i{0}; i < size; ++i) {
+        data[i] = static_cast<uint8_t>(i * 31 + seed);
+    }
+    return data;
+}
+
+}  // namespace
+
+TEST_CASE("Sha1: digest_many", "[Crypto]") {
+    auto backend = GENERATE(Sha1Backend::OPENSSL, Sha1Backend::SHA_NI, Sha1Backend::AVX2);
+    if (!Sha1::is_backend_supported(backend)) {
+        return;
+    }
+
+    SECTION("Known hash") {
+        std::string_view                     message{"abc"};
+        std::vector<std::span<const uint8_t>> data{
+            {reinterpret_cast<const uint8_t*>(message.data()), message.size()}
+        };
+        auto digests{Sha1::digest_many(data, backend)};
+
+        static constexpr std::array<uint8_t, SHA1_SIZE> expected{
+            0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+            0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d
+        };
+        REQUIRE(digests.size() == 1);
+        REQUIRE(digests[0] == Sha1::from_raw_data(expected));
+    }
+
+    SECTION("Messages of different sizes") {
+        // Sizes around the padding boundaries, and more messages than the AVX2 lanes
+        static constexpr std::array<size_t, 13> sizes{
+            0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000, 16384, 16401
+        };
+
+        std::vector<std::vector<uint8_t>>     messages;
+        std::vector<std::span<const uint8_t>> data;
+        for (size_t i{0}; i < sizes.size(); ++i) {
+            messages.push_back(make_data(sizes[i], static_cast<uint8_t>(i)));
+        }
+        for (const auto& message : messages) {
+            data.emplace_back(message);
+        }
+
+        auto digests{Sha1::digest_many(data, backend)};
+
+        REQUIRE(digests.size() == data.size());
+        for (size_t i{0}; i < data.size(); ++i) {
+            REQUIRE(digests[i] == Sha1::digest(data[i]));
+        }
+    }
+}
+
+TEST_CASE("Sha1: digest_many benchmark", "[.][benchmark]") {
+    static constexpr size_t pieces_cnt{16};
+    static constexpr size_t piece_size{1U << 18U};
+
+    std::vector<std::vector<uint8_t>>     pieces;
+    std::vector<std::span<const uint8_t>> data;
+    for (size_t i{0}; i < pieces_cnt; ++i) {
+        pieces.push_back(make_data(piece_size, static_cast<uint8_t>(i)));
+    }
+    for (const auto& piece : pieces) {
+        data.emplace_back(piece);
+    }
+
+    BENCHMARK("OpenSSL, one piece at a time") {
+        std::vector<Sha1> digests;
+        for (auto piece : data) {
+            digests.push_back(Sha1::digest(piece));
+        }
+        return digests;
+    };
+
+    if (Sha1::is_backend_supported(Sha1Backend::SHA_NI)) {
+        BENCHMARK("SHA-NI, two pieces at a time") {
+            return Sha1::digest_many(data, Sha1Backend::SHA_NI);
+        };
+    }
+
+    if (Sha1::is_backend_supported(Sha1Backend::AVX2)) {
+        BENCHMARK("AVX2, eight pieces at a time") {
+            return Sha1::digest_many(data, Sha1Backend::AVX2);
+        };
+    }
+}
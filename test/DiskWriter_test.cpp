@@ -0,0 +1,155 @@
+#include "DiskWriter.hpp"
+
+#include <array>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <string>
+
+namespace {
+
+std::string read_from_file(const std::filesystem::path& path, size_t offset, size_t length) {
+    std::ifstream file{path, std::ios::binary | std::ios::in};
+    file.seekg(offset);
+    std::string data;
+    data.resize(length);
+    file.read(data.data(), length);
+    return data;
+}
+
+}  // namespace
+
+TEST_CASE("DiskWriter: write", "[DiskWriter]") {
+    static const std::array<torrent::md::FileInfo, 2> files_info{
+        {{"file1", 0, 10}, {"file2", 10, 20}}
+    };
+
+    auto file_manager{std::make_shared<torrent::fs::FileManager>(files_info)};
+
+    std::string str1(10, 'a');
+    std::string str2(15, 'b');
+    std::string str3(5, 'c');
+
+    std::atomic<size_t> written_jobs{0};
+
+    auto on_complete = [&written_jobs](bool written) {
+        if (written) {
+            written_jobs.fetch_add(1, std::memory_order_relaxed);
+        }
+    };
+
+    {
+        // Use a small queue, so that the submissions have to wait for the disk thread
+        torrent::fs::DiskWriter disk_writer{file_manager, 1};
+
+        disk_writer.submit({.buffers = {str1}, .offset = 0, .on_complete = on_complete});
+        disk_writer.submit({.buffers = {str2}, .offset = 10, .on_complete = on_complete});
+        disk_writer.submit({.buffers = {str3}, .offset = 25, .on_complete = on_complete});
+
+        disk_writer.wait_idle();
+
+        REQUIRE(disk_writer.get_queue_depth() == 0);
+        REQUIRE(written_jobs.load(std::memory_order_relaxed) == 3);
+    }
+
+    file_manager.reset();
+
+    REQUIRE(read_from_file("file1", 0, 10) == str1);
+    REQUIRE(read_from_file("file2", 0, 20) == str2 + str3);
+
+    for (const auto& file : files_info) {
+        std::filesystem::remove(file.path);
+    }
+}
+
+TEST_CASE("DiskWriter: coalesce adjacent writes", "[DiskWriter]") {
+    static const std::array<torrent::md::FileInfo, 2> files_info{
+        {{"file1", 0, 10}, {"file2", 10, 20}}
+    };
+
+    auto file_manager{std::make_shared<torrent::fs::FileManager>(files_info)};
+
+    // Jobs submitted out of order, two of them adjacent, and one that stands alone. The first job
+    // is split in two buffers like the blocks of a piece
+    std::string str1(8, 'a');
+    std::string str2(6, 'b');
+    std::string str3(4, 'c');
+
+    {
+        torrent::fs::DiskWriter disk_writer{file_manager, 16, std::chrono::milliseconds{50}};
+
+        disk_writer.submit({.buffers = {str2}, .offset = 8});
+        disk_writer.submit({.buffers = {str3}, .offset = 20});
+        disk_writer.submit(
+            {.buffers = {std::span(str1).first(3), std::span(str1).subspan(3)}, .offset = 0}
+        );
+
+        disk_writer.wait_idle();
+    }
+
+    file_manager.reset();
+
+    REQUIRE(read_from_file("file1", 0, 10) == str1 + str2.substr(0, 2));
+    REQUIRE(read_from_file("file2", 0, 4) == str2.substr(2));
+    REQUIRE(read_from_file("file2", 10, 4) == str3);
+
+    for (const auto& file : files_info) {
+        std::filesystem::remove(file.path);
+    }
+}
+
+TEST_CASE("DiskWriter: try_submit", "[DiskWriter]") {
+    static const std::array<torrent::md::FileInfo, 1> files_info{{{"file1", 0, 12}}};
+
+    auto file_manager{std::make_shared<torrent::fs::FileManager>(files_info)};
+
+    std::string str1(4, 'a');
+    std::string str2(4, 'b');
+    std::string str3(4, 'c');
+
+    std::promise<void> first_started;
+    std::promise<void> first_released;
+    auto               released{first_released.get_future().share()};
+
+    {
+        torrent::fs::DiskWriter disk_writer{file_manager, 1};
+
+        // Hold the disk thread in the handler of the first job, so the next job stays queued
+        torrent::fs::DiskWriter::WriteJob job1{
+            .buffers     = {str1},
+            .offset      = 0,
+            .on_complete = [&first_started, released](bool) {
+                first_started.set_value();
+                released.wait();
+            }
+        };
+        REQUIRE(disk_writer.try_submit(job1));
+        first_started.get_future().wait();
+
+        torrent::fs::DiskWriter::WriteJob job2{.buffers = {str2}, .offset = 4};
+        REQUIRE(disk_writer.try_submit(job2));
+
+        // The queue is full, so the job is kept by the caller
+        torrent::fs::DiskWriter::WriteJob job3{.buffers = {str3}, .offset = 8};
+        REQUIRE_FALSE(disk_writer.try_submit(job3));
+        REQUIRE(job3.buffers.size() == 1);
+
+        first_released.set_value();
+        disk_writer.wait_idle();
+
+        REQUIRE(disk_writer.try_submit(job3));
+        disk_writer.wait_idle();
+    }
+
+    file_manager.reset();
+
+    REQUIRE(read_from_file("file1", 0, 12) == str1 + str2 + str3);
+
+    for (const auto& file : files_info) {
+        std::filesystem::remove(file.path);
+    }
+}
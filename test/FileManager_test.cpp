@@ -2,8 +2,13 @@
 
 #include <array>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
 #include <filesystem>
+#include <fstream>
+#include <span>
 #include <string>
+#include <string_view>
+#include <sys/stat.h>
 
 namespace {
 
@@ -87,3 +92,171 @@ TEST_CASE("FileManager: write", "[FileManager]") {
         REQUIRE(read_str2 == str2);
     }
 }
+
+TEST_CASE("FileManager: mmap storage", "[FileManager]") {
+    static const std::array<torrent::md::FileInfo, 3> files_info{
+        {{"file1", 0, 10}, {"file2", 10, 20}, {"file3", 30, 30}}
+    };
+
+    std::string str1(20, 'a');
+    size_t      str1_offset{5};
+    std::string str2(25, 'b');
+    size_t      str2_offset{25};
+
+    {
+        torrent::fs::FileManager file_manager{files_info, ".", torrent::fs::StorageType::MMAP};
+        file_manager.write(str1, str1_offset);
+        file_manager.write(str2, str2_offset);
+
+        // The written data is visible through the mapping right away
+        auto file2_view{file_manager.get_view(1)};
+        REQUIRE(file2_view.size() == files_info[1].length);
+        REQUIRE(std::string_view(file2_view.data(), 15) == std::string(15, 'a'));
+
+        // The written pages are visible through the files
+        file_manager.flush();
+        REQUIRE(read_from_file("file1", 5, 5) == str1.substr(0, 5));
+    }
+
+    // The files are created at their final length, with their blocks reserved
+    for (const auto& file_info : files_info) {
+        REQUIRE(std::filesystem::file_size(file_info.path) == file_info.length);
+
+        struct stat file_stat {};
+        REQUIRE(::stat(file_info.path.c_str(), &file_stat) == 0);
+        REQUIRE(static_cast<size_t>(file_stat.st_blocks) * 512 >= file_info.length);
+    }
+
+    REQUIRE(read_from_file("file1", 5, 5) + read_from_file("file2", 0, 15) == str1);
+    REQUIRE(read_from_file("file2", 15, 5) + read_from_file("file3", 0, 20) == str2);
+
+    for (const auto& file_info : files_info) {
+        std::filesystem::remove(file_info.path);
+    }
+}
+
+TEST_CASE("FileManager: vectored write", "[FileManager]") {
+    static const std::array<torrent::md::FileInfo, 3> files_info{
+        {{"file1", 0, 10}, {"file2", 10, 20}, {"file3", 30, 30}}
+    };
+
+    std::string str1(8, 'a');
+    std::string str2(15, 'b');
+    std::string str3(12, 'c');
+
+    std::array<std::span<const char>, 3> buffers{str1, str2, str3};
+    size_t                               offset{5};
+
+    {
+        torrent::fs::FileManager file_manager{files_info};
+        file_manager.writev(buffers, offset);
+    }
+
+    std::string read_str{
+        read_from_file("file1", 5, 5) + read_from_file("file2", 0, 20) +
+        read_from_file("file3", 0, 10)
+    };
+
+    REQUIRE(read_str == str1 + str2 + str3);
+
+    for (const auto& file_info : files_info) {
+        std::filesystem::remove(file_info.path);
+    }
+}
+
+TEST_CASE("FileManager: allocation policies", "[FileManager]") {
+    static const std::array<torrent::md::FileInfo, 3> files_info{
+        {{"dir/file1", 0, 10}, {"dir/file2", 10, 20}, {"dir/file3", 30, 30}}
+    };
+
+    using torrent::fs::AllocationPolicy;
+
+    SECTION("No allocation") {
+        torrent::fs::FileManager file_manager{
+            files_info, ".", torrent::fs::StorageType::SYNC, AllocationPolicy::NONE
+        };
+
+        for (const auto& file_info : files_info) {
+            REQUIRE(std::filesystem::file_size(file_info.path) == 0);
+        }
+    }
+
+    SECTION("Sparse and full allocation") {
+        auto policy = GENERATE(AllocationPolicy::SPARSE, AllocationPolicy::FULL);
+
+        std::string str(20, 'a');
+
+        {
+            torrent::fs::FileManager file_manager{
+                files_info, ".", torrent::fs::StorageType::SYNC, policy
+            };
+
+            for (const auto& file_info : files_info) {
+                REQUIRE(std::filesystem::file_size(file_info.path) == file_info.length);
+            }
+
+            file_manager.write(str, 35);
+        }
+
+        // Writing does not change the size of the allocated files
+        for (const auto& file_info : files_info) {
+            REQUIRE(std::filesystem::file_size(file_info.path) == file_info.length);
+        }
+        REQUIRE(read_from_file("dir/file3", 5, 20) == str);
+    }
+
+    std::filesystem::remove_all("dir");
+}
+
+TEST_CASE("FileManager: read", "[FileManager]") {
+    static const std::array<torrent::md::FileInfo, 3> files_info{
+        {{"dir/file1", 0, 10}, {"dir/file2", 10, 20}, {"dir/file3", 30, 30}}
+    };
+
+    std::string str(30, 'a');
+    size_t      offset{5};
+
+    {
+        torrent::fs::FileManager file_manager{files_info};
+        file_manager.write(str, offset);
+        file_manager.flush();
+
+        std::string read_str(str.size(), '\0');
+        file_manager.read(read_str, offset);
+        REQUIRE(read_str == str);
+
+        // The part that was never written reads as zeros
+        std::string tail_str(10, 'x');
+        file_manager.read(tail_str, 50);
+        REQUIRE(tail_str == std::string(10, '\0'));
+    }
+
+    SECTION("Keep the existing content") {
+        torrent::fs::FileManager file_manager{
+            files_info,
+            ".",
+            torrent::fs::StorageType::SYNC,
+            torrent::fs::AllocationPolicy::SPARSE,
+            true
+        };
+
+        std::string read_str(str.size(), '\0');
+        file_manager.read(read_str, offset);
+        REQUIRE(read_str == str);
+    }
+
+    SECTION("Discard the existing content") {
+        torrent::fs::FileManager file_manager{
+            files_info,
+            ".",
+            torrent::fs::StorageType::SYNC,
+            torrent::fs::AllocationPolicy::NONE
+        };
+
+        for (const auto& file_info : files_info) {
+            REQUIRE(std::filesystem::file_size(file_info.path) == 0);
+        }
+    }
+
+    std::filesystem::remove_all("dir");
+}
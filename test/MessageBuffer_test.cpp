@@ -0,0 +1,174 @@
+#include "MessageBuffer.hpp"
+
+#include "Constant.hpp"
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+using namespace torrent;
+using namespace torrent::message;
+
+namespace {
+
+// Append a message in the wire format
+void append_message(std::vector<std::byte>& bytes, uint32_t length, MessageType id) {
+    for (int shift{24}; shift >= 0; shift -= 8) {
+        bytes.push_back(static_cast<std::byte>(length >> shift));
+    }
+    if (length == 0) {
+        return;
+    }
+    bytes.push_back(static_cast<std::byte>(id));
+    for (uint32_t i{1}; i < length; ++i) {
+        bytes.push_back(static_cast<std::byte>(i));
+    }
+}
+
+// A parsed message, without its payload which is invalidated by the next receive. A keep-alive
+// has no id
+struct ParsedMessage {
+        std::optional<MessageType> id;
+        std::optional<size_t>      payload_size;
+};
+
+// Receive the bytes in chunks of a given size, and collect the messages parsed after each one
+std::vector<ParsedMessage> receive(
+    MessageBuffer& buffer, const std::vector<std::byte>& bytes, size_t chunk_size
+) {
+    std::vector<ParsedMessage> messages;
+    for (size_t pos{0}; pos < bytes.size();) {
+        auto space{buffer.prepare()};
+        auto count{std::min({chunk_size, space.size(), bytes.size() - pos})};
+        std::copy_n(bytes.begin() + static_cast<ptrdiff_t>(pos), count, space.begin());
+        buffer.commit(count);
+        pos += count;
+        for (auto msg{buffer.next_message()}; msg.has_value(); msg = buffer.next_message()) {
+            if (!msg->has_value()) {
+                messages.push_back({std::nullopt, std::nullopt});
+                continue;
+            }
+            messages.push_back(
+                {(*msg)->id,
+                 (*msg)->payload.transform([](auto payload) { return payload.size(); })}
+            );
+        }
+    }
+    return messages;
+}
+
+}  // namespace
+
+TEST_CASE("MessageBuffer: parse messages", "[MessageBuffer]") {
+    static constexpr uint32_t piece_length{9 + BLOCK_SIZE};
+
+    std::vector<std::byte> bytes;
+    append_message(bytes, 1, MessageType::UNCHOKE);
+    append_message(bytes, 0, MessageType::KEEP_ALIVE);
+    append_message(bytes, 5, MessageType::HAVE);
+    for (int i{0}; i < 20; ++i) {
+        append_message(bytes, piece_length, MessageType::PIECE);
+    }
+
+    auto chunk_size{GENERATE(1uz, 7uz, 1000uz, 1uz << 20U)};
+
+    MessageBuffer buffer{8 + BLOCK_SIZE};
+    auto          messages{receive(buffer, bytes, chunk_size)};
+
+    REQUIRE(messages.size() == 23);
+    REQUIRE(messages[0].id == MessageType::UNCHOKE);
+    REQUIRE_FALSE(messages[0].payload_size.has_value());
+    REQUIRE_FALSE(messages[1].id.has_value());
+    REQUIRE(messages[2].id == MessageType::HAVE);
+    REQUIRE(messages[2].payload_size == 4);
+    for (size_t i{3}; i < messages.size(); ++i) {
+        REQUIRE(messages[i].id == MessageType::PIECE);
+        REQUIRE(messages[i].payload_size == piece_length - 1);
+    }
+    REQUIRE(buffer.size() == 0);
+}
+
+TEST_CASE("MessageBuffer: payload in place", "[MessageBuffer]") {
+    std::vector<std::byte> bytes;
+    append_message(bytes, 4, MessageType::HAVE);
+
+    MessageBuffer buffer{8 + BLOCK_SIZE};
+    auto          space{buffer.prepare()};
+    std::ranges::copy(bytes, space.begin());
+    buffer.commit(bytes.size());
+
+    auto msg{buffer.next_message()};
+    REQUIRE(msg.has_value());
+    REQUIRE(msg->has_value());
+    REQUIRE((*msg)->payload->data() == space.data() + 5);
+    REQUIRE(std::ranges::equal(
+        *(*msg)->payload, std::vector<std::byte>{std::byte{1}, std::byte{2}, std::byte{3}}
+    ));
+}
+
+TEST_CASE("MessageBuffer: unknown message ids", "[MessageBuffer]") {
+    // Ids past the known messages are handed over as they are, whatever their value
+    std::vector<std::byte> bytes;
+    for (uint8_t id{10}; id < 14; ++id) {
+        append_message(bytes, 3, static_cast<MessageType>(id));
+    }
+
+    MessageBuffer buffer{8 + BLOCK_SIZE};
+    auto          messages{receive(buffer, bytes, bytes.size())};
+
+    REQUIRE(messages.size() == 4);
+    for (uint8_t id{10}; id < 14; ++id) {
+        REQUIRE(messages[id - 10].id == static_cast<MessageType>(id));
+        REQUIRE(messages[id - 10].payload_size == 2);
+    }
+}
+
+TEST_CASE("MessageBuffer: oversized message", "[MessageBuffer]") {
+    std::vector<std::byte> bytes;
+    append_message(bytes, 10 + BLOCK_SIZE, MessageType::PIECE);
+
+    MessageBuffer buffer{8 + BLOCK_SIZE};
+    auto          space{buffer.prepare()};
+    std::copy_n(bytes.begin(), 5, space.begin());
+    buffer.commit(5);
+
+    auto msg{buffer.next_message()};
+    REQUIRE_FALSE(msg.has_value());
+    REQUIRE(msg.error() == ParseError::OVERSIZED);
+}
+
+TEST_CASE("MessageBuffer: partial block", "[MessageBuffer]") {
+    std::vector<std::byte> bytes;
+    append_message(bytes, 1, MessageType::UNCHOKE);
+    append_message(bytes, 9 + BLOCK_SIZE, MessageType::PIECE);
+
+    MessageBuffer buffer{8 + BLOCK_SIZE};
+    auto          space{buffer.prepare()};
+
+    // The header of the piece message is not complete yet
+    std::copy_n(bytes.begin(), 5 + 12, space.begin());
+    buffer.commit(5 + 12);
+    REQUIRE((*buffer.next_message())->id == MessageType::UNCHOKE);
+    REQUIRE(buffer.next_message().error() == ParseError::INCOMPLETE);
+    REQUIRE_FALSE(buffer.partial_block().has_value());
+
+    std::copy_n(bytes.begin() + 5 + 12, 100, space.begin() + 5 + 12);
+    buffer.commit(100);
+    REQUIRE(buffer.next_message().error() == ParseError::INCOMPLETE);
+
+    // The bytes appended by append_message give the piece index and the offset
+    auto block{buffer.partial_block()};
+    REQUIRE(block.has_value());
+    REQUIRE(block->piece_index == 0x01020304);
+    REQUIRE(block->offset == 0x05060708);
+    REQUIRE(block->size == BLOCK_SIZE);
+    REQUIRE(block->received.size() == 99);
+    REQUIRE(block->received.front() == std::byte{9});
+
+    buffer.consume_partial_block();
+    REQUIRE(buffer.size() == 0);
+}
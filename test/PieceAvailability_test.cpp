@@ -0,0 +1,184 @@
+#include "PieceAvailability.hpp"
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <vector>
+
+using namespace torrent;
+
+namespace {
+
+// Check that the pieces are ordered by availability
+bool is_rarest_first(const PieceAvailability& piece_avail) {
+    return std::ranges::is_sorted(piece_avail.get_rarest_first(), {}, [&](uint32_t piece_index) {
+        return piece_avail.get_availability(piece_index);
+    });
+}
+
+}  // namespace
+
+TEST_CASE("PieceAvailability: rarest first", "[PieceAvailability]") {
+    static constexpr size_t pieces_cnt{8};
+
+    PieceAvailability piece_avail{pieces_cnt, 42};
+
+    static const Bitfield peer1_bitfield{true, true, true, true, true, true, true, false};
+    static const Bitfield peer2_bitfield{true, false, true, false, true, false, true, false};
+    static const Bitfield peer3_bitfield{true, false, false, true, true, false, false, false};
+
+    piece_avail.add_bitfield(peer1_bitfield);
+    piece_avail.add_bitfield(peer2_bitfield);
+    piece_avail.add_bitfield(peer3_bitfield);
+
+    SECTION("Bitfields") {
+        REQUIRE(is_rarest_first(piece_avail));
+        REQUIRE(piece_avail.get_rarest_first().front() == 7);
+        REQUIRE(piece_avail.get_availability(0) == 3);
+        REQUIRE(piece_avail.get_availability(4) == 3);
+        REQUIRE(piece_avail.get_availability(7) == 0);
+    }
+
+    SECTION("Have messages") {
+        // Piece 7 becomes the most available piece
+        for (int i{0}; i < 4; ++i) {
+            piece_avail.increment(7);
+            REQUIRE(is_rarest_first(piece_avail));
+        }
+        REQUIRE(piece_avail.get_availability(7) == 4);
+        REQUIRE(piece_avail.get_rarest_first().back() == 7);
+    }
+
+    SECTION("Peer leaving") {
+        piece_avail.remove_bitfield(peer1_bitfield);
+        REQUIRE(is_rarest_first(piece_avail));
+        REQUIRE(piece_avail.get_availability(0) == 2);
+        REQUIRE(piece_avail.get_availability(1) == 0);
+
+        piece_avail.remove_bitfield(peer2_bitfield);
+        piece_avail.remove_bitfield(peer3_bitfield);
+        REQUIRE(is_rarest_first(piece_avail));
+        for (uint32_t piece_index{0}; piece_index < pieces_cnt; ++piece_index) {
+            REQUIRE(piece_avail.get_availability(piece_index) == 0);
+        }
+    }
+
+    // Every piece is still listed exactly once
+    auto pieces{std::vector<uint32_t>(
+        piece_avail.get_rarest_first().begin(), piece_avail.get_rarest_first().end()
+    )};
+    std::ranges::sort(pieces);
+    REQUIRE(pieces == std::vector<uint32_t>{0, 1, 2, 3, 4, 5, 6, 7});
+}
+
+TEST_CASE("PieceAvailability: random ties", "[PieceAvailability]") {
+    static constexpr size_t pieces_cnt{64};
+
+    // Different seeds give different orders of the equally available pieces
+    PieceAvailability piece_avail1{pieces_cnt, 1};
+    PieceAvailability piece_avail2{pieces_cnt, 2};
+
+    REQUIRE_FALSE(std::ranges::equal(
+        piece_avail1.get_rarest_first(), piece_avail2.get_rarest_first()
+    ));
+}
+
+TEST_CASE("PieceAvailability: sparse and dense bitfields", "[PieceAvailability]") {
+    static constexpr size_t pieces_cnt{200};
+
+    PieceAvailability piece_avail{pieces_cnt, 42};
+
+    // Counted piece by piece
+    Bitfield sparse_bitfield(pieces_cnt);
+    sparse_bitfield.set(3);
+    sparse_bitfield.set(130);
+    sparse_bitfield.set(199);
+
+    // Counted all at once
+    Bitfield dense_bitfield(pieces_cnt);
+    for (uint32_t piece_index{0}; piece_index < pieces_cnt; piece_index += 2) {
+        dense_bitfield.set(piece_index);
+    }
+
+    piece_avail.add_bitfield(sparse_bitfield);
+    piece_avail.add_bitfield(dense_bitfield);
+    piece_avail.add_bitfield(sparse_bitfield);
+
+    REQUIRE(is_rarest_first(piece_avail));
+    REQUIRE(piece_avail.get_availability(3) == 2);
+    REQUIRE(piece_avail.get_availability(130) == 3);
+    REQUIRE(piece_avail.get_availability(198) == 1);
+    REQUIRE(piece_avail.get_availability(1) == 0);
+
+    // The pieces moved one by one after a rebuild are still in their buckets
+    piece_avail.increment(1);
+    piece_avail.increment(1);
+    piece_avail.increment(1);
+    piece_avail.increment(1);
+    REQUIRE(is_rarest_first(piece_avail));
+    REQUIRE(piece_avail.get_rarest_first().back() == 1);
+
+    piece_avail.remove_bitfield(dense_bitfield);
+    piece_avail.remove_bitfield(sparse_bitfield);
+    REQUIRE(is_rarest_first(piece_avail));
+    REQUIRE(piece_avail.get_availability(130) == 1);
+    REQUIRE(piece_avail.get_availability(198) == 0);
+
+    auto pieces{std::vector<uint32_t>(
+        piece_avail.get_rarest_first().begin(), piece_avail.get_rarest_first().end()
+    )};
+    std::ranges::sort(pieces);
+    for (uint32_t piece_index{0}; piece_index < pieces_cnt; ++piece_index) {
+        REQUIRE(pieces[piece_index] == piece_index);
+    }
+}
+
+TEST_CASE("PieceAvailability: order version", "[PieceAvailability]") {
+    static constexpr size_t pieces_cnt{8};
+
+    PieceAvailability piece_avail{pieces_cnt, 42};
+
+    // A have message only swaps two pieces, so the positions in the order are still valid
+    auto version{piece_avail.get_order_version()};
+    piece_avail.increment(3);
+    piece_avail.increment(5);
+    piece_avail.decrement(3);
+    REQUIRE(piece_avail.get_order_version() == version);
+    REQUIRE(is_rarest_first(piece_avail));
+    for (uint32_t pos{0}; pos < pieces_cnt; ++pos) {
+        REQUIRE(piece_avail.get_rank(piece_avail.get_rarest_first()[pos]) == pos);
+    }
+
+    // A dense bitfield rebuilds the buckets
+    piece_avail.add_bitfield(Bitfield{true, true, true, true, true, true, false, false});
+    REQUIRE(piece_avail.get_order_version() != version);
+    for (uint32_t pos{0}; pos < pieces_cnt; ++pos) {
+        REQUIRE(piece_avail.get_rank(piece_avail.get_rarest_first()[pos]) == pos);
+    }
+}
+
+TEST_CASE("PieceAvailability: seeds", "[PieceAvailability]") {
+    static constexpr size_t pieces_cnt{8};
+
+    PieceAvailability piece_avail{pieces_cnt, 42};
+
+    piece_avail.add_bitfield(Bitfield{true, false, true, false, false, false, false, false});
+
+    std::vector<uint32_t> pieces_before(
+        piece_avail.get_rarest_first().begin(), piece_avail.get_rarest_first().end()
+    );
+
+    piece_avail.add_seed();
+    piece_avail.add_seed();
+
+    // The seeds count for every piece without moving any of them
+    REQUIRE(piece_avail.get_seed_count() == 2);
+    REQUIRE(piece_avail.get_availability(0) == 3);
+    REQUIRE(piece_avail.get_availability(1) == 2);
+    REQUIRE(std::ranges::equal(piece_avail.get_rarest_first(), pieces_before));
+
+    piece_avail.remove_seed();
+    REQUIRE(piece_avail.get_seed_count() == 1);
+    REQUIRE(piece_avail.get_availability(2) == 2);
+    REQUIRE(std::ranges::equal(piece_avail.get_rarest_first(), pieces_before));
+}
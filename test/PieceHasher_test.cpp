@@ -0,0 +1,84 @@
+#include "PieceHasher.hpp"
+
+#include "Crypto.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+
+TEST_CASE("PieceHasher: hash", "[PieceHasher]") {
+    std::string valid_data(1000, 'a');
+    std::string invalid_data(1000, 'b');
+
+    auto expected_hash{torrent::crypto::Sha1::digest(
+        reinterpret_cast<const uint8_t*>(valid_data.data()), valid_data.size()
+    )};
+
+    std::atomic<size_t> valid_jobs{0};
+    std::atomic<size_t> invalid_jobs{0};
+
+    auto on_complete = [&valid_jobs, &invalid_jobs](bool valid) {
+        (valid ? valid_jobs : invalid_jobs).fetch_add(1, std::memory_order_relaxed);
+    };
+
+    {
+        torrent::crypto::PieceHasher hasher{2};
+
+        for (size_t i{0}; i < 10; ++i) {
+            const auto& data{i % 3 == 0 ? invalid_data : valid_data};
+            hasher.submit(
+                {.buffers       = {std::as_bytes(std::span(data))},
+                 .expected_hash = expected_hash,
+                 .on_complete   = on_complete}
+            );
+        }
+
+        hasher.wait_idle();
+
+        REQUIRE(hasher.get_queue_depth() == 0);
+        REQUIRE(valid_jobs.load(std::memory_order_relaxed) == 6);
+        REQUIRE(invalid_jobs.load(std::memory_order_relaxed) == 4);
+
+        // Jobs still queued when the hasher is destroyed are hashed before the threads stop
+        hasher.submit(
+            {.buffers       = {std::as_bytes(std::span(valid_data))},
+             .expected_hash = expected_hash,
+             .on_complete   = on_complete}
+        );
+    }
+
+    REQUIRE(valid_jobs.load(std::memory_order_relaxed) == 7);
+}
+
+TEST_CASE("PieceHasher: finish an incremental hash", "[PieceHasher]") {
+    std::string data(1000, '\0');
+    std::ranges::generate(data, [c = 0]() mutable { return static_cast<char>(c++ % 128); });
+
+    auto bytes{std::as_bytes(std::span(data))};
+    auto expected_hash{torrent::crypto::Sha1::digest(
+        reinterpret_cast<const uint8_t*>(data.data()), data.size()
+    )};
+
+    // Hash the first part of the data up front, and let the hasher hash the rest, split in two
+    // buffers like the blocks of a piece
+    torrent::crypto::Sha1Context context;
+    context.update(std::span(reinterpret_cast<const uint8_t*>(data.data()), 600));
+
+    bool matched{false};
+    {
+        torrent::crypto::PieceHasher hasher{1};
+        hasher.submit(
+            {.buffers       = {bytes.subspan(600, 100), bytes.subspan(700)},
+             .context       = std::move(context),
+             .expected_hash = expected_hash,
+             .on_complete   = [&matched](bool valid) { matched = valid; }}
+        );
+        hasher.wait_idle();
+    }
+
+    REQUIRE(matched);
+}
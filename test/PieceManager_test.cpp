@@ -1,13 +1,17 @@
 #include "PieceManager.hpp"
 
+#include <algorithm>
 #include <array>
 #include <catch2/catch_test_macros.hpp>
 #include <cstddef>
 #include <filesystem>
+#include <fstream>
 #include <memory>
 #include <ranges>
 #include <string>
 #include <thread>
+#include <tuple>
+#include <vector>
 
 using namespace torrent;
 using namespace std::literals::chrono_literals;
@@ -37,7 +41,10 @@ TEST_CASE("PieceManager: Single Piece", "[PieceManager]") {
          {"file2", BLOCK_SIZE, 2 * BLOCK_SIZE},
          {"file3", 3 * BLOCK_SIZE, 5 * BLOCK_SIZE / 2}}
     };
-    std::shared_ptr<fs::FileManager> file_manager = std::make_shared<fs::FileManager>(files_info);
+    // The files are not allocated, so they stay empty until the piece is written
+    std::shared_ptr<fs::FileManager> file_manager = std::make_shared<fs::FileManager>(
+        files_info, ".", fs::StorageType::SYNC, fs::AllocationPolicy::NONE
+    );
 
     std::string s1(BLOCK_SIZE, 'a');
     std::string s2{std::string(BLOCK_SIZE, 'b') + std::string(BLOCK_SIZE, 'c')};
@@ -58,18 +65,10 @@ TEST_CASE("PieceManager: Single Piece", "[PieceManager]") {
         piece_data.size(), piece_data.size(), file_manager, piece_hash.get(), request_timeout
     );
 
-    static const std::vector<bool> peer1_bitfield{
-        true, false, false, false, false, false, false, false
-    };
-    static const std::vector<bool> peer2_bitfield{
-        false, false, false, false, false, false, false, false
-    };
-    static const std::vector<bool> peer3_bitfield{
-        true, false, false, false, false, false, false, false
-    };
-    static const std::vector<bool> peer4_bitfield{
-        true, false, false, false, false, false, false, false
-    };
+    static const Bitfield peer1_bitfield{true};
+    static const Bitfield peer2_bitfield{false};
+    static const Bitfield peer3_bitfield{true};
+    static const Bitfield peer4_bitfield{true};
 
     piece_manager.add_peer_bitfield(peer1_bitfield);
     piece_manager.add_peer_bitfield(peer2_bitfield);
@@ -108,6 +107,7 @@ TEST_CASE("PieceManager: Single Piece", "[PieceManager]") {
         // Get same block after timeout
         {
             std::this_thread::sleep_for(request_timeout);
+            piece_manager.tick(std::chrono::steady_clock::now());
             block = piece_manager.request_next_block(peer1_bitfield);
 
             REQUIRE(block.has_value());
@@ -169,6 +169,8 @@ TEST_CASE("PieceManager: Single Piece", "[PieceManager]") {
             0, std::span(reinterpret_cast<const std::byte*>(block1.data()), BLOCK_SIZE), 0
         );
 
+        piece_manager.wait_pending_writes();
+
         std::string result_str{
             read_from_file(files_info[0].path, 0, BLOCK_SIZE) +
             read_from_file(files_info[1].path, 0, 2 * BLOCK_SIZE) +
@@ -225,6 +227,7 @@ TEST_CASE("PieceManager: Single Piece", "[PieceManager]") {
 
         // let block4 timeout
         std::this_thread::sleep_for(request_timeout);
+        piece_manager.tick(std::chrono::steady_clock::now());
 
         // Send block4
         block = piece_manager.request_next_block(peer1_bitfield);
@@ -234,6 +237,8 @@ TEST_CASE("PieceManager: Single Piece", "[PieceManager]") {
             3 * BLOCK_SIZE
         );
 
+        piece_manager.wait_pending_writes();
+
         // Check if the piece has been completed correctly
         std::string result_str{
             read_from_file(files_info[0].path, 0, BLOCK_SIZE) +
@@ -244,6 +249,139 @@ TEST_CASE("PieceManager: Single Piece", "[PieceManager]") {
         REQUIRE(result_str == piece_data);
     }
 
+    SECTION("Per-request timeouts") {
+        std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> blocks;
+        PieceManager::RequestCursor                           cursor;
+
+        // A fast peer and a slow peer, each with its own timeout
+        REQUIRE(piece_manager.request_next_blocks(peer1_bitfield, 1, blocks, cursor, 1ms) == 1);
+        REQUIRE(piece_manager.request_next_blocks(peer3_bitfield, 5, blocks, cursor, 1h) == 5);
+        REQUIRE_FALSE(piece_manager.request_next_block(peer1_bitfield).has_value());
+
+        // Only the block of the fast peer timed out
+        std::this_thread::sleep_for(request_timeout);
+        piece_manager.tick(std::chrono::steady_clock::now());
+
+        auto block{piece_manager.request_next_block(peer1_bitfield)};
+        REQUIRE(block.has_value());
+        REQUIRE(*block == blocks.front());
+        REQUIRE_FALSE(piece_manager.request_next_block(peer1_bitfield).has_value());
+    }
+
+    SECTION("Return blocks") {
+        auto deadline{piece_manager.get_deadline_tick(request_timeout)};
+        for (int i{0}; i < 6; ++i) {
+            REQUIRE(piece_manager.request_next_block(peer1_bitfield).has_value());
+        }
+        REQUIRE_FALSE(piece_manager.request_next_block(peer1_bitfield).has_value());
+
+        // A returned block is requested again right away, without waiting for its timeout
+        piece_manager.return_block(0, 4 * BLOCK_SIZE, deadline);
+        auto block{piece_manager.request_next_block(peer1_bitfield)};
+        REQUIRE(block.has_value());
+        REQUIRE(*block == std::make_tuple(0U, 4 * BLOCK_SIZE, BLOCK_SIZE));
+
+        // Received and reserved blocks are not handed back
+        std::string block1(BLOCK_SIZE, 'a');
+        piece_manager.receive_block(
+            0, std::span(reinterpret_cast<const std::byte*>(block1.data()), BLOCK_SIZE), 0
+        );
+        piece_manager.return_block(0, 0, deadline);
+        REQUIRE(piece_manager.reserve_block(0, BLOCK_SIZE, BLOCK_SIZE).has_value());
+        piece_manager.return_block(0, BLOCK_SIZE, deadline);
+        REQUIRE_FALSE(piece_manager.request_next_block(peer1_bitfield).has_value());
+
+        // A block handed back twice is requested again once
+        piece_manager.return_block(0, 2 * BLOCK_SIZE, deadline);
+        piece_manager.return_block(0, 2 * BLOCK_SIZE, deadline);
+        REQUIRE(piece_manager.request_next_block(peer1_bitfield).has_value());
+        REQUIRE_FALSE(piece_manager.request_next_block(peer1_bitfield).has_value());
+        piece_manager.release_block(0, BLOCK_SIZE);
+    }
+
+    SECTION("Return a block requested again by another peer") {
+        std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> blocks;
+        PieceManager::RequestCursor                           cursor1;
+        PieceManager::RequestCursor                           cursor2;
+
+        auto deadline1{piece_manager.get_deadline_tick(1ms)};
+        REQUIRE(piece_manager.request_next_blocks(peer1_bitfield, 6, blocks, cursor1, 1ms) == 6);
+
+        // The requests of the first peer time out, and the blocks go to the second peer
+        std::this_thread::sleep_for(request_timeout);
+        piece_manager.tick(std::chrono::steady_clock::now());
+        REQUIRE(piece_manager.request_next_blocks(peer1_bitfield, 6, blocks, cursor2, 1h) == 6);
+
+        // The first peer handing back its stale requests leaves the new ones alone
+        for (size_t i{0}; i < 6; ++i) {
+            piece_manager.return_block(0, std::get<1>(blocks[i]), deadline1);
+        }
+        REQUIRE_FALSE(piece_manager.request_next_block(peer1_bitfield).has_value());
+    }
+
+    SECTION("Receive blocks in place") {
+        auto* piece_bytes{reinterpret_cast<const std::byte*>(piece_data.data())};
+
+        for (int i{0}; i < 6; ++i) {
+            REQUIRE(piece_manager.request_next_block(peer1_bitfield).has_value());
+        }
+
+        // Blocks that do not fit in the piece are not reserved
+        REQUIRE_FALSE(piece_manager.reserve_block(0, BLOCK_SIZE / 2, BLOCK_SIZE).has_value());
+        REQUIRE_FALSE(piece_manager.reserve_block(0, 5 * BLOCK_SIZE, BLOCK_SIZE).has_value());
+        REQUIRE_FALSE(piece_manager.reserve_block(1, 0, BLOCK_SIZE).has_value());
+
+        auto block_data{piece_manager.reserve_block(0, 0, BLOCK_SIZE)};
+        REQUIRE(block_data.has_value());
+        REQUIRE(block_data->size() == BLOCK_SIZE);
+
+        // A block being received in place is ignored when it comes from another peer
+        REQUIRE_FALSE(piece_manager.reserve_block(0, 0, BLOCK_SIZE).has_value());
+        std::string other_block(BLOCK_SIZE, 'z');
+        piece_manager.receive_block(
+            0, std::span(reinterpret_cast<const std::byte*>(other_block.data()), BLOCK_SIZE), 0
+        );
+        REQUIRE_FALSE(piece_manager.is_block_received(0, 0));
+
+        std::copy_n(piece_bytes, BLOCK_SIZE, block_data->begin());
+        piece_manager.commit_block(0, 0);
+        REQUIRE(piece_manager.is_block_received(0, 0));
+
+        // A released block is requested again
+        REQUIRE(piece_manager.reserve_block(0, 3 * BLOCK_SIZE, BLOCK_SIZE).has_value());
+        piece_manager.release_block(0, 3 * BLOCK_SIZE);
+        auto block{piece_manager.request_next_block(peer1_bitfield)};
+        REQUIRE(block.has_value());
+        REQUIRE(*block == std::make_tuple(0U, 3 * BLOCK_SIZE, BLOCK_SIZE));
+
+        for (uint32_t i{1}; i < 6; ++i) {
+            auto size{i == 5 ? BLOCK_SIZE / 2 : BLOCK_SIZE};
+            block_data = piece_manager.reserve_block(0, i * BLOCK_SIZE, size);
+            REQUIRE(block_data.has_value());
+            std::copy_n(piece_bytes + i * BLOCK_SIZE, size, block_data->begin());
+            piece_manager.commit_block(0, i * BLOCK_SIZE);
+        }
+
+        piece_manager.wait_pending_writes();
+
+        std::string result_str{
+            read_from_file(files_info[0].path, 0, BLOCK_SIZE) +
+            read_from_file(files_info[1].path, 0, 2 * BLOCK_SIZE) +
+            read_from_file(files_info[2].path, 0, 5 * BLOCK_SIZE / 2)
+        };
+
+        REQUIRE(result_str == piece_data);
+    }
+
+    SECTION("Restore completed piece") {
+        piece_manager.restore_completed_pieces({true});
+
+        REQUIRE(piece_manager.completed());
+        REQUIRE(piece_manager.completed_thread_safe());
+        REQUIRE(piece_manager.get_downloaded_bytes() == piece_data.size());
+        REQUIRE_FALSE(piece_manager.request_next_block(peer1_bitfield).has_value());
+    }
+
     // Remove the files
     for (const auto& file : files_info) {
         std::filesystem::remove(file.path);
@@ -304,19 +442,11 @@ TEST_CASE("PieceManager: Multiple Pieces", "[PieceManager]") {
         request_timeout
     );
 
-    static const std::vector<bool> peer1_bitfield{true, true, true, true, true, true, false, false};
-    static const std::vector<bool> peer2_bitfield{
-        false, false, false, false, false, false, false, false
-    };
-    static const std::vector<bool> peer3_bitfield{
-        true, false, false, false, false, true, false, false
-    };
-    static const std::vector<bool> peer4_bitfield{
-        false, false, true, true, false, false, false, false
-    };
-    static const std::vector<bool> peer5_bitfield{
-        false, true, false, true, false, true, false, false
-    };
+    static const Bitfield peer1_bitfield{true, true, true, true, true, true};
+    static const Bitfield peer2_bitfield{false, false, false, false, false, false};
+    static const Bitfield peer3_bitfield{true, false, false, false, false, true};
+    static const Bitfield peer4_bitfield{false, false, true, true, false, false};
+    static const Bitfield peer5_bitfield{false, true, false, true, false, true};
 
     piece_manager.add_peer_bitfield(peer1_bitfield);
     piece_manager.add_peer_bitfield(peer2_bitfield);
@@ -326,7 +456,7 @@ TEST_CASE("PieceManager: Multiple Pieces", "[PieceManager]") {
 
     piece_manager.add_available_piece(1);
 
-    // Pieces ordering: 4, 0, 2, 1, 3, 5
+    // Pieces ordering: 4, {0, 2}, {1, 3, 5}, where the order of equally available pieces is random
 
     SECTION("Request blocks") {
         auto block = piece_manager.request_next_block(peer1_bitfield);
@@ -360,14 +490,16 @@ TEST_CASE("PieceManager: Multiple Pieces", "[PieceManager]") {
         // Get block after timeout
         {
             std::this_thread::sleep_for(request_timeout);
+            piece_manager.tick(std::chrono::steady_clock::now());
             for (auto i : std::views::iota(0, 6)) {
                 block = piece_manager.request_next_block(peer1_bitfield);
             }
 
             REQUIRE(block.has_value());
 
+            // Second block of the second of pieces 0 and 2
             auto [index, offset, length] = *block;
-            REQUIRE(index == 2);
+            REQUIRE((index == 0 || index == 2));
             REQUIRE(offset == BLOCK_SIZE);
             REQUIRE(length == BLOCK_SIZE);
         }
@@ -375,6 +507,7 @@ TEST_CASE("PieceManager: Multiple Pieces", "[PieceManager]") {
         // Get block after adding new availability
         {
             std::this_thread::sleep_for(request_timeout);
+            piece_manager.tick(std::chrono::steady_clock::now());
             // Add availability for piece 1
             piece_manager.add_available_piece(1);
             for (auto i : std::views::iota(0, 7)) {
@@ -383,13 +516,152 @@ TEST_CASE("PieceManager: Multiple Pieces", "[PieceManager]") {
 
             REQUIRE(block.has_value());
 
+            // Piece 1 is now the most available, so the first block of piece 3 or 5 comes next
             auto [index, offset, length] = *block;
-            REQUIRE(index == 5);
+            REQUIRE((index == 3 || index == 5));
             REQUIRE(offset == 0);
             REQUIRE(length == BLOCK_SIZE);
         }
     }
 
+    SECTION("Request blocks in batches") {
+        std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> blocks;
+        PieceManager::RequestCursor                           cursor;
+
+        auto request_blocks = [&](const Bitfield& bitfield, size_t blocks_cnt) {
+            return piece_manager.request_next_blocks(
+                bitfield, blocks_cnt, blocks, cursor, request_timeout
+            );
+        };
+
+        // Both blocks of piece 4, then the first block of piece 0 or 2
+        REQUIRE(request_blocks(peer1_bitfield, 3) == 3);
+        REQUIRE(blocks[0] == std::make_tuple(4U, 0U, BLOCK_SIZE));
+        REQUIRE(blocks[1] == std::make_tuple(4U, BLOCK_SIZE, BLOCK_SIZE));
+        auto first_piece{std::get<0>(blocks[2])};
+        REQUIRE((first_piece == 0 || first_piece == 2));
+        REQUIRE(std::get<1>(blocks[2]) == 0);
+
+        // The next batch resumes from the piece the previous one stopped at
+        REQUIRE(request_blocks(peer1_bitfield, 3) == 3);
+        REQUIRE(blocks[3] == std::make_tuple(first_piece, BLOCK_SIZE, BLOCK_SIZE));
+        auto second_piece{std::get<0>(blocks[4])};
+        REQUIRE((second_piece == 0 || second_piece == 2));
+        REQUIRE(second_piece != first_piece);
+
+        // Only the blocks of pieces 1, 3 and 5 are left
+        REQUIRE(request_blocks(peer1_bitfield, 20) == 6);
+        REQUIRE(request_blocks(peer1_bitfield, 20) == 0);
+        REQUIRE(blocks.size() == 12);
+
+        // Every block was requested once
+        std::ranges::sort(blocks);
+        REQUIRE(std::ranges::adjacent_find(blocks) == blocks.end());
+
+        // The peer does not have any piece
+        REQUIRE(request_blocks(peer2_bitfield, 3) == 0);
+    }
+
+    SECTION("Piece affinity") {
+        std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> blocks;
+        // A fast peer downloads a whole piece well within FAST_PEER_PIECE_TIME
+        PieceManager::RequestCursor fast{.download_rate = 1e6};
+        PieceManager::RequestCursor slow1;
+        PieceManager::RequestCursor slow2;
+
+        auto request_block = [&](PieceManager::RequestCursor& cursor) {
+            blocks.clear();
+            piece_manager.request_next_blocks(peer1_bitfield, 1, blocks, cursor, request_timeout);
+            return blocks.empty() ? std::nullopt : std::make_optional(blocks.front());
+        };
+
+        // The fast peer gets piece 4 to itself
+        REQUIRE(request_block(fast) == std::make_tuple(4U, 0U, BLOCK_SIZE));
+        auto slow_block{request_block(slow1)};
+        REQUIRE(slow_block.has_value());
+        auto slow_piece{std::get<0>(*slow_block)};
+        REQUIRE((slow_piece == 0 || slow_piece == 2));
+
+        // The slow peers share their pieces, and finish them before starting new ones
+        REQUIRE(request_block(slow2) == std::make_tuple(slow_piece, BLOCK_SIZE, BLOCK_SIZE));
+        REQUIRE(request_block(fast) == std::make_tuple(4U, BLOCK_SIZE, BLOCK_SIZE));
+
+        // The fast peer does not join the piece of the slow peers
+        auto fast_block{request_block(fast)};
+        REQUIRE(fast_block.has_value());
+        auto fast_piece{std::get<0>(*fast_block)};
+        REQUIRE((fast_piece == 0 || fast_piece == 2));
+        REQUIRE(fast_piece != slow_piece);
+
+        // Once released, the piece of the fast peer is finished by a slow peer
+        piece_manager.release_pieces(fast);
+        REQUIRE(request_block(slow1) == std::make_tuple(fast_piece, BLOCK_SIZE, BLOCK_SIZE));
+
+        // The released piece 4 has no block left to request, so it is left without owner, and the
+        // fast peer requests its timed out blocks, then those of the pieces of the slow peers
+        std::this_thread::sleep_for(request_timeout);
+        piece_manager.tick(std::chrono::steady_clock::now());
+        REQUIRE(request_block(fast) == std::make_tuple(4U, 0U, BLOCK_SIZE));
+        REQUIRE(request_block(fast) == std::make_tuple(4U, BLOCK_SIZE, BLOCK_SIZE));
+        auto retried_block{request_block(fast)};
+        REQUIRE(retried_block.has_value());
+        REQUIRE((std::get<0>(*retried_block) == 0 || std::get<0>(*retried_block) == 2));
+        REQUIRE(std::get<1>(*retried_block) == 0);
+    }
+
+    SECTION("Piece ownership liveness") {
+        static const Bitfield piece0_bitfield{true, false, false, false, false, false};
+
+        std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> blocks;
+        PieceManager::RequestCursor                           fast1{.download_rate = 1e6};
+        PieceManager::RequestCursor                           fast2{.download_rate = 1e6};
+        PieceManager::RequestCursor                           slow;
+
+        auto request_blocks = [&](PieceManager::RequestCursor& cursor,
+                                  size_t                       blocks_cnt,
+                                  std::chrono::milliseconds    timeout) {
+            blocks.clear();
+            return piece_manager.request_next_blocks(
+                piece0_bitfield, blocks_cnt, blocks, cursor, timeout
+            );
+        };
+
+        SECTION("Request timed out") {
+            REQUIRE(request_blocks(fast1, 1, 1ms) == 1);
+            REQUIRE(request_blocks(fast2, 2, 1h) == 0);
+
+            // The owner lost its request, so the other fast peer adopts the whole piece
+            std::this_thread::sleep_for(request_timeout);
+            piece_manager.tick(std::chrono::steady_clock::now());
+            REQUIRE(request_blocks(fast2, 2, 1h) == 2);
+        }
+
+        SECTION("Owner no longer fast") {
+            auto deadline{piece_manager.get_deadline_tick(1h)};
+            REQUIRE(request_blocks(fast1, 1, 1h) == 1);
+            REQUIRE(blocks.front() == std::make_tuple(0U, 0U, BLOCK_SIZE));
+
+            // The slowed down owner shares the piece with the slow peers
+            fast1.download_rate = 0.0;
+            REQUIRE(request_blocks(fast1, 1, 1h) == 1);
+            piece_manager.return_block(0, 0, deadline);
+            REQUIRE(request_blocks(slow, 2, 1h) == 1);
+            REQUIRE(blocks.front() == std::make_tuple(0U, 0U, BLOCK_SIZE));
+        }
+
+        SECTION("Owner stalled") {
+            REQUIRE(request_blocks(fast1, 1, 1h) == 1);
+            REQUIRE(request_blocks(fast2, 2, 1ms) == 0);
+
+            // No block arrived within the timeout of the other fast peer, which takes the blocks
+            // left
+            std::this_thread::sleep_for(request_timeout);
+            piece_manager.tick(std::chrono::steady_clock::now());
+            REQUIRE(request_blocks(fast2, 2, 1ms) == 1);
+            REQUIRE(blocks.front() == std::make_tuple(0U, BLOCK_SIZE, BLOCK_SIZE));
+        }
+    }
+
     SECTION("Receive pieces") {
         std::string_view block1{piece_data.data(), BLOCK_SIZE};
         std::string_view block2{piece_data.data() + BLOCK_SIZE, BLOCK_SIZE};
@@ -463,6 +735,8 @@ TEST_CASE("PieceManager: Multiple Pieces", "[PieceManager]") {
                 3, std::span(reinterpret_cast<const std::byte*>(block7.data()), BLOCK_SIZE), 0
             );
 
+            piece_manager.wait_pending_writes();
+
             std::string result_str{
                 read_from_file(files_info[0].path, 0, 2 * BLOCK_SIZE) +
                 read_from_file(files_info[1].path, 0, 4 * BLOCK_SIZE) +
@@ -478,6 +752,8 @@ TEST_CASE("PieceManager: Multiple Pieces", "[PieceManager]") {
             piece_manager.receive_block(
                 3, std::span(reinterpret_cast<const std::byte*>(block7.data()), BLOCK_SIZE), 0
             );
+            piece_manager.wait_pending_writes();
+
             std::string result_str{
                 read_from_file(files_info[0].path, 0, 2 * BLOCK_SIZE) +
                 read_from_file(files_info[1].path, 0, 4 * BLOCK_SIZE) +
@@ -493,3 +769,133 @@ TEST_CASE("PieceManager: Multiple Pieces", "[PieceManager]") {
         std::filesystem::remove(file.path);
     }
 }
+
+TEST_CASE("PieceManager: Write-through", "[PieceManager]") {
+    static const std::array<torrent::md::FileInfo, 2> files_info{
+        {{"wt_file1", 0, 3 * BLOCK_SIZE / 2}, {"wt_file2", 3 * BLOCK_SIZE / 2, 3 * BLOCK_SIZE / 2}}
+    };
+    std::shared_ptr<fs::FileManager> file_manager = std::make_shared<fs::FileManager>(files_info);
+
+    std::string piece_data{
+        std::string(BLOCK_SIZE, 'a') + std::string(BLOCK_SIZE, 'b') + std::string(BLOCK_SIZE, 'c')
+    };
+
+    crypto::Sha1 piece_hash{
+        crypto::Sha1::digest(reinterpret_cast<uint8_t*>(piece_data.data()), piece_data.size())
+    };
+
+    std::chrono::milliseconds request_timeout{10ms};
+
+    PieceManager piece_manager(
+        piece_data.size(),
+        piece_data.size(),
+        file_manager,
+        piece_hash.get(),
+        request_timeout,
+        PieceBuffering::WRITE_THROUGH
+    );
+
+    static const Bitfield peer_bitfield{true};
+    piece_manager.add_peer_bitfield(peer_bitfield);
+
+    for (int i{0}; i < 3; ++i) {
+        REQUIRE(piece_manager.request_next_block(peer_bitfield).has_value());
+    }
+
+    auto receive = [&piece_manager](std::string_view block, uint32_t offset) {
+        piece_manager.receive_block(
+            0, std::span(reinterpret_cast<const std::byte*>(block.data()), block.size()), offset
+        );
+    };
+
+    std::string block1{piece_data.substr(0, BLOCK_SIZE)};
+    std::string block2{piece_data.substr(BLOCK_SIZE, BLOCK_SIZE)};
+    std::string block3{piece_data.substr(2 * BLOCK_SIZE, BLOCK_SIZE)};
+
+    SECTION("Receive valid piece") {
+        // The first block is hashed in memory, the others are read back from the files
+        receive(block1, 0);
+        receive(block3, 2 * BLOCK_SIZE);
+        receive(block2, BLOCK_SIZE);
+
+        piece_manager.wait_pending_writes();
+
+        std::string result_str{
+            read_from_file(files_info[0].path, 0, 3 * BLOCK_SIZE / 2) +
+            read_from_file(files_info[1].path, 0, 3 * BLOCK_SIZE / 2)
+        };
+
+        REQUIRE(result_str == piece_data);
+        REQUIRE(piece_manager.completed());
+        REQUIRE(piece_manager.get_downloaded_bytes() == piece_data.size());
+    }
+
+    SECTION("Receive invalid piece") {
+        block3[0] = 'z';
+        receive(block3, 2 * BLOCK_SIZE);
+        receive(block2, BLOCK_SIZE);
+        receive(block1, 0);
+
+        piece_manager.wait_pending_writes();
+
+        REQUIRE_FALSE(piece_manager.completed());
+
+        // The piece is downloaded again from its first block
+        auto block = piece_manager.request_next_block(peer_bitfield);
+        REQUIRE(block.has_value());
+        REQUIRE(std::get<0>(*block) == 0);
+        REQUIRE(std::get<1>(*block) == 0);
+    }
+
+    // Remove the files
+    for (const auto& file : files_info) {
+        std::filesystem::remove(file.path);
+    }
+}
+
+TEST_CASE("PieceManager: Reserve piece", "[PieceManager]") {
+    // The pool holds two pieces, one of them being the reserve
+    static constexpr uint32_t piece_size{MAX_MEMPOOL_SIZE};
+    static constexpr size_t   piece_blocks{piece_size / BLOCK_SIZE};
+
+    static const std::array<torrent::md::FileInfo, 1> files_info{
+        {{"reserve_file", 0, 2 * static_cast<size_t>(piece_size)}}
+    };
+    std::shared_ptr<fs::FileManager> file_manager = std::make_shared<fs::FileManager>(
+        files_info, ".", fs::StorageType::SYNC, fs::AllocationPolicy::NONE
+    );
+
+    std::array<uint8_t, 2 * crypto::SHA1_SIZE> piece_hashes{};
+    PieceManager piece_manager(
+        piece_size, 2 * static_cast<size_t>(piece_size), file_manager, piece_hashes
+    );
+
+    static const Bitfield peer1_bitfield{true, false};
+    static const Bitfield peer2_bitfield{false, true};
+    piece_manager.add_peer_bitfield(peer1_bitfield);
+    piece_manager.add_peer_bitfield(peer2_bitfield);
+
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> blocks;
+    PieceManager::RequestCursor                           cursor1;
+    PieceManager::RequestCursor                           cursor2;
+
+    // The first peer starts piece 0, then the second peer takes the rest of the pool for piece 1,
+    // including the reserve
+    REQUIRE(piece_manager.request_next_blocks(peer1_bitfield, 1, blocks, cursor1, 1h) == 1);
+    REQUIRE(
+        piece_manager.request_next_blocks(peer2_bitfield, piece_blocks, blocks, cursor2, 1h) ==
+        piece_blocks
+    );
+    REQUIRE(piece_manager.request_next_blocks(peer1_bitfield, 1, blocks, cursor1, 1h) == 0);
+
+    // The only peer of the reserve piece leaves, so the piece gives its memory back and piece 0
+    // can complete
+    piece_manager.remove_peer_bitfield(peer2_bitfield, false);
+    piece_manager.release_pieces(cursor2);
+    REQUIRE(
+        piece_manager.request_next_blocks(peer1_bitfield, piece_blocks, blocks, cursor1, 1h) ==
+        piece_blocks - 1
+    );
+
+    std::filesystem::remove(files_info[0].path);
+}
@@ -0,0 +1,76 @@
+#include "PieceVerifier.hpp"
+
+#include "Crypto.hpp"
+#include "FileManager.hpp"
+
+#include <algorithm>
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace torrent;
+
+TEST_CASE("PieceVerifier: verify", "[PieceVerifier]") {
+    static const std::array<md::FileInfo, 3> files_info{
+        {{"dir/file1", 0, 20}, {"dir/file2", 20, 30}, {"dir/file3", 50, 25}}
+    };
+    static constexpr uint32_t piece_size{16};
+    static constexpr size_t   torrent_size{75};
+
+    // 5 pieces, the last one being shorter
+    std::string torrent_data;
+    for (char c{'a'}; torrent_data.size() < torrent_size; ++c) {
+        torrent_data.append(std::min<size_t>(piece_size, torrent_size - torrent_data.size()), c);
+    }
+
+    std::string piece_hashes;
+    for (size_t offset{0}; offset < torrent_size; offset += piece_size) {
+        auto piece_len{std::min<size_t>(piece_size, torrent_size - offset)};
+        auto hash{crypto::Sha1::digest(
+            reinterpret_cast<const uint8_t*>(torrent_data.data() + offset), piece_len
+        )};
+        piece_hashes.append(reinterpret_cast<const char*>(hash.get().data()), crypto::SHA1_SIZE);
+    }
+
+    auto storage_type = GENERATE(fs::StorageType::SYNC, fs::StorageType::MMAP);
+
+    auto file_manager{std::make_shared<fs::FileManager>(
+        files_info, ".", storage_type, fs::AllocationPolicy::SPARSE
+    )};
+
+    // Write everything but piece 3, and corrupt piece 1
+    std::string corrupted_data{torrent_data};
+    corrupted_data[piece_size + 3] = 'z';
+    file_manager->write(std::string_view(corrupted_data).substr(0, 3 * piece_size), 0);
+    file_manager->write(std::string_view(corrupted_data).substr(4 * piece_size), 4 * piece_size);
+    file_manager->flush();
+
+    PieceVerifier verifier{
+        file_manager,
+        std::span(reinterpret_cast<const uint8_t*>(piece_hashes.data()), piece_hashes.size()),
+        piece_size,
+        torrent_size,
+        3
+    };
+
+    SECTION("All pieces") {
+        REQUIRE(verifier.verify_all() == std::vector<bool>{true, false, true, false, true});
+        REQUIRE(verifier.get_checked_count() == 5);
+    }
+
+    SECTION("Some pieces") {
+        std::vector<uint32_t> pieces{1, 2};
+        REQUIRE(verifier.verify(pieces) == std::vector<bool>{false, false, true, false, false});
+        REQUIRE(verifier.get_checked_count() == 2);
+    }
+
+    file_manager.reset();
+    std::filesystem::remove_all("dir");
+}
@@ -0,0 +1,145 @@
+#include "RequestPipeline.hpp"
+
+#include "Constant.hpp"
+#include "Duration.hpp"
+
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+using namespace torrent;
+using namespace torrent::peer;
+using namespace std::chrono_literals;
+
+TEST_CASE("RequestPipeline: blocks in flight", "[RequestPipeline]") {
+    RequestPipeline pipeline;
+    auto            now{RequestPipeline::Clock::now()};
+
+    REQUIRE(pipeline.get_depth() == INITIAL_BLOCKS_IN_FLIGHT);
+    REQUIRE(pipeline.get_free_slots() == INITIAL_BLOCKS_IN_FLIGHT);
+
+    for (uint32_t i{0}; i < 4; ++i) {
+        REQUIRE(pipeline.add({i / 2, (i % 2) * BLOCK_SIZE, BLOCK_SIZE}, now + i * 10ms));
+    }
+    REQUIRE_FALSE(pipeline.add({0, 0, BLOCK_SIZE}, now));
+    REQUIRE(pipeline.size() == 4);
+    REQUIRE(pipeline.get_free_slots() == INITIAL_BLOCKS_IN_FLIGHT - 4);
+
+    // The round-trip time is sampled from the blocks in flight only
+    REQUIRE_FALSE(pipeline.receive({5, 0, BLOCK_SIZE}, now + 10ms));
+    REQUIRE_FALSE(pipeline.get_min_rtt().has_value());
+    REQUIRE(pipeline.receive({1, BLOCK_SIZE, BLOCK_SIZE}, now + 80ms));
+    REQUIRE(pipeline.receive({0, 0, BLOCK_SIZE}, now + 100ms));
+    REQUIRE_FALSE(pipeline.receive({0, 0, BLOCK_SIZE}, now + 100ms));
+    REQUIRE(pipeline.get_min_rtt() == 50ms);
+    REQUIRE(pipeline.size() == 2);
+
+    // The blocks left are still indexed after being moved by the removals
+    REQUIRE(pipeline.remove_if([&](const RequestPipeline::Request& request) {
+        return request.request_time < now + 15ms;
+    }) == 1);
+    REQUIRE(pipeline.receive({1, 0, BLOCK_SIZE}, now + 100ms));
+    REQUIRE(pipeline.size() == 0);
+
+    pipeline.clear();
+    REQUIRE(pipeline.get_depth() == INITIAL_BLOCKS_IN_FLIGHT);
+    REQUIRE_FALSE(pipeline.get_srtt().has_value());
+}
+
+TEST_CASE("RequestPipeline: deadlines", "[RequestPipeline]") {
+    RequestPipeline pipeline;
+    auto            now{RequestPipeline::Clock::now()};
+
+    // Each request keeps its own deadline, even after being moved by a removal
+    for (uint32_t i{0}; i < 4; ++i) {
+        REQUIRE(pipeline.add({i, 0, BLOCK_SIZE}, now, 10 + i));
+    }
+    REQUIRE(pipeline.receive({0, 0, BLOCK_SIZE}, now + 10ms));
+
+    std::vector<uint64_t> deadlines;
+    REQUIRE(pipeline.remove_if([&](const RequestPipeline::Request& request) {
+        REQUIRE(request.deadline_tick == 10 + std::get<0>(request.block_info));
+        deadlines.push_back(request.deadline_tick);
+        return request.deadline_tick <= 12;
+    }) == 2);
+    std::ranges::sort(deadlines);
+    REQUIRE(deadlines == std::vector<uint64_t>{11, 12, 13});
+    REQUIRE(pipeline.contains({3, 0, BLOCK_SIZE}));
+}
+
+TEST_CASE("RequestPipeline: depth", "[RequestPipeline]") {
+    static constexpr uint32_t max_depth{100};
+
+    RequestPipeline pipeline{max_depth};
+    auto            now{RequestPipeline::Clock::now()};
+    pipeline.update(now);
+
+    // A full pipeline received with a 100ms round-trip time, and nothing else for the rest of the
+    // window: the depth grows to cover the queue time as well
+    for (uint32_t i{0}; i < INITIAL_BLOCKS_IN_FLIGHT; ++i) {
+        pipeline.add({i, 0, BLOCK_SIZE}, now);
+    }
+    for (uint32_t i{0}; i < INITIAL_BLOCKS_IN_FLIGHT; ++i) {
+        pipeline.receive({i, 0, BLOCK_SIZE}, now + 100ms);
+    }
+
+    // The depth only changes once the rate window elapsed
+    pipeline.update(now + 500ms);
+    REQUIRE(pipeline.get_depth() == INITIAL_BLOCKS_IN_FLIGHT);
+
+    now += duration::RATE_WINDOW;
+    pipeline.update(now);
+    REQUIRE(pipeline.get_rate() == static_cast<double>(INITIAL_BLOCKS_IN_FLIGHT * BLOCK_SIZE));
+    REQUIRE(pipeline.get_depth() == 11);
+
+    // The depth is bounded by the request queue of the peer
+    for (uint32_t i{0}; i < 10 * max_depth; ++i) {
+        pipeline.receive({i, 0, BLOCK_SIZE}, now);
+    }
+    now += duration::RATE_WINDOW;
+    pipeline.update(now);
+    REQUIRE(pipeline.get_depth() == max_depth);
+
+    // An idle peer keeps a minimal pipeline
+    for (int i{0}; i < 20; ++i) {
+        now += duration::RATE_WINDOW;
+        pipeline.update(now);
+    }
+    REQUIRE(pipeline.get_depth() == MIN_BLOCKS_IN_FLIGHT);
+}
+
+TEST_CASE("RequestPipeline: request timeout", "[RequestPipeline]") {
+    RequestPipeline pipeline;
+    auto            now{RequestPipeline::Clock::now()};
+
+    auto sample_rtt{[&](std::chrono::milliseconds rtt) {
+        pipeline.add({0, 0, BLOCK_SIZE}, now);
+        now += rtt;
+        REQUIRE(pipeline.receive({0, 0, BLOCK_SIZE}, now));
+    }};
+
+    // The default timeout is used until the round-trip time of the peer is known
+    REQUIRE(pipeline.get_request_timeout() == duration::REQUEST_TIMEOUT);
+
+    // The first sample sets the variation to half the round-trip time
+    sample_rtt(1s);
+    REQUIRE(pipeline.get_request_timeout() == 3s);
+
+    // A steady round-trip time lowers the variation
+    sample_rtt(1s);
+    REQUIRE(pipeline.get_request_timeout() == 2500ms);
+
+    // A fast peer is bounded from below
+    pipeline.clear();
+    REQUIRE(pipeline.get_request_timeout() == duration::REQUEST_TIMEOUT);
+    sample_rtt(10ms);
+    REQUIRE(pipeline.get_request_timeout() == duration::MIN_REQUEST_TIMEOUT);
+
+    // A slow peer is bounded from above
+    pipeline.clear();
+    sample_rtt(20s);
+    REQUIRE(pipeline.get_request_timeout() == duration::MAX_REQUEST_TIMEOUT);
+}
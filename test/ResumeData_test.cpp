@@ -0,0 +1,128 @@
+#include "ResumeData.hpp"
+
+#include "Crypto.hpp"
+#include "FileManager.hpp"
+
+#include <array>
+#include <catch2/catch_test_macros.hpp>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace torrent;
+
+TEST_CASE("ResumeData: save and load", "[ResumeData]") {
+    static const std::array<md::FileInfo, 3> files_info{
+        {{"dir/file1", 0, 10}, {"dir/file2", 10, 20}, {"dir/file3", 30, 30}}
+    };
+    static constexpr size_t piece_length{10};
+    static constexpr size_t pieces_cnt{6};
+    static const std::string resume_file{"dir.resume"};
+
+    std::string  info_hash_data(crypto::SHA1_SIZE, 'x');
+    crypto::Sha1 info_hash{
+        crypto::Sha1::from_raw_data(reinterpret_cast<const uint8_t*>(info_hash_data.data()))
+    };
+
+    {
+        fs::FileManager file_manager{
+            files_info, ".", fs::StorageType::SYNC, fs::AllocationPolicy::SPARSE
+        };
+    }
+
+    SECTION("Missing resume file") {
+        fs::ResumeData resume_data{
+            resume_file, files_info, ".", info_hash, piece_length, pieces_cnt
+        };
+        REQUIRE_FALSE(resume_data.load());
+    }
+
+    {
+        fs::ResumeData resume_data{
+            resume_file, files_info, ".", info_hash, piece_length, pieces_cnt
+        };
+        resume_data.set_piece_completed(0, true);
+        resume_data.set_piece_completed(2, true);
+        resume_data.set_piece_completed(4, true);
+        resume_data.save();
+    }
+
+    SECTION("Unchanged files") {
+        fs::ResumeData resume_data{
+            resume_file, files_info, ".", info_hash, piece_length, pieces_cnt
+        };
+        REQUIRE(resume_data.load());
+        REQUIRE(
+            resume_data.get_completed_pieces() ==
+            std::vector<bool>{true, false, true, false, true, false}
+        );
+        REQUIRE(resume_data.get_pieces_to_verify().empty());
+    }
+
+    SECTION("Changed file") {
+        // Pieces 1 and 2 overlap file2, but only piece 2 was completed
+        std::filesystem::last_write_time(
+            "dir/file2", std::filesystem::last_write_time("dir/file2") - std::chrono::hours(1)
+        );
+
+        fs::ResumeData resume_data{
+            resume_file, files_info, ".", info_hash, piece_length, pieces_cnt
+        };
+        REQUIRE(resume_data.load());
+        REQUIRE(resume_data.get_pieces_to_verify() == std::vector<uint32_t>{2});
+    }
+
+    SECTION("Resume file of another torrent") {
+        std::string  other_hash_data(crypto::SHA1_SIZE, 'y');
+        crypto::Sha1 other_hash{
+            crypto::Sha1::from_raw_data(reinterpret_cast<const uint8_t*>(other_hash_data.data()))
+        };
+
+        fs::ResumeData resume_data{
+            resume_file, files_info, ".", other_hash, piece_length, pieces_cnt
+        };
+        REQUIRE_FALSE(resume_data.load());
+        REQUIRE(resume_data.get_completed_pieces() == std::vector<bool>(pieces_cnt, false));
+    }
+
+    std::filesystem::remove_all("dir");
+    std::filesystem::remove(resume_file);
+}
+
+TEST_CASE("ResumeData: sync the files before saving", "[ResumeData]") {
+    static const std::array<md::FileInfo, 1> files_info{{{"sync_file1", 0, 20}}};
+    static constexpr size_t piece_length{10};
+    static constexpr size_t pieces_cnt{2};
+    static const std::string resume_file{"sync_file1.resume"};
+
+    std::string  info_hash_data(crypto::SHA1_SIZE, 'x');
+    crypto::Sha1 info_hash{
+        crypto::Sha1::from_raw_data(reinterpret_cast<const uint8_t*>(info_hash_data.data()))
+    };
+
+    fs::FileManager file_manager{files_info};
+    fs::ResumeData  resume_data{resume_file, files_info, ".", info_hash, piece_length, pieces_cnt};
+    resume_data.set_piece_completed(1, true);
+
+    // The pieces are not recorded if their data could not be made durable
+    resume_data.save([] { throw std::runtime_error("sync failed"); });
+    REQUIRE_FALSE(std::filesystem::exists(resume_file));
+
+    // They are recorded on the next save instead
+    size_t syncs{0};
+    resume_data.save([&] {
+        file_manager.sync();
+        ++syncs;
+    });
+    REQUIRE(syncs == 1);
+
+    fs::ResumeData loaded_data{resume_file, files_info, ".", info_hash, piece_length, pieces_cnt};
+    REQUIRE(loaded_data.load());
+    REQUIRE(loaded_data.get_completed_pieces() == std::vector<bool>{false, true});
+
+    std::filesystem::remove(files_info[0].path);
+    std::filesystem::remove(resume_file);
+}
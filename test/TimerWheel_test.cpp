@@ -0,0 +1,98 @@
+#include "TimerWheel.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace torrent::utils;
+
+TEST_CASE("TimerWheel: expiry", "[TimerWheel]") {
+    TimerWheel<uint64_t> timer_wheel;
+
+    // Timers of every level, the value being the expiry tick
+    static const std::vector<uint64_t> expiry_ticks{
+        1, 5, 63, 64, 65, 100, 4095, 4096, 4160, 262'143, 262'144, 300'000, 17'000'000
+    };
+    for (auto expiry_tick : expiry_ticks) {
+        timer_wheel.schedule(expiry_tick, expiry_tick);
+    }
+    REQUIRE(timer_wheel.size() == expiry_ticks.size());
+
+    std::vector<std::pair<uint64_t, uint64_t>> expired;
+
+    SECTION("One tick at a time") {
+        for (uint64_t tick{1}; tick <= expiry_ticks.back(); ++tick) {
+            timer_wheel.advance(tick, [&](uint64_t value) { expired.emplace_back(tick, value); });
+        }
+    }
+
+    SECTION("Large steps") {
+        for (auto tick : {70ULL, 5'000ULL, 300'000ULL, 20'000'000ULL}) {
+            timer_wheel.advance(tick, [&](uint64_t value) { expired.emplace_back(value, value); });
+        }
+    }
+
+    // Every timer expired once, in order and at its tick
+    REQUIRE(expired.size() == expiry_ticks.size());
+    for (size_t i{0}; i < expired.size(); ++i) {
+        REQUIRE(expired[i].first == expired[i].second);
+        REQUIRE(expired[i].second == expiry_ticks[i]);
+    }
+    REQUIRE(timer_wheel.size() == 0);
+}
+
+TEST_CASE("TimerWheel: schedule from the expiry handler", "[TimerWheel]") {
+    TimerWheel<int> timer_wheel;
+    timer_wheel.advance(10, [](int) {});
+
+    // A tick in the past expires on the next advance
+    timer_wheel.schedule(1, 3);
+
+    std::vector<std::pair<uint64_t, int>> expired;
+    for (uint64_t tick{11}; tick <= 20; ++tick) {
+        timer_wheel.advance(tick, [&](int value) {
+            expired.emplace_back(tick, value);
+            if (value < 3) {
+                timer_wheel.schedule(value + 1, tick + 2);
+            }
+        });
+    }
+
+    REQUIRE(expired == std::vector<std::pair<uint64_t, int>>{{11, 1}, {13, 2}, {15, 3}});
+}
+
+TEST_CASE("TimerWheel: clock jump", "[TimerWheel]") {
+    TimerWheel<uint64_t> timer_wheel;
+
+    // An empty wheel moves straight to the tick
+    timer_wheel.advance(1'000, [](uint64_t) {});
+    REQUIRE(timer_wheel.get_current_tick() == 1'000);
+
+    // A jump far beyond the timers is not stepped through one tick at a time
+    static constexpr uint64_t jump_tick{1ULL << 40};
+    static const std::vector<uint64_t> expiry_ticks{
+        1'001, 1'200, 70'000, jump_tick + 10, jump_tick + 5'000
+    };
+    for (auto expiry_tick : expiry_ticks) {
+        timer_wheel.schedule(expiry_tick, expiry_tick);
+    }
+
+    std::vector<uint64_t> expired;
+    timer_wheel.advance(jump_tick, [&](uint64_t value) { expired.push_back(value); });
+    REQUIRE(expired == std::vector<uint64_t>{1'001, 1'200, 70'000});
+    REQUIRE(timer_wheel.get_current_tick() == jump_tick);
+    REQUIRE(timer_wheel.size() == 2);
+
+    // The timers left still expire at their tick
+    std::vector<std::pair<uint64_t, uint64_t>> later;
+    for (auto tick{jump_tick + 1}; tick <= jump_tick + 5'000; ++tick) {
+        timer_wheel.advance(tick, [&](uint64_t value) { later.emplace_back(tick, value); });
+    }
+    REQUIRE(
+        later == std::vector<std::pair<uint64_t, uint64_t>>{
+                     {jump_tick + 10, jump_tick + 10}, {jump_tick + 5'000, jump_tick + 5'000}
+                 }
+    );
+    REQUIRE(timer_wheel.size() == 0);
+}
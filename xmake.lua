@@ -14,6 +14,16 @@ local packages = {
     "cpp-httplib"
 }
 
+option("io_uring")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Build the io_uring storage backend (requires liburing)")
+option_end()
+
+if has_config("io_uring") then
+    table.insert(packages, "liburing")
+end
+
 for _, pkg in ipairs(packages) do
     add_requires(pkg)
 end
@@ -37,8 +47,12 @@ rule("config_pkgs")
 target("common_lib")
     add_rules("config_pkgs")
     set_kind("static")
-    add_files("src/*.cpp|main.cpp|ProgressBar.cpp")
+    add_files("src/*.cpp|main.cpp|ProgressBar.cpp|UringStorage.cpp")
     add_includedirs("src")
+    if has_config("io_uring") then
+        add_files("src/UringStorage.cpp")
+        add_defines("TORRENT_IO_URING", {public = true})
+    end
 
 -- Add the main target
 target("cpp-torrent")